@@ -14,22 +14,35 @@
 
 #include "lldb-eval/api.h"
 
+#include <algorithm>
 #include <cassert>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "lldb-eval/api_internal.h"
 #include "lldb-eval/context.h"
 #include "lldb-eval/eval.h"
 #include "lldb-eval/parser.h"
 #include "lldb-eval/parser_context.h"
+#include "lldb-eval/read_set.h"
+#include "lldb-eval/stats.h"
+#include "lldb-eval/type_cache.h"
 #include "lldb-eval/value.h"
+#include "lldb/API/SBData.h"
 #include "lldb/API/SBError.h"
 #include "lldb/API/SBExecutionContext.h"
 #include "lldb/API/SBFrame.h"
+#include "lldb/API/SBProcess.h"
 #include "lldb/API/SBTarget.h"
+#include "lldb/API/SBThread.h"
 #include "lldb/API/SBValue.h"
 #include "lldb/lldb-enumerations.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/FormatVariadic.h"
 
 namespace lldb_eval {
 
@@ -69,7 +82,7 @@ static lldb::SBError CreateError(ErrorCode code, const char* message) {
   return error;
 }
 
-static std::shared_ptr<CompiledExpr> CompileExpressionImpl(
+std::shared_ptr<CompiledExpr> CompileExpressionImpl(
     std::shared_ptr<SourceManager> source, std::shared_ptr<Context> ctx,
     Options opts, lldb::SBType scope, lldb::SBError& error) {
   error.Clear();
@@ -80,6 +93,8 @@ static std::shared_ptr<CompiledExpr> CompileExpressionImpl(
   context_args.merge(ConvertToTypeMap(opts.context_vars));
   ctx->SetContextArgs(std::move(context_args));
   ctx->SetAllowSideEffects(opts.allow_side_effects);
+  ctx->SetStats(opts.stats);
+  ctx->SetTypeCache(opts.type_cache);
 
   Error err;
   Parser p(ctx);
@@ -89,20 +104,61 @@ static std::shared_ptr<CompiledExpr> CompileExpressionImpl(
     return nullptr;
   }
 
-  return std::make_shared<CompiledExpr>(source, std::move(tree), scope);
+  // Keep only the expression text, the source manager isn't needed anymore.
+  return std::make_shared<CompiledExpr>(source->GetSourceText(),
+                                        std::move(tree), scope);
 }
 
-static lldb::SBValue EvaluateExpressionImpl(
-    std::shared_ptr<CompiledExpr> parsed_expr, ContextVariableList context_vars,
-    lldb::SBTarget target, Value scope, lldb::SBError& error) {
-  Interpreter eval(target, parsed_expr->source, scope);
-  if (context_vars.size > 0) {
-    eval.SetContextVars(ConvertToValueMap(context_vars));
+// Options of the APIs taking a compiled expression, which accept only the
+// context variables.
+static Options ContextVarsOnly(ContextVariableList context_vars) {
+  Options opts;
+  opts.context_vars = context_vars;
+  return opts;
+}
+
+void ConfigureInterpreter(Interpreter& eval, const Options& opts) {
+  if (opts.context_vars.size > 0) {
+    eval.SetContextVars(ConvertToValueMap(opts.context_vars));
+  }
+  if (opts.memory_overlay != nullptr) {
+    eval.SetMemoryOverlay(opts.memory_overlay);
+  }
+  if (opts.read_set != nullptr) {
+    eval.SetReadSet(opts.read_set);
+  }
+  if (opts.stats != nullptr) {
+    eval.SetStats(opts.stats);
   }
+  eval.SetBudget(opts.budget);
+  eval.SetCancellationToken(opts.cancellation);
+}
+
+static Value EvaluateValueImpl(std::shared_ptr<CompiledExpr> parsed_expr,
+                               const Options& opts, lldb::SBTarget target,
+                               Value scope, lldb::SBError& error) {
+  Interpreter eval(target, parsed_expr->source, scope);
+  ConfigureInterpreter(eval, opts);
   Error err;
   Value ret = eval.Eval(parsed_expr->tree.get(), err);
   if (err) {
     error = CreateError(err.code(), err.message().c_str());
+    return ret;
+  }
+  // The process memory may be outdated, return the value seen in the overlay.
+  if (opts.memory_overlay != nullptr) {
+    ret = ret.ResolveOverlay();
+  }
+  return ret;
+}
+
+static lldb::SBValue EvaluateExpressionImpl(
+    std::shared_ptr<CompiledExpr> parsed_expr, const Options& opts,
+    lldb::SBTarget target, Value scope, lldb::SBError& error) {
+  lldb::SBError eval_error;
+  Value ret = EvaluateValueImpl(parsed_expr, opts, target, scope, eval_error);
+  if (eval_error.Fail()) {
+    error = eval_error;
     return ret.inner_value();
   }
 
@@ -114,7 +170,186 @@ static lldb::SBValue EvaluateExpressionImpl(
   return value;
 }
 
-CompiledExpr::CompiledExpr(std::shared_ptr<SourceManager> source,
+// Casts the `scope` to the type context of the compiled `expression`.
+static bool CastScopeToContextType(lldb::SBValue& scope,
+                                   const CompiledExpr& expression,
+                                   lldb::SBError& error) {
+  // The `scope` value should be casted to the context type used for parsing.
+  // This is allowed only in cases when the `scope`'s type is equal to the
+  // context type or it is derived from the context type.
+
+  std::vector<uint32_t> path;
+  if (!GetPathToBaseType(LLDBType::CreateSP(scope.GetType()),
+                         LLDBType::CreateSP(expression.scope), &path,
+                         /*offset*/ nullptr)) {
+    // If it's not possible to cast the given `scope` value to the type context
+    // of parsed expression, return with an error.
+    error = CreateError(
+        ErrorCode::kUnknown,
+        "expression isn't parsed in the context of compatible type");
+    return false;
+  }
+
+  // Cast the given `scope` to the expected type.
+  std::reverse(path.begin(), path.end());
+  for (const auto idx : path) {
+    scope = scope.GetChildAtIndex(idx);
+  }
+  assert(scope.IsValid() && "failed to cast scope variable");
+  return true;
+}
+
+static lldb::SBValue EvaluateCompiledExpressionImpl(
+    lldb::SBValue scope, std::shared_ptr<CompiledExpr> expression,
+    const Options& opts, lldb::SBError& error) {
+  if (!CastScopeToContextType(scope, *expression, error)) {
+    return lldb::SBValue();
+  }
+  return EvaluateExpressionImpl(expression, opts, scope.GetTarget(),
+                                Value(scope), error);
+}
+
+// Evaluation to the interpreter's result value, used by the typed APIs. The
+// `error` is cleared on success.
+
+static Value EvaluateValue(lldb::SBFrame frame, const char* expression,
+                           Options opts, lldb::SBError& error) {
+  auto source = SourceManager::Create(expression);
+  auto context = Context::Create(source, frame);
+  auto compiled_expr =
+      CompileExpressionImpl(source, context, opts, lldb::SBType(), error);
+  if (error.Fail()) {
+    return Value();
+  }
+
+  auto target = frame.GetThread().GetProcess().GetTarget();
+  return EvaluateValueImpl(compiled_expr, opts, target, Value(), error);
+}
+
+static Value EvaluateValue(lldb::SBValue scope,
+                           std::shared_ptr<CompiledExpr> expression,
+                           const Options& opts, lldb::SBError& error) {
+  error.Clear();
+  if (!CastScopeToContextType(scope, *expression, error)) {
+    return Value();
+  }
+  return EvaluateValueImpl(expression, opts, scope.GetTarget(), Value(scope),
+                           error);
+}
+
+static Value EvaluateValue(lldb::SBValue scope, const char* expression,
+                           Options opts, lldb::SBError& error) {
+  auto compiled_expr = CompileExpression(scope.GetTarget(), scope.GetType(),
+                                         expression, opts, error);
+  if (error.Fail()) {
+    return Value();
+  }
+  return EvaluateValue(scope, compiled_expr, opts, error);
+}
+
+static lldb::SBError CreateConversionError(Value& value, const char* type) {
+  return CreateError(
+      ErrorCode::kInvalidOperandType,
+      llvm::formatv("result of type {0} can't be converted to '{1}'",
+                    TypeDescription(value.type()), type)
+          .str()
+          .c_str());
+}
+
+static bool IsIntegerOrEnum(Value& value) {
+  return value.IsInteger() || value.IsUnscopedEnum() || value.IsScopedEnum();
+}
+
+// Conversions of the result, the same as `static_cast` in C++. They return 0
+// (or false) if the `error` is already set by the evaluation.
+
+static int64_t ToInt64(Value value, lldb::SBError& error) {
+  if (error.Fail()) {
+    return 0;
+  }
+  if (IsIntegerOrEnum(value)) {
+    return value.GetInteger().extOrTrunc(64).getSExtValue();
+  }
+  if (value.IsFloat()) {
+    llvm::APSInt ret(64, /*isUnsigned*/ false);
+    bool ignore;
+    value.GetFloat().convertToInteger(ret, llvm::APFloat::rmTowardZero,
+                                      &ignore);
+    return ret.getSExtValue();
+  }
+  error = CreateConversionError(value, "int64_t");
+  return 0;
+}
+
+static uint64_t ToUInt64(Value value, lldb::SBError& error) {
+  if (error.Fail()) {
+    return 0;
+  }
+  if (IsIntegerOrEnum(value)) {
+    return value.GetInteger().extOrTrunc(64).getZExtValue();
+  }
+  if (value.IsFloat()) {
+    llvm::APSInt ret(64, /*isUnsigned*/ true);
+    bool ignore;
+    value.GetFloat().convertToInteger(ret, llvm::APFloat::rmTowardZero,
+                                      &ignore);
+    return ret.getZExtValue();
+  }
+  error = CreateConversionError(value, "uint64_t");
+  return 0;
+}
+
+static double ToDouble(Value value, lldb::SBError& error) {
+  if (error.Fail()) {
+    return 0;
+  }
+  if (IsIntegerOrEnum(value)) {
+    llvm::APSInt v = value.GetInteger();
+    llvm::APFloat ret(llvm::APFloat::IEEEdouble());
+    ret.convertFromAPInt(v, v.isSigned(), llvm::APFloat::rmNearestTiesToEven);
+    return ret.convertToDouble();
+  }
+  if (value.IsFloat()) {
+    llvm::APFloat ret = value.GetFloat();
+    bool ignore;
+    ret.convert(llvm::APFloat::IEEEdouble(), llvm::APFloat::rmNearestTiesToEven,
+                &ignore);
+    return ret.convertToDouble();
+  }
+  error = CreateConversionError(value, "double");
+  return 0;
+}
+
+static bool ToBool(Value value, lldb::SBError& error) {
+  if (error.Fail()) {
+    return false;
+  }
+  if (!value.type()->IsContextuallyConvertibleToBool()) {
+    error = CreateConversionError(value, "bool");
+    return false;
+  }
+  return value.GetBool();
+}
+
+static lldb::addr_t ToAddress(Value value, lldb::SBError& error) {
+  if (error.Fail()) {
+    return LLDB_INVALID_ADDRESS;
+  }
+  if (value.IsPointer() || value.IsNullPtrType()) {
+    return value.GetUInt64();
+  }
+  if (value.type()->IsArrayType()) {
+    // Array-to-pointer conversion.
+    return value.AddressOf().GetUInt64();
+  }
+  if (IsIntegerOrEnum(value)) {
+    return value.GetInteger().extOrTrunc(64).getZExtValue();
+  }
+  error = CreateConversionError(value, "lldb::addr_t");
+  return LLDB_INVALID_ADDRESS;
+}
+
+CompiledExpr::CompiledExpr(std::shared_ptr<const SourceText> source,
                            std::unique_ptr<AstNode> tree, lldb::SBType scope)
     : source(std::move(source)),
       tree(std::move(tree)),
@@ -140,8 +375,7 @@ lldb::SBValue EvaluateExpression(lldb::SBFrame frame, const char* expression,
   }
 
   auto target = frame.GetThread().GetProcess().GetTarget();
-  return EvaluateExpressionImpl(compiled_expr, opts.context_vars, target,
-                                Value(), error);
+  return EvaluateExpressionImpl(compiled_expr, opts, target, Value(), error);
 }
 
 lldb::SBValue EvaluateExpression(lldb::SBValue scope, const char* expression,
@@ -156,7 +390,7 @@ lldb::SBValue EvaluateExpression(lldb::SBValue scope, const char* expression,
   if (error.GetError()) {
     return lldb::SBValue();
   }
-  return EvaluateExpression(scope, compiled_expr, opts.context_vars, error);
+  return EvaluateCompiledExpressionImpl(scope, compiled_expr, opts, error);
 }
 
 std::shared_ptr<CompiledExpr> CompileExpression(lldb::SBTarget target,
@@ -186,31 +420,558 @@ lldb::SBValue EvaluateExpression(lldb::SBValue scope,
                                  std::shared_ptr<CompiledExpr> expression,
                                  ContextVariableList context_vars,
                                  lldb::SBError& error) {
-  // The `scope` value should be casted to the context type used for parsing.
-  // This is allowed only in cases when the `scope`'s type is equal to the
-  // context type or it is derived from the context type.
+  return EvaluateCompiledExpressionImpl(scope, expression,
+                                        ContextVarsOnly(context_vars), error);
+}
 
-  std::vector<uint32_t> path;
-  if (!GetPathToBaseType(LLDBType::CreateSP(scope.GetType()),
-                         LLDBType::CreateSP(expression->scope), &path,
-                         /*offset*/ nullptr)) {
-    // If it's not possible to cast the given `scope` value to the type context
-    // of parsed expression, return with an error.
+int64_t EvaluateToInt64(lldb::SBFrame frame, const char* expression,
+                        Options opts, lldb::SBError& error) {
+  return ToInt64(EvaluateValue(frame, expression, opts, error), error);
+}
+
+int64_t EvaluateToInt64(lldb::SBValue scope, const char* expression,
+                        Options opts, lldb::SBError& error) {
+  return ToInt64(EvaluateValue(scope, expression, opts, error), error);
+}
+
+int64_t EvaluateToInt64(lldb::SBValue scope,
+                        std::shared_ptr<CompiledExpr> expression,
+                        ContextVariableList context_vars,
+                        lldb::SBError& error) {
+  Options opts = ContextVarsOnly(context_vars);
+  return ToInt64(EvaluateValue(scope, expression, opts, error), error);
+}
+
+uint64_t EvaluateToUInt64(lldb::SBFrame frame, const char* expression,
+                          Options opts, lldb::SBError& error) {
+  return ToUInt64(EvaluateValue(frame, expression, opts, error), error);
+}
+
+uint64_t EvaluateToUInt64(lldb::SBValue scope, const char* expression,
+                          Options opts, lldb::SBError& error) {
+  return ToUInt64(EvaluateValue(scope, expression, opts, error), error);
+}
+
+uint64_t EvaluateToUInt64(lldb::SBValue scope,
+                          std::shared_ptr<CompiledExpr> expression,
+                          ContextVariableList context_vars,
+                          lldb::SBError& error) {
+  Options opts = ContextVarsOnly(context_vars);
+  return ToUInt64(EvaluateValue(scope, expression, opts, error), error);
+}
+
+double EvaluateToDouble(lldb::SBFrame frame, const char* expression,
+                        Options opts, lldb::SBError& error) {
+  return ToDouble(EvaluateValue(frame, expression, opts, error), error);
+}
+
+double EvaluateToDouble(lldb::SBValue scope, const char* expression,
+                        Options opts, lldb::SBError& error) {
+  return ToDouble(EvaluateValue(scope, expression, opts, error), error);
+}
+
+double EvaluateToDouble(lldb::SBValue scope,
+                        std::shared_ptr<CompiledExpr> expression,
+                        ContextVariableList context_vars,
+                        lldb::SBError& error) {
+  Options opts = ContextVarsOnly(context_vars);
+  return ToDouble(EvaluateValue(scope, expression, opts, error), error);
+}
+
+bool EvaluateToBool(lldb::SBFrame frame, const char* expression,
+                    Options opts, lldb::SBError& error) {
+  return ToBool(EvaluateValue(frame, expression, opts, error), error);
+}
+
+bool EvaluateToBool(lldb::SBValue scope, const char* expression,
+                    Options opts, lldb::SBError& error) {
+  return ToBool(EvaluateValue(scope, expression, opts, error), error);
+}
+
+bool EvaluateToBool(lldb::SBValue scope,
+                    std::shared_ptr<CompiledExpr> expression,
+                    ContextVariableList context_vars,
+                    lldb::SBError& error) {
+  Options opts = ContextVarsOnly(context_vars);
+  return ToBool(EvaluateValue(scope, expression, opts, error), error);
+}
+
+lldb::addr_t EvaluateToAddress(lldb::SBFrame frame, const char* expression,
+                               Options opts, lldb::SBError& error) {
+  return ToAddress(EvaluateValue(frame, expression, opts, error), error);
+}
+
+lldb::addr_t EvaluateToAddress(lldb::SBValue scope, const char* expression,
+                               Options opts, lldb::SBError& error) {
+  return ToAddress(EvaluateValue(scope, expression, opts, error), error);
+}
+
+lldb::addr_t EvaluateToAddress(lldb::SBValue scope,
+                               std::shared_ptr<CompiledExpr> expression,
+                               ContextVariableList context_vars,
+                               lldb::SBError& error) {
+  Options opts = ContextVarsOnly(context_vars);
+  return ToAddress(EvaluateValue(scope, expression, opts, error), error);
+}
+
+BreakpointCondition::BreakpointCondition(std::string condition, Options opts)
+    : condition_(std::move(condition)), opts_(opts) {}
+
+BreakpointCondition::~BreakpointCondition() = default;
+
+bool BreakpointCondition::Evaluate(lldb::SBFrame frame, lldb::SBError& error) {
+  error.Clear();
+
+  // The identifiers are bound to the variables of a specific frame.
+  lldb::tid_t thread_id = frame.GetThread().GetThreadID();
+  lldb::addr_t cfa = frame.GetCFA();
+  if (!compiled_expr_ || thread_id != thread_id_ || cfa != cfa_) {
+    if (!Compile(frame, error)) {
+      return false;
+    }
+    thread_id_ = thread_id;
+    cfa_ = cfa;
+  }
+
+  Error err;
+  Value ret = interpreter_->Eval(compiled_expr_->tree.get(), err);
+  if (err) {
+    error = CreateError(err.code(), err.message().c_str());
+    return false;
+  }
+  return ret.GetBool();
+}
+
+bool BreakpointCondition::Compile(lldb::SBFrame frame, lldb::SBError& error) {
+  compiled_expr_.reset();
+  interpreter_.reset();
+
+  auto source = SourceManager::Create(condition_);
+  auto context = Context::Create(source, frame);
+  auto compiled_expr =
+      CompileExpressionImpl(source, context, opts_, lldb::SBType(), error);
+  if (error) {
+    return false;
+  }
+
+  TypeSP type = compiled_expr->tree->result_type_deref();
+  if (!type->IsContextuallyConvertibleToBool()) {
     error = CreateError(
-        ErrorCode::kUnknown,
-        "expression isn't parsed in the context of compatible type");
-    return lldb::SBValue();
+        ErrorCode::kInvalidOperandType,
+        llvm::formatv(
+            "value of type {0} is not contextually convertible to 'bool'",
+            TypeDescription(type))
+            .str()
+            .c_str());
+    return false;
   }
 
-  // Cast the given `scope` to the expected type.
-  std::reverse(path.begin(), path.end());
-  for (const auto idx : path) {
-    scope = scope.GetChildAtIndex(idx);
+  auto target = frame.GetThread().GetProcess().GetTarget();
+  interpreter_ = std::make_unique<Interpreter>(target, compiled_expr->source);
+  ConfigureInterpreter(*interpreter_, opts_);
+  compiled_expr_ = std::move(compiled_expr);
+  return true;
+}
+
+struct WatchSet::Watch {
+  size_t index;
+  std::string expression;
+
+  // Not set if the expression failed to compile, `compile_error` is set then.
+  std::shared_ptr<CompiledExpr> compiled_expr;
+  std::unique_ptr<Interpreter> interpreter;
+  lldb::SBError compile_error;
+  // Whether the expression is compiled for the current frame.
+  bool bound = false;
+
+  // Inputs of the last evaluation and the hash of their data.
+  ReadSet reads;
+  llvm::hash_code reads_hash;
+
+  bool evaluated = false;
+  lldb::SBValue value;
+  lldb::SBError error;
+  // Type and data of the result (or the error message), to detect changes.
+  std::string result_type;
+  std::vector<uint8_t> result_data;
+};
+
+// Memory ranges closer to each other than this are read at once.
+static constexpr uint64_t kMaxReadGap = 256;
+
+// Merges the sorted memory `ranges` closer to each other than `max_gap` bytes
+// into spans covering them.
+static std::vector<MemoryRange> MergeRanges(
+    const std::vector<MemoryRange>& ranges, uint64_t max_gap) {
+  std::vector<MemoryRange> spans;
+  for (const auto& range : ranges) {
+    if (spans.empty() ||
+        range.addr > spans.back().addr + spans.back().size + max_gap) {
+      spans.push_back(range);
+      continue;
+    }
+    MemoryRange& span = spans.back();
+    uint64_t end =
+        std::max<uint64_t>(span.addr + span.size, range.addr + range.size);
+    span.size = end - span.addr;
   }
-  assert(scope.IsValid() && "failed to cast scope variable");
+  return spans;
+}
 
-  return EvaluateExpressionImpl(expression, context_vars, scope.GetTarget(),
-                                Value(scope), error);
+static std::vector<uint8_t> GetValueData(lldb::SBValue value) {
+  lldb::SBData data = value.GetData();
+  std::vector<uint8_t> bytes(data.GetByteSize());
+  if (!bytes.empty()) {
+    lldb::SBError ignore;
+    data.ReadRawData(ignore, 0, bytes.data(), bytes.size());
+  }
+  return bytes;
+}
+
+// Reads the inputs of all `reads`, merging the nearby memory ranges into single
+// reads, and returns the hash of the data of each of them.
+static std::vector<llvm::hash_code> HashReads(
+    lldb::SBFrame frame, const std::vector<const ReadSet*>& reads) {
+  lldb::SBProcess process = frame.GetThread().GetProcess();
+
+  struct Span {
+    lldb::addr_t addr;
+    std::vector<uint8_t> data;
+    bool readable;
+  };
+  std::vector<MemoryRange> ranges;
+  for (const ReadSet* read_set : reads) {
+    for (const auto& [range, count] : read_set->memory()) {
+      ranges.push_back(range);
+    }
+  }
+  std::sort(ranges.begin(), ranges.end());
+  std::vector<Span> spans;
+  for (const auto& span : MergeRanges(ranges, kMaxReadGap)) {
+    spans.push_back({span.addr, std::vector<uint8_t>(span.size), false});
+  }
+  for (auto& span : spans) {
+    lldb::SBError error;
+    size_t read = process.ReadMemory(span.addr, span.data.data(),
+                                     span.data.size(), error);
+    span.readable = error.Success() && read == span.data.size();
+  }
+
+  auto hash_range = [&](const MemoryRange& range) {
+    // The span containing the range is the last one starting before it.
+    auto span = std::prev(std::upper_bound(
+        spans.begin(), spans.end(), range.addr,
+        [](lldb::addr_t addr, const Span& s) { return addr < s.addr; }));
+    if (span->readable) {
+      const uint8_t* data = span->data.data() + (range.addr - span->addr);
+      return llvm::hash_combine(
+          true, llvm::hash_combine_range(data, data + range.size));
+    }
+    // A part of the span isn't readable, try the range alone.
+    std::vector<uint8_t> data(range.size);
+    lldb::SBError error;
+    size_t read =
+        process.ReadMemory(range.addr, data.data(), data.size(), error);
+    if (error.Fail() || read != data.size()) {
+      return llvm::hash_value(false);
+    }
+    return llvm::hash_combine(
+        true, llvm::hash_combine_range(data.begin(), data.end()));
+  };
+
+  std::map<std::string, llvm::hash_code> registers;
+  auto hash_register = [&](const std::string& name) {
+    auto it = registers.find(name);
+    if (it == registers.end()) {
+      std::vector<uint8_t> data =
+          GetValueData(frame.FindRegister(name.c_str()));
+      llvm::hash_code hash = llvm::hash_combine_range(data.begin(), data.end());
+      it = registers.emplace(name, hash).first;
+    }
+    return it->second;
+  };
+
+  std::vector<llvm::hash_code> hashes;
+  for (const ReadSet* read_set : reads) {
+    llvm::hash_code hash = llvm::hash_value(read_set->memory().size());
+    for (const auto& [range, count] : read_set->memory()) {
+      hash = llvm::hash_combine(hash, hash_range(range));
+    }
+    for (const auto& [name, count] : read_set->registers()) {
+      hash = llvm::hash_combine(hash, hash_register(name));
+    }
+    hashes.push_back(hash);
+  }
+  return hashes;
+}
+
+WatchSet::WatchSet(Options opts) : opts_(opts) {}
+
+WatchSet::~WatchSet() = default;
+
+size_t WatchSet::Add(std::string expression) {
+  auto watch = std::make_unique<Watch>();
+  watch->index = watches_.size();
+  watch->expression = std::move(expression);
+  watches_.push_back(std::move(watch));
+  return watches_.back()->index;
+}
+
+lldb::SBValue WatchSet::GetValue(size_t index) const {
+  return watches_[index]->value;
+}
+
+lldb::SBError WatchSet::GetError(size_t index) const {
+  return watches_[index]->error;
+}
+
+std::vector<size_t> WatchSet::Update(lldb::SBFrame frame) {
+  // The identifiers are bound to the variables of a specific frame.
+  lldb::tid_t thread_id = frame.GetThread().GetThreadID();
+  lldb::addr_t cfa = frame.GetCFA();
+  if (!bound_ || thread_id != thread_id_ || cfa != cfa_) {
+    for (auto& watch : watches_) {
+      watch->bound = false;
+    }
+    bound_ = true;
+    thread_id_ = thread_id;
+    cfa_ = cfa;
+  }
+
+  // Find the expressions whose inputs might have changed.
+  std::vector<Watch*> stale;
+  std::vector<Watch*> tracked;
+  std::vector<const ReadSet*> tracked_reads;
+  for (auto& watch : watches_) {
+    if (!watch->bound) {
+      Compile(*watch, frame);
+      stale.push_back(watch.get());
+    } else if (watch->reads.has_untracked()) {
+      stale.push_back(watch.get());
+    } else if (watch->interpreter) {
+      tracked.push_back(watch.get());
+      tracked_reads.push_back(&watch->reads);
+    }
+  }
+  std::vector<llvm::hash_code> hashes = HashReads(frame, tracked_reads);
+  for (size_t i = 0; i < tracked.size(); ++i) {
+    if (hashes[i] != tracked[i]->reads_hash) {
+      stale.push_back(tracked[i]);
+    }
+  }
+
+  std::vector<size_t> changed;
+  std::vector<const ReadSet*> stale_reads;
+  num_evaluated_ = 0;
+  for (Watch* watch : stale) {
+    if (Evaluate(*watch)) {
+      changed.push_back(watch->index);
+    }
+    if (watch->interpreter) {
+      ++num_evaluated_;
+    }
+    stale_reads.push_back(&watch->reads);
+  }
+
+  // Remember the data the new results depend on.
+  hashes = HashReads(frame, stale_reads);
+  for (size_t i = 0; i < stale.size(); ++i) {
+    stale[i]->reads_hash = hashes[i];
+  }
+
+  std::sort(changed.begin(), changed.end());
+  return changed;
+}
+
+void WatchSet::Compile(Watch& watch, lldb::SBFrame frame) {
+  watch.bound = true;
+  watch.compiled_expr.reset();
+  watch.interpreter.reset();
+  watch.reads.Clear();
+
+  auto source = SourceManager::Create(watch.expression);
+  auto context = Context::Create(source, frame);
+  auto compiled_expr = CompileExpressionImpl(
+      source, context, opts_, lldb::SBType(), watch.compile_error);
+  if (watch.compile_error.Fail()) {
+    return;
+  }
+
+  auto target = frame.GetThread().GetProcess().GetTarget();
+  watch.interpreter =
+      std::make_unique<Interpreter>(target, compiled_expr->source);
+  // The watches read the process directly and record the reads to their own
+  // read sets.
+  Options opts = opts_;
+  opts.memory_overlay = nullptr;
+  opts.read_set = nullptr;
+  ConfigureInterpreter(*watch.interpreter, opts);
+  watch.interpreter->SetReadSet(&watch.reads);
+  watch.compiled_expr = std::move(compiled_expr);
+}
+
+bool WatchSet::Evaluate(Watch& watch) {
+  lldb::SBValue value;
+  lldb::SBError error = watch.compile_error;
+  if (watch.interpreter) {
+    watch.reads.Clear();
+    Error err;
+    Value ret = watch.interpreter->Eval(watch.compiled_expr->tree.get(), err);
+    if (err) {
+      error = CreateError(err.code(), err.message().c_str());
+      // The inputs of an aborted evaluation are incomplete, retry it at the
+      // next update.
+      if (err.code() == ErrorCode::kBudgetExceeded ||
+          err.code() == ErrorCode::kCancelled) {
+        watch.reads.AddUntracked();
+      }
+    } else {
+      value = ret.inner_value();
+      if (value.GetError().GetError()) {
+        error = value.GetError();
+      }
+    }
+  }
+
+  std::string result_type;
+  std::vector<uint8_t> result_data;
+  if (error.Fail()) {
+    std::string message = error.GetCString() ? error.GetCString() : "";
+    result_data.assign(message.begin(), message.end());
+  } else {
+    result_type = value.GetTypeName() ? value.GetTypeName() : "";
+    result_data = GetValueData(value);
+  }
+
+  bool changed = !watch.evaluated || result_type != watch.result_type ||
+                 result_data != watch.result_data;
+  watch.evaluated = true;
+  watch.value = value;
+  watch.error = error;
+  watch.result_type = std::move(result_type);
+  watch.result_data = std::move(result_data);
+  return changed;
+}
+
+struct AsyncEvaluator::Job {
+  std::string expression;
+  std::promise<EvalResult> result;
+
+  // Set once the expression is compiled.
+  std::shared_ptr<CompiledExpr> compiled_expr;
+  std::unique_ptr<Interpreter> interpreter;
+};
+
+// Memory ranges closer to each other than this are fetched at once. A round
+// trip to a remote process costs more than reading a few more KiB.
+static constexpr uint64_t kMaxFetchGap = 4096;
+
+AsyncEvaluator::AsyncEvaluator(lldb::SBFrame frame, Options opts)
+    : frame_(frame), opts_(opts), fetched_(std::make_unique<FetchSet>()) {
+  opts_.allow_side_effects = false;
+  opts_.read_set = nullptr;
+  opts_.stats = nullptr;
+}
+
+AsyncEvaluator::~AsyncEvaluator() {
+  for (auto& job : pending_) {
+    EvalResult result;
+    result.error =
+        CreateError(ErrorCode::kCancelled, "evaluation was cancelled");
+    job->result.set_value(result);
+  }
+}
+
+std::future<EvalResult> AsyncEvaluator::Evaluate(std::string expression) {
+  auto job = std::make_unique<Job>();
+  job->expression = std::move(expression);
+  std::future<EvalResult> result = job->result.get_future();
+  pending_.push_back(std::move(job));
+  return result;
+}
+
+void AsyncEvaluator::Run() {
+  while (!pending_.empty()) {
+    ++num_rounds_;
+    std::vector<std::unique_ptr<Job>> stopped;
+    for (auto& job : pending_) {
+      if (!Step(*job)) {
+        stopped.push_back(std::move(job));
+      }
+    }
+    pending_ = std::move(stopped);
+    // Every stopped evaluation has queued the read it waits for, so it gets
+    // further in the next round.
+    Fetch();
+  }
+}
+
+bool AsyncEvaluator::Step(Job& job) {
+  EvalResult result;
+  if (!job.interpreter) {
+    auto source = SourceManager::Create(job.expression);
+    auto context = Context::Create(source, frame_);
+    job.compiled_expr = CompileExpressionImpl(source, context, opts_,
+                                              lldb::SBType(), result.error);
+    if (result.error.Fail()) {
+      job.result.set_value(result);
+      return true;
+    }
+    auto target = frame_.GetThread().GetProcess().GetTarget();
+    job.interpreter =
+        std::make_unique<Interpreter>(target, job.compiled_expr->source);
+    ConfigureInterpreter(*job.interpreter, opts_);
+    job.interpreter->SetFetchSet(fetched_.get());
+  }
+
+  Error err;
+  Value ret = job.interpreter->Eval(job.compiled_expr->tree.get(), err);
+  if (job.interpreter->read_pending()) {
+    return false;
+  }
+  if (err) {
+    result.error = CreateError(err.code(), err.message().c_str());
+  } else {
+    // The process memory may be outdated, return the value seen in the overlay.
+    if (opts_.memory_overlay != nullptr) {
+      ret = ret.ResolveOverlay();
+    }
+    result.value = ret.inner_value();
+    if (result.value.GetError().GetError()) {
+      result.error = result.value.GetError();
+    }
+  }
+  job.result.set_value(result);
+  return true;
+}
+
+void AsyncEvaluator::Fetch() {
+  lldb::SBProcess process = frame_.GetThread().GetProcess();
+  std::vector<uint8_t> buffer;
+  auto fetch = [&](lldb::addr_t addr, uint64_t size) {
+    ++num_fetches_;
+    buffer.resize(size);
+    lldb::SBError error;
+    size_t read = process.ReadMemory(addr, buffer.data(), size, error);
+    return error.Success() && read == size;
+  };
+
+  // The data is dropped, the reads only fill LLDB's memory cache.
+  std::vector<MemoryRange> ranges = fetched_->TakeQueued();
+  for (const auto& span : MergeRanges(ranges, kMaxFetchGap)) {
+    // The whole span is cached, not only the queued ranges.
+    fetched_->AddFetched(span.addr, span.size);
+    if (fetch(span.addr, span.size)) {
+      continue;
+    }
+    // A part of the span isn't readable, fetch the ranges alone. The reads
+    // which fail again are reported by the evaluations.
+    for (const auto& range : ranges) {
+      if (range.addr >= span.addr && range.addr - span.addr < span.size) {
+        fetch(range.addr, range.size);
+      }
+    }
+  }
 }
 
 }  // namespace lldb_eval
@@ -17,8 +17,13 @@
 #ifndef LLDB_EVAL_API_H_
 #define LLDB_EVAL_API_H_
 
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "lldb-eval/budget.h"
 #include "lldb/API/SBError.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBValue.h"
@@ -42,7 +47,13 @@ namespace lldb_eval {
 // Including full definitions of the following classes also includes many
 // unnecessary structures from LLVM. Forward declaration is sufficient.
 class AstNode;
-class SourceManager;
+class FetchSet;
+class Interpreter;
+class MemoryOverlay;
+class ReadSet;
+class SourceText;
+class TypeCache;
+struct EvalStats;
 
 // Context variables (aka. convenience variables) are variables living entirely
 // within LLDB. They are prefixed with '$' and created via expression evaluation
@@ -77,18 +88,136 @@ struct Options {
   bool allow_side_effects = false;
   ContextArgumentList context_args = {};
   ContextVariableList context_vars = {};
+  // If set, side effects are written to the overlay instead of the process
+  // memory, and reads see the data written to it. See `MemoryOverlay`.
+  MemoryOverlay* memory_overlay = nullptr;
+  // If set, the memory ranges and the registers read by the evaluation are
+  // added to it. See `ReadSet`.
+  ReadSet* read_set = nullptr;
+
+  // If set, the statistics of the compilation and the evaluation are added to
+  // it. See `EvalStats`. For a timeline of a single evaluation, enable LLVM's
+  // time trace profiler (`llvm::timeTraceProfilerInitialize`), which records
+  // the lexing, the parsing, the lookups and the evaluation of every AST node.
+  EvalStats* stats = nullptr;
+
+  // Limits of the evaluation, see `EvalBudget`.
+  EvalBudget budget;
+  // If set, the evaluation fails once the token is cancelled.
+  const CancellationToken* cancellation = nullptr;
+
+  // If set, the types resolved by name are shared through it with other
+  // compilations. It must be created for the target of the evaluation, see
+  // `TypeCache`.
+  TypeCache* type_cache = nullptr;
 };
 
+// Compiled expressions keep only the expression text next to the AST (and not
+// the clang::SourceManager used for parsing), so that caching a large number of
+// them is cheap. They aren't modified by the evaluation.
 struct CompiledExpr {
-  std::shared_ptr<SourceManager> source;
+  std::shared_ptr<const SourceText> source;
   std::unique_ptr<AstNode> tree;
   lldb::SBType scope;
   lldb::SBType result_type;
 
-  CompiledExpr(std::shared_ptr<SourceManager> source,
+  CompiledExpr(std::shared_ptr<const SourceText> source,
                std::unique_ptr<AstNode> tree, lldb::SBType scope);
 };
 
+// Condition of a conditional breakpoint. The condition is compiled once, with
+// the identifiers bound to the variables of the frame, and evaluated straight
+// to `bool` on every hit, without creating an lldb::SBValue for the result.
+// It's compiled again only if the breakpoint is hit in a different frame (e.g.
+// in another thread or a recursive call).
+//
+// Use one instance per breakpoint location. The context arguments and
+// variables of `opts` must outlive the condition. Not thread-safe.
+class LLDB_EVAL_API BreakpointCondition {
+ public:
+  explicit BreakpointCondition(std::string condition, Options opts = {});
+  ~BreakpointCondition();
+
+  BreakpointCondition(const BreakpointCondition&) = delete;
+  BreakpointCondition& operator=(const BreakpointCondition&) = delete;
+
+  // Evaluates the condition in the `frame`. Returns false if the evaluation
+  // fails, the `error` is set in that case.
+  bool Evaluate(lldb::SBFrame frame, lldb::SBError& error);
+
+ private:
+  bool Compile(lldb::SBFrame frame, lldb::SBError& error);
+
+  std::string condition_;
+  Options opts_;
+  std::shared_ptr<CompiledExpr> compiled_expr_;
+  std::unique_ptr<Interpreter> interpreter_;
+
+  // Frame the identifiers of `compiled_expr_` are bound to.
+  lldb::tid_t thread_id_ = 0;
+  lldb::addr_t cfa_ = 0;
+};
+
+// Set of watch expressions, brought up to date with the process after each
+// stop. Every evaluation records the memory and the registers it reads. An
+// update reads the dependencies of all expressions (merging nearby memory
+// ranges into single reads), compares their hashes with the ones from the
+// previous evaluation and evaluates again only the expressions whose inputs
+// changed. Expressions that read values LLDB can't locate (e.g. variables
+// optimized into registers) are always evaluated.
+//
+// The identifiers are bound to the variables of the frame, like in
+// `BreakpointCondition`. The expressions are expected to be free of side
+// effects, the memory overlay and the read set of `opts` aren't used. The
+// context arguments and variables of `opts` must outlive the watch set.
+// Expressions cancelled or stopped by the budget are evaluated again at the
+// next update. Not thread-safe.
+class LLDB_EVAL_API WatchSet {
+ public:
+  explicit WatchSet(Options opts = {});
+  ~WatchSet();
+
+  WatchSet(const WatchSet&) = delete;
+  WatchSet& operator=(const WatchSet&) = delete;
+
+  // Adds an expression, it's evaluated on the next update. Returns the index
+  // of the expression.
+  size_t Add(std::string expression);
+
+  size_t size() const { return watches_.size(); }
+
+  // Updates the results to the state of the process stopped in the `frame`.
+  // Returns the indexes of the expressions whose results (or errors) changed
+  // since the previous update, in increasing order. Only the data of the
+  // result itself is compared, e.g. a pointer result doesn't change if only
+  // the pointee does.
+  std::vector<size_t> Update(lldb::SBFrame frame);
+
+  // Result of the expression at `index` as of the last update. Lvalue results
+  // refer to the process memory, which may have changed since.
+  lldb::SBValue GetValue(size_t index) const;
+  lldb::SBError GetError(size_t index) const;
+
+  // Number of expressions evaluated by the last update.
+  size_t num_evaluated() const { return num_evaluated_; }
+
+ private:
+  struct Watch;
+
+  void Compile(Watch& watch, lldb::SBFrame frame);
+  // Evaluates the expression, returns true if the result has changed.
+  bool Evaluate(Watch& watch);
+
+  Options opts_;
+  std::vector<std::unique_ptr<Watch>> watches_;
+  size_t num_evaluated_ = 0;
+
+  // Frame the identifiers of the expressions are bound to.
+  bool bound_ = false;
+  lldb::tid_t thread_id_ = 0;
+  lldb::addr_t cfa_ = 0;
+};
+
 LLDB_EVAL_API
 lldb::SBValue EvaluateExpression(lldb::SBFrame frame, const char* expression,
                                  lldb::SBError& error);
@@ -129,6 +258,144 @@ lldb::SBValue EvaluateExpression(lldb::SBValue scope,
                                  ContextVariableList context_vars,
                                  lldb::SBError& error);
 
+// Evaluation to native results, without creating an lldb::SBValue for the
+// result. The result is converted as if by `static_cast`, or contextually to
+// `bool` in `EvaluateToBool`. `EvaluateToAddress` accepts pointers, arrays and
+// integers. If the evaluation fails or the result can't be converted, `error`
+// is set and 0 (`false`, `LLDB_INVALID_ADDRESS`) is returned.
+
+LLDB_EVAL_API
+int64_t EvaluateToInt64(lldb::SBFrame frame, const char* expression,
+                        Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+int64_t EvaluateToInt64(lldb::SBValue scope, const char* expression,
+                        Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+int64_t EvaluateToInt64(lldb::SBValue scope,
+                        std::shared_ptr<CompiledExpr> expression,
+                        ContextVariableList context_vars,
+                        lldb::SBError& error);
+
+LLDB_EVAL_API
+uint64_t EvaluateToUInt64(lldb::SBFrame frame, const char* expression,
+                          Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+uint64_t EvaluateToUInt64(lldb::SBValue scope, const char* expression,
+                          Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+uint64_t EvaluateToUInt64(lldb::SBValue scope,
+                          std::shared_ptr<CompiledExpr> expression,
+                          ContextVariableList context_vars,
+                          lldb::SBError& error);
+
+LLDB_EVAL_API
+double EvaluateToDouble(lldb::SBFrame frame, const char* expression,
+                        Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+double EvaluateToDouble(lldb::SBValue scope, const char* expression,
+                        Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+double EvaluateToDouble(lldb::SBValue scope,
+                        std::shared_ptr<CompiledExpr> expression,
+                        ContextVariableList context_vars,
+                        lldb::SBError& error);
+
+LLDB_EVAL_API
+bool EvaluateToBool(lldb::SBFrame frame, const char* expression,
+                    Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+bool EvaluateToBool(lldb::SBValue scope, const char* expression,
+                    Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+bool EvaluateToBool(lldb::SBValue scope,
+                    std::shared_ptr<CompiledExpr> expression,
+                    ContextVariableList context_vars,
+                    lldb::SBError& error);
+
+LLDB_EVAL_API
+lldb::addr_t EvaluateToAddress(lldb::SBFrame frame, const char* expression,
+                               Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+lldb::addr_t EvaluateToAddress(lldb::SBValue scope, const char* expression,
+                               Options opts, lldb::SBError& error);
+
+LLDB_EVAL_API
+lldb::addr_t EvaluateToAddress(lldb::SBValue scope,
+                               std::shared_ptr<CompiledExpr> expression,
+                               ContextVariableList context_vars,
+                               lldb::SBError& error);
+
+// Evaluations aren't thread-safe: compiling and evaluating query the types
+// through `SBType`, which doesn't take LLDB's API lock, so two evaluations in
+// the same target must not run at the same time.
+
+// Result of an evaluation in `AsyncEvaluator`.
+struct EvalResult {
+  lldb::SBValue value;
+  lldb::SBError error;
+};
+
+// Evaluates many expressions in a frame in rounds, batching the memory reads
+// of all of them. A round runs every pending evaluation until it finishes or
+// stops at a read of memory which hasn't been fetched yet (see `FetchSet`).
+// Then the memory all the stopped evaluations wait for is fetched at once,
+// merging nearby ranges into single reads, and the evaluations are run again
+// in the next round. The fetched memory is kept in LLDB's memory cache, so
+// following a chain of N pointers takes N + 1 rounds, and the number of round
+// trips to a remote process depends on the longest chain rather than on the
+// total number of reads. Nothing is gained if the memory cache is disabled.
+//
+// The identifiers are bound to the variables of the frame. Side effects aren't
+// allowed, as the evaluations are run more than once, and the read set and the
+// stats of `opts` aren't used. The context arguments and variables of `opts`
+// must outlive the evaluator. Not thread-safe, but the results can be waited
+// for on any thread.
+class LLDB_EVAL_API AsyncEvaluator {
+ public:
+  explicit AsyncEvaluator(lldb::SBFrame frame, Options opts = {});
+  // Evaluations which haven't finished yet fail with `ErrorCode::kCancelled`.
+  ~AsyncEvaluator();
+
+  AsyncEvaluator(const AsyncEvaluator&) = delete;
+  AsyncEvaluator& operator=(const AsyncEvaluator&) = delete;
+
+  // Queues the evaluation of the `expression`. The result is ready once it's
+  // finished by `Run()`.
+  std::future<EvalResult> Evaluate(std::string expression);
+
+  // Runs rounds until all queued evaluations finish.
+  void Run();
+
+  // Rounds run and memory reads made by the evaluator so far.
+  size_t num_rounds() const { return num_rounds_; }
+  size_t num_fetches() const { return num_fetches_; }
+
+ private:
+  struct Job;
+
+  // Runs the evaluation until it finishes or stops at a pending read. Returns
+  // true if the evaluation has finished.
+  bool Step(Job& job);
+  // Fetches the memory the stopped evaluations wait for.
+  void Fetch();
+
+  lldb::SBFrame frame_;
+  Options opts_;
+  std::unique_ptr<FetchSet> fetched_;
+  std::vector<std::unique_ptr<Job>> pending_;
+  size_t num_rounds_ = 0;
+  size_t num_fetches_ = 0;
+};
+
 }  // namespace lldb_eval
 
 #endif  // LLDB_EVAL_API_H_
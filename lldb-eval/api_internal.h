@@ -0,0 +1,45 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_API_INTERNAL_H_
+#define LLDB_EVAL_API_INTERNAL_H_
+
+#include <memory>
+
+#include "lldb-eval/api.h"
+#include "lldb-eval/context.h"
+#include "lldb-eval/eval.h"
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBType.h"
+
+// Building blocks of the evaluation APIs, shared by the ones implemented
+// outside of api.cc (e.g. `Tracer`), so that every option is handled in a
+// single place.
+
+namespace lldb_eval {
+
+// Parses the expression of `source` in the context `ctx`, applying the parsing
+// options. Returns nullptr and sets the `error` if the parsing fails.
+std::shared_ptr<CompiledExpr> CompileExpressionImpl(
+    std::shared_ptr<SourceManager> source, std::shared_ptr<Context> ctx,
+    Options opts, lldb::SBType scope, lldb::SBError& error);
+
+// Applies the evaluation options to the interpreter.
+void ConfigureInterpreter(Interpreter& eval, const Options& opts);
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_API_INTERNAL_H_
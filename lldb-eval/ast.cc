@@ -139,6 +139,49 @@ TypeSP AstNode::result_type_deref() const {
   return type->IsReferenceType() ? type->GetDereferencedType() : type;
 }
 
+namespace {
+
+class NodeKindNameVisitor : public Visitor {
+ public:
+  const char* name() const { return name_; }
+
+  void Visit(const ErrorNode*) override { name_ = "ErrorNode"; }
+  void Visit(const LiteralNode*) override { name_ = "LiteralNode"; }
+  void Visit(const IdentifierNode*) override { name_ = "IdentifierNode"; }
+  void Visit(const SizeOfNode*) override { name_ = "SizeOfNode"; }
+  void Visit(const BuiltinFunctionCallNode*) override {
+    name_ = "BuiltinFunctionCallNode";
+  }
+  void Visit(const CStyleCastNode*) override { name_ = "CStyleCastNode"; }
+  void Visit(const CxxStaticCastNode*) override {
+    name_ = "CxxStaticCastNode";
+  }
+  void Visit(const CxxReinterpretCastNode*) override {
+    name_ = "CxxReinterpretCastNode";
+  }
+  void Visit(const MemberOfNode*) override { name_ = "MemberOfNode"; }
+  void Visit(const ArraySubscriptNode*) override {
+    name_ = "ArraySubscriptNode";
+  }
+  void Visit(const BinaryOpNode*) override { name_ = "BinaryOpNode"; }
+  void Visit(const UnaryOpNode*) override { name_ = "UnaryOpNode"; }
+  void Visit(const TernaryOpNode*) override { name_ = "TernaryOpNode"; }
+  void Visit(const SmartPtrToPtrDecay*) override {
+    name_ = "SmartPtrToPtrDecay";
+  }
+
+ private:
+  const char* name_ = "";
+};
+
+}  // namespace
+
+const char* GetNodeKindName(const AstNode* node) {
+  NodeKindNameVisitor v;
+  node->Accept(&v);
+  return v.name();
+}
+
 void ErrorNode::Accept(Visitor* v) const { v->Visit(this); }
 
 void LiteralNode::Accept(Visitor* v) const { v->Visit(this); }
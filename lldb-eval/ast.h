@@ -511,6 +511,9 @@ class Visitor {
   virtual void Visit(const SmartPtrToPtrDecay* node) = 0;
 };
 
+// Returns the name of the node's class, e.g. "BinaryOpNode".
+const char* GetNodeKindName(const AstNode* node);
+
 }  // namespace lldb_eval
 
 #endif  // LLDB_EVAL_AST_H_
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_BUDGET_H_
+#define LLDB_EVAL_BUDGET_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace lldb_eval {
+
+// Limits of the work done by a single evaluation, zero means no limit. The
+// interpreter checks them before and after evaluating each AST node and after
+// each read made by `__findnonnull`, and fails the evaluation with
+// `ErrorCode::kBudgetExceeded` once one is exceeded.
+struct EvalBudget {
+  // Reads of the values stored in the process (memory or registers) and the
+  // bytes of those values. These are a proxy for the round trips to the debug
+  // server, not a count of them: LLDB serves many reads from its memory cache,
+  // and one read of an object may fetch the memory of many of its members.
+  uint64_t max_value_reads = 0;
+  uint64_t max_bytes_read = 0;
+  std::chrono::nanoseconds max_time{0};
+};
+
+// Cancels the evaluations using it (see `Options::cancellation`) from another
+// thread. They fail with `ErrorCode::kCancelled` at the next budget check.
+class CancellationToken {
+ public:
+  void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+  void Reset() { cancelled_.store(false, std::memory_order_relaxed); }
+  bool IsCancelled() const {
+    return cancelled_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<bool> cancelled_{false};
+};
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_BUDGET_H_
@@ -14,6 +14,7 @@
 
 #include "lldb-eval/context.h"
 
+#include <cassert>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -23,6 +24,7 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
+#include "lldb-eval/stats.h"
 #include "lldb-eval/value.h"
 #include "lldb/API/SBExecutionContext.h"
 #include "lldb/API/SBFrame.h"
@@ -36,6 +38,7 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/FormatAdapters.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/TimeProfiler.h"
 
 #if LLVM_VERSION_MAJOR < 16
 #include "llvm/ADT/Triple.h"
@@ -54,7 +57,8 @@ lldb::SBValue CreateSBValue(lldb::SBTarget target, const void* bytes,
 
   // CreateValueFromData copies the data referenced by `bytes` to its own
   // storage. `value` should be valid up until this point.
-  return target.CreateValueFromData("result", data, type);
+  return lldb_eval::CountCreatedValue(
+      target.CreateValueFromData("result", data, type));
 }
 
 }  // namespace
@@ -80,6 +84,14 @@ void Context::SetContextArgs(
   context_args_ = std::move(context_args);
 }
 
+void Context::SetTypeCache(TypeCache* type_cache) {
+  bool same_target =
+      type_cache == nullptr || type_cache->target() == ctx_.GetTarget();
+  assert(same_target && "TypeCache is shared between targets");
+  // In release builds the lookups bypass a cache of another target.
+  type_cache_ = same_target ? type_cache : nullptr;
+}
+
 Context::Context(std::shared_ptr<SourceManager> sm,
                  lldb::SBExecutionContext ctx, TypeSP scope)
     : sm_(std::move(sm)), ctx_(std::move(ctx)), scope_(std::move(scope)) {
@@ -94,8 +106,14 @@ Context::Context(std::shared_ptr<SourceManager> sm,
 TypeSP Context::GetBasicType(lldb::BasicType basic_type) {
   auto type = basic_types_.find(basic_type);
   if (type != basic_types_.end()) {
+    if (stats_ != nullptr) {
+      ++stats_->basic_type_hits;
+    }
     return type->second;
   }
+  if (stats_ != nullptr) {
+    ++stats_->basic_type_misses;
+  }
 
   // Get the basic type from the target and cache it for future calls.
   TypeSP ret = LLDBType::CreateSP(ctx_.GetTarget().GetBasicType(basic_type));
@@ -141,6 +159,23 @@ TypeSP Context::GetEmptyType() const {
 }
 
 TypeSP Context::ResolveTypeByName(const std::string& name) const {
+  llvm::TimeTraceScope trace("ResolveTypeByName", name);
+  ScopedStatsTimer timer(stats_ ? &stats_->type_lookups : nullptr);
+
+  if (type_cache_ == nullptr) {
+    return FindTypeByName(name);
+  }
+  if (TypeSP type = type_cache_->Find(name)) {
+    return type;
+  }
+  TypeSP type = FindTypeByName(name);
+  if (type->IsValid()) {
+    type_cache_->Insert(name, type);
+  }
+  return type;
+}
+
+TypeSP Context::FindTypeByName(const std::string& name) const {
   // TODO(b/163308825): Do scope-aware type lookup. Look for the types defined
   // in the current scope (function, class, namespace) and prioritize them.
 
@@ -199,7 +234,10 @@ TypeSP Context::ResolveTypeByName(const std::string& name) const {
 }
 
 static lldb::SBValue LookupStaticIdentifier(lldb::SBTarget target,
-                                            const llvm::StringRef& name_ref) {
+                                            const llvm::StringRef& name_ref,
+                                            EvalStats* stats) {
+  ScopedStatsTimer timer(stats ? &stats->global_lookups : nullptr);
+
   // List global variable with the same "basename". There can be many matches
   // from other scopes (namespaces, classes), so we do additional filtering
   // later.
@@ -210,7 +248,7 @@ static lldb::SBValue LookupStaticIdentifier(lldb::SBTarget target,
   // can return strings like "::globarVar", "ns::i" or "int const ns::foo"
   // depending on the version and the platform.
   for (uint32_t i = 0; i < values.GetSize(); ++i) {
-    lldb::SBValue val = values.GetValueAtIndex(i);
+    lldb::SBValue val = CountCreatedValue(values.GetValueAtIndex(i));
     llvm::StringRef val_name = val.GetName();
 
     if (val_name == name_ref ||
@@ -226,6 +264,9 @@ static lldb::SBValue LookupStaticIdentifier(lldb::SBTarget target,
 
 std::unique_ptr<ParserContext::IdentifierInfo> Context::LookupIdentifier(
     const std::string& name) const {
+  llvm::TimeTraceScope trace("LookupIdentifier", name);
+  ScopedStatsTimer timer(stats_ ? &stats_->identifier_lookups : nullptr);
+
   // Context arguments take precedence over other identifiers (local/global
   // variables, enum values, registers).
   auto context_arg = context_args_.find(name);
@@ -239,7 +280,8 @@ std::unique_ptr<ParserContext::IdentifierInfo> Context::LookupIdentifier(
   // Will return an invalid value in case the requested register doesn't exist.
   if (name_ref.startswith("$")) {
     const char* reg_name = name_ref.drop_front(1).data();
-    return IdentifierInfo::FromValue(ctx_.GetFrame().FindRegister(reg_name));
+    return IdentifierInfo::FromValue(
+        CountCreatedValue(ctx_.GetFrame().FindRegister(reg_name)));
   }
 
   // Internally values don't have global scope qualifier in their names and
@@ -257,14 +299,16 @@ std::unique_ptr<ParserContext::IdentifierInfo> Context::LookupIdentifier(
       // Lookup in the current frame.
       lldb::SBFrame frame = ctx_.GetFrame();
       // Try looking for a local variable in current scope.
-      lldb::SBValue value = frame.FindVariable(name_ref.data());
+      lldb::SBValue value =
+          CountCreatedValue(frame.FindVariable(name_ref.data()));
       if (value) {
         // Force static value, otherwise we can end up with the "real" type.
         return IdentifierInfo::FromValue(value.GetStaticValue());
       }
       // Try looking for an instance variable (class member).
-      value =
-          frame.FindVariable("this").GetChildMemberWithName(name_ref.data());
+      lldb::SBValue this_value = CountCreatedValue(frame.FindVariable("this"));
+      value = CountCreatedValue(
+          this_value.GetChildMemberWithName(name_ref.data()));
       if (value) {
         // Force static value, otherwise we can end up with the "real" type.
         return IdentifierInfo::FromValue(value.GetStaticValue());
@@ -296,16 +340,18 @@ std::unique_ptr<ParserContext::IdentifierInfo> Context::LookupIdentifier(
     const char* type_name = scope_->GetCanonicalType()->GetName().data();
     std::string name_with_type_prefix =
         llvm::formatv("{0}::{1}", type_name, name_ref).str();
-    value = LookupStaticIdentifier(ctx_.GetTarget(), name_with_type_prefix);
+    value = LookupStaticIdentifier(ctx_.GetTarget(), name_with_type_prefix,
+                                   stats_);
   }
 
   // Lookup a regular global variable.
   if (!value) {
-    value = LookupStaticIdentifier(ctx_.GetTarget(), name_ref);
+    value = LookupStaticIdentifier(ctx_.GetTarget(), name_ref, stats_);
   }
 
   // Try looking up enum value.
   if (!value && name_ref.contains("::")) {
+    ScopedStatsTimer timer(stats_ ? &stats_->enum_lookups : nullptr);
     auto [enum_typename, enumerator_name] = name_ref.rsplit("::");
 
     auto type = ResolveTypeByName(enum_typename.str());
@@ -323,7 +369,7 @@ std::unique_ptr<ParserContext::IdentifierInfo> Context::LookupIdentifier(
 
   // Last resort, lookup as a register (e.g. `rax` or `rip`).
   if (!value) {
-    value = ctx_.GetFrame().FindRegister(name_ref.data());
+    value = CountCreatedValue(ctx_.GetFrame().FindRegister(name_ref.data()));
   }
 
   // Force static value, otherwise we can end up with the "real" type.
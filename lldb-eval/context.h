@@ -27,6 +27,7 @@
 #include "lldb/API/SBType.h"
 #include "lldb/API/SBValue.h"
 #include "parser_context.h"
+#include "type_cache.h"
 #include "value.h"
 
 namespace lldb_eval {
@@ -44,6 +45,13 @@ class SourceManager {
 
   clang::SourceManager& GetSourceManager() const { return smff_->get(); }
 
+  // Returns a snapshot of the expression text, which can outlive the source
+  // manager and is sufficient for formatting diagnostics for the nodes of the
+  // parsed AST. Should be called after parsing.
+  std::shared_ptr<const SourceText> GetSourceText() const {
+    return SourceText::Create(expr_, smff_->get());
+  }
+
  private:
   explicit SourceManager(std::string expr);
 
@@ -121,6 +129,10 @@ class Context : public ParserContext {
 
   void SetContextArgs(std::unordered_map<std::string, TypeSP> context_args);
 
+  // Shares the types resolved by name with other contexts, see `TypeCache`.
+  // The cache must belong to the target of the context.
+  void SetTypeCache(TypeCache* type_cache);
+
  public:
   TypeSP GetBasicType(lldb::BasicType basic_type) override;
   TypeSP GetEmptyType() const override;
@@ -135,6 +147,9 @@ class Context : public ParserContext {
   Context(std::shared_ptr<SourceManager> sm, lldb::SBExecutionContext ctx,
           TypeSP scope);
 
+  // Looks up the type in the target, without the cache.
+  TypeSP FindTypeByName(const std::string& name) const;
+
  private:
   std::shared_ptr<SourceManager> sm_;
 
@@ -153,6 +168,8 @@ class Context : public ParserContext {
 
   // Cache of the basic types for the current target.
   std::unordered_map<lldb::BasicType, TypeSP> basic_types_;
+
+  TypeCache* type_cache_ = nullptr;
 };
 
 }  // namespace lldb_eval
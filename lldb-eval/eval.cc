@@ -26,6 +26,7 @@
 #include "lldb/lldb-enumerations.h"
 #include "llvm/ADT/APSInt.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/TimeProfiler.h"
 
 namespace lldb_eval {
 
@@ -176,15 +177,15 @@ static Value EvaluateMemberOf(Value value, const std::vector<uint32_t>& path) {
   member_val.SetPreferSyntheticValue(false);
   for (uint32_t idx : path) {
     // Force static value, otherwise we can end up with the "real" type.
-    member_val = member_val.GetChildAtIndex(idx, lldb::eNoDynamicValues,
-                                            /*can_create_synthetic*/ false);
+    member_val = CountCreatedValue(member_val.GetChildAtIndex(
+        idx, lldb::eNoDynamicValues, /*can_create_synthetic*/ false));
   }
   assert(member_val && "invalid ast: invalid member access");
 
   // If value is a reference, derefernce it to get to the underlying type. All
   // operations on a reference should be actually operations on the referent.
   if (member_val.GetType().IsReferenceType()) {
-    member_val = member_val.Dereference();
+    member_val = CountCreatedValue(member_val.Dereference());
   }
 
   return Value(member_val);
@@ -198,12 +199,17 @@ static Value CastDerivedToBaseType(lldb::SBTarget target, Value value,
   assert(!idx.empty() && "invalid ast: children sequence should be non-empty");
 
   // The `value` can be a pointer, but GetChildAtIndex works for pointers too.
+  // LLDB follows the pointer stored in the process though, so the pointer has
+  // to be resolved first in case it was overwritten in the memory overlay.
+  if (value.IsPointer()) {
+    value = value.ResolveOverlay();
+  }
   lldb::SBValue inner_value = value.inner_value();
   inner_value.SetPreferSyntheticValue(false);
   for (const uint32_t i : idx) {
     // Force static value, otherwise we can end up with the "real" type.
-    inner_value = inner_value.GetChildAtIndex(i, lldb::eNoDynamicValues,
-                                              /*can_create_synthetic*/ false);
+    inner_value = CountCreatedValue(inner_value.GetChildAtIndex(
+        i, lldb::eNoDynamicValues, /*can_create_synthetic*/ false));
   }
 
   // At this point type of `inner_value` should be the dereferenced target type.
@@ -220,7 +226,8 @@ static Value CastDerivedToBaseType(lldb::SBTarget target, Value value,
   assert(CompareTypes(inner_value_type, type->GetDereferencedType()) &&
          "casted value doesn't match the desired type");
 
-  return Value(inner_value.Cast(ToSBType(type->GetDereferencedType())));
+  lldb::SBType base_type = ToSBType(type->GetDereferencedType());
+  return Value(CountCreatedValue(inner_value.Cast(base_type)));
 }
 
 static Value CastBaseToDerivedType(lldb::SBTarget target, Value value,
@@ -247,12 +254,14 @@ static Value CastBaseToDerivedType(lldb::SBTarget target, Value value,
 }
 
 Interpreter::Interpreter(lldb::SBTarget target,
-                         std::shared_ptr<SourceManager> sm)
-    : target_(std::move(target)), sm_(std::move(sm)) {}
+                         std::shared_ptr<const SourceText> source)
+    : target_(std::move(target)), source_(std::move(source)) {}
 
 Interpreter::Interpreter(lldb::SBTarget target,
-                         std::shared_ptr<SourceManager> sm, Value scope)
-    : target_(std::move(target)), sm_(std::move(sm)), scope_(std::move(scope)) {
+                         std::shared_ptr<const SourceText> source, Value scope)
+    : target_(std::move(target)),
+      source_(std::move(source)),
+      scope_(std::move(scope)) {
   // If `scope_` is a reference, dereference it. All operations on a reference
   // should be operations on the referent.
   if (scope_.IsValid() && scope_.type()->IsReferenceType()) {
@@ -265,10 +274,57 @@ void Interpreter::SetContextVars(
   context_vars_ = std::move(context_vars);
 }
 
+void Interpreter::SetMemoryOverlay(MemoryOverlay* overlay) {
+  overlay_ = overlay;
+  scope_.SetMemoryOverlay(overlay);
+}
+
+void Interpreter::SetReadSet(ReadSet* reads) { reads_ = reads; }
+
+void Interpreter::SetFetchSet(FetchSet* fetched) { fetched_ = fetched; }
+
+void Interpreter::SetStats(EvalStats* stats) { stats_ = stats; }
+
+void Interpreter::SetBudget(EvalBudget budget) {
+  budget_ = budget;
+  limited_ = cancellation_ != nullptr || budget_.max_value_reads > 0 ||
+             budget_.max_bytes_read > 0 || budget_.max_time.count() > 0;
+}
+
+void Interpreter::SetCancellationToken(const CancellationToken* cancellation) {
+  cancellation_ = cancellation;
+  SetBudget(budget_);
+}
+
 Value Interpreter::Eval(const AstNode* tree, Error& error) {
   error_.Clear();
-  // Evaluate an AST.
-  EvalNode(tree);
+  read_pending_ = false;
+  if (limited_) {
+    start_time_ = std::chrono::steady_clock::now();
+    start_value_reads_ = GetNumValueReads();
+    start_bytes_read_ = GetNumBytesRead();
+  }
+  uint64_t created_values = 0, value_reads = 0, bytes_read = 0;
+  if (stats_ != nullptr) {
+    created_values = GetNumCreatedValues();
+    value_reads = GetNumValueReads();
+    bytes_read = GetNumBytesRead();
+  }
+  {
+    llvm::TimeTraceScope trace("Evaluate");
+    ScopedStatsTimer timer(stats_ ? &stats_->eval : nullptr);
+    // Evaluate an AST.
+    EvalNode(tree);
+    // Write back the side effects, including those preceding an error.
+    FlushWrites();
+  }
+  if (stats_ != nullptr) {
+    stats_->created_values += GetNumCreatedValues() - created_values;
+    stats_->value_reads += GetNumValueReads() - value_reads;
+    stats_->bytes_read += GetNumBytesRead() - bytes_read;
+  }
+  // The result mustn't refer to the write-back overlay of this interpreter.
+  result_.SetMemoryOverlay(overlay_);
   // Set the error.
   error = error_;
   // Return the computed result. If there was an error, it will be invalid.
@@ -276,10 +332,28 @@ Value Interpreter::Eval(const AstNode* tree, Error& error) {
 }
 
 Value Interpreter::EvalNode(const AstNode* node, FlowAnalysis* flow) {
+  llvm::TimeTraceScope trace(GetNodeKindName(node));
+  ScopedStatsTimer timer(stats_ ? &stats_->nodes[GetNodeKindName(node)]
+                                : nullptr);
+  if (limited_ && !CheckBudget(node->location())) {
+    result_ = Value();
+    return result_;
+  }
   // Set up the evaluation context for the current node.
   flow_analysis_chain_.push_back(flow);
   // Traverse an AST pointed by the `node`.
   node->Accept(this);
+  // Fail as soon as the reads of the node exceed the budget.
+  if (limited_ && !error_ && !CheckBudget(node->location())) {
+    result_ = Value();
+  }
+  // Values in the process memory are read from (and written to) the overlay.
+  // Bit-fields are never written to the overlay, see `PrepareWrite`.
+  if (!node->is_bitfield()) {
+    result_.SetMemoryOverlay(active_overlay());
+  } else if (result_) {
+    PrepareBitFieldRead(node, result_);
+  }
   // Cleanup the context.
   flow_analysis_chain_.pop_back();
   // Return the computed value for convenience. The caller is responsible for
@@ -290,7 +364,143 @@ Value Interpreter::EvalNode(const AstNode* node, FlowAnalysis* flow) {
 void Interpreter::SetError(ErrorCode code, std::string error,
                            clang::SourceLocation loc) {
   assert(!error_ && "interpreter can error only once");
-  error_.Set(code, FormatDiagnostics(sm_->GetSourceManager(), error, loc));
+  error_.Set(code, FormatDiagnostics(*source_, error, loc));
+}
+
+bool Interpreter::PrepareWrite(const AstNode* node, Value& value) {
+  bool in_memory =
+      value.inner_value().GetLoadAddress() != LLDB_INVALID_ADDRESS;
+  if (!node->is_bitfield() && in_memory) {
+    return true;
+  }
+
+  if (overlay_ == nullptr) {
+    // The write can't be batched. Flush the pending writes first, so that the
+    // side effects are applied in order.
+    FlushWrites();
+    value.SetMemoryOverlay(nullptr);
+    return true;
+  }
+
+  // The overlay tracks whole bytes, it can't represent a write of some bits.
+  if (node->is_bitfield()) {
+    SetError(ErrorCode::kNotImplemented,
+             "bit-fields can't be modified in a memory overlay",
+             node->location());
+    result_ = Value();
+    return false;
+  }
+  if (!in_memory) {
+    SetError(ErrorCode::kNotImplemented,
+             "values not in memory can't be modified in a memory overlay",
+             node->location());
+    result_ = Value();
+    return false;
+  }
+  return true;
+}
+
+bool Interpreter::PrepareBitFieldRead(const AstNode* node, Value& value) {
+  if (overlay_ == nullptr) {
+    // The pending writes may modify the storage unit of the bit-field.
+    FlushWrites();
+    return true;
+  }
+
+  // The storage unit would have to be patched from the overlay before the bits
+  // of the bit-field are extracted from it.
+  lldb::SBValue inner_value = value.inner_value();
+  lldb::addr_t addr = inner_value.GetLoadAddress();
+  if (addr != LLDB_INVALID_ADDRESS &&
+      overlay_->Covers(addr, inner_value.GetByteSize())) {
+    SetError(ErrorCode::kNotImplemented,
+             "bit-fields modified in a memory overlay aren't supported",
+             node->location());
+    value = Value();
+    return false;
+  }
+  return true;
+}
+
+bool Interpreter::RecordRead(Value& value) {
+  if (reads_ == nullptr && fetched_ == nullptr) {
+    return true;
+  }
+  lldb::SBValue inner_value = value.inner_value();
+  lldb::addr_t addr = inner_value.GetLoadAddress();
+  if (addr != LLDB_INVALID_ADDRESS) {
+    uint64_t size = inner_value.GetByteSize();
+    if (fetched_ != nullptr && !fetched_->Check(addr, size)) {
+      // Stop the evaluation. The error isn't reported, there's no location to
+      // point at.
+      assert(!error_ && "interpreter can error only once");
+      error_.Set(ErrorCode::kUnknown, "memory read is pending");
+      read_pending_ = true;
+      return false;
+    }
+    if (reads_ != nullptr) {
+      reads_->AddMemory(addr, size);
+    }
+    return true;
+  }
+  // Values which aren't in memory are always read directly.
+  if (reads_ == nullptr) {
+    return true;
+  }
+  if (inner_value.GetValueType() == lldb::eValueTypeRegister) {
+    reads_->AddRegister(inner_value.GetName());
+  } else {
+    reads_->AddUntracked();
+  }
+  return true;
+}
+
+bool Interpreter::CheckBudget(clang::SourceLocation loc) {
+  if (error_) {
+    // The evaluation has already failed.
+    return false;
+  }
+  if (cancellation_ != nullptr && cancellation_->IsCancelled()) {
+    SetError(ErrorCode::kCancelled, "evaluation was cancelled", loc);
+    return false;
+  }
+  uint64_t value_reads = GetNumValueReads() - start_value_reads_;
+  if (budget_.max_value_reads > 0 && value_reads > budget_.max_value_reads) {
+    SetError(ErrorCode::kBudgetExceeded,
+             llvm::formatv("evaluation exceeded the budget of {0} value reads",
+                           budget_.max_value_reads),
+             loc);
+    return false;
+  }
+  uint64_t bytes_read = GetNumBytesRead() - start_bytes_read_;
+  if (budget_.max_bytes_read > 0 && bytes_read > budget_.max_bytes_read) {
+    SetError(ErrorCode::kBudgetExceeded,
+             llvm::formatv("evaluation exceeded the budget of {0} bytes read",
+                           budget_.max_bytes_read),
+             loc);
+    return false;
+  }
+  if (budget_.max_time.count() > 0 &&
+      std::chrono::steady_clock::now() - start_time_ > budget_.max_time) {
+    auto max_time_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(budget_.max_time);
+    SetError(ErrorCode::kBudgetExceeded,
+             llvm::formatv("evaluation exceeded the time budget of {0} us",
+                           max_time_us.count()),
+             loc);
+    return false;
+  }
+  return true;
+}
+
+void Interpreter::FlushWrites() {
+  if (write_back_.IsEmpty()) {
+    return;
+  }
+  // Errors are ignored, same as in `Value::Update`.
+  lldb::SBError ignore;
+  write_back_.Commit(target_.GetProcess(), ignore);
+  write_back_.Discard();
 }
 
 void Interpreter::Visit(const ErrorNode*) {
@@ -386,9 +596,19 @@ void Interpreter::Visit(const IdentifierNode* node) {
   assert(val.IsValid() && "identifier doesn't resolve to a valid value");
   // TODO: Check that `val` type is matching the node's result type.
 
+  // Taking the address of a variable doesn't read it, unless the variable is a
+  // reference. Then the address of the referent is read. `this` is an rvalue.
+  bool reads_value =
+      identifier.kind() != Context::IdentifierInfo::Kind::kThisKeyword &&
+      !(flow_analysis() && flow_analysis()->AddressOfIsPending());
+
   // If value is a reference, dereference it to get to the underlying type. All
   // operations on a reference should be actually operations on the referent.
   if (val.type()->IsReferenceType()) {
+    if (!RecordRead(val)) {
+      result_ = Value();
+      return;
+    }
     // TODO(werat): LLDB canonizes the type upon a dereference. This looks like
     // a bug, but for now we need to mitigate it. Check if the resulting type is
     // incorrect and fix it up.
@@ -398,10 +618,14 @@ void Interpreter::Visit(const IdentifierNode* node) {
 
     lldb::SBType val_type = ToSBType(val.type());
     if (val_type != deref_type) {
-      val = Value(val.inner_value().Cast(deref_type));
+      val = val.Cast(deref_type);
     }
   }
 
+  if (reads_value && !RecordRead(val)) {
+    result_ = Value();
+    return;
+  }
   result_ = val;
 }
 
@@ -449,7 +673,7 @@ void Interpreter::Visit(const BuiltinFunctionCallNode* node) {
     uint64_t addr;
 
     if (val1.IsPointer()) {
-      addr = val1.inner_value().GetValueAsUnsigned();
+      addr = val1.GetUInt64();
     } else if (val1.type()->IsArrayType()) {
       addr = val1.inner_value().GetLoadAddress();
     } else {
@@ -466,7 +690,7 @@ void Interpreter::Visit(const BuiltinFunctionCallNode* node) {
     if (!val2) {
       return;
     }
-    int64_t size = val2.inner_value().GetValueAsSigned();
+    int64_t size = val2.GetValueAsSigned();
 
     if (size < 0 || size > 100000000) {
       SetError(ErrorCode::kInvalidOperandType,
@@ -487,8 +711,20 @@ void Interpreter::Visit(const BuiltinFunctionCallNode* node) {
     for (int i = 0; i < size; ++i) {
       size_t read =
           process.ReadMemory(addr + i * ptr_size, &memory, ptr_size, error);
+      CountProcessRead(ptr_size);
+
+      if (limited_ && !CheckBudget(node->location())) {
+        if (reads_ != nullptr) {
+          reads_->AddMemory(addr, (i + 1) * ptr_size);
+        }
+        result_ = Value();
+        return;
+      }
 
       if (error.Fail() || read != ptr_size) {
+        if (reads_ != nullptr) {
+          reads_->AddMemory(addr, (i + 1) * ptr_size);
+        }
         SetError(ErrorCode::kUnknown,
                  llvm::formatv("error calling __findnonnull(): {0}",
                                error.GetCString() ? error.GetCString()
@@ -498,11 +734,17 @@ void Interpreter::Visit(const BuiltinFunctionCallNode* node) {
       }
 
       if (memory != 0) {
+        if (reads_ != nullptr) {
+          reads_->AddMemory(addr, (i + 1) * ptr_size);
+        }
         result_ = CreateValueFromBytes(target_, &i, lldb::eBasicTypeInt);
         return;
       }
     }
 
+    if (reads_ != nullptr) {
+      reads_->AddMemory(addr, size * ptr_size);
+    }
     int ret = -1;
     result_ = CreateValueFromBytes(target_, &ret, lldb::eBasicTypeInt);
     return;
@@ -567,8 +809,7 @@ void Interpreter::Visit(const CStyleCastNode* node) {
       return;
     }
     case CStyleCastKind::kReference: {
-      result_ =
-          Value(rhs.inner_value().Cast(ToSBType(type->GetDereferencedType())));
+      result_ = rhs.Cast(ToSBType(type->GetDereferencedType()));
       return;
     }
   }
@@ -589,7 +830,7 @@ void Interpreter::Visit(const CxxStaticCastNode* node) {
     case CxxStaticCastKind::kNoOp: {
       assert(CompareTypes(type, rhs.type()) &&
              "invalid ast: types should be the same");
-      result_ = Value(rhs.inner_value().Cast(ToSBType(type)));
+      result_ = rhs.Cast(ToSBType(type));
       return;
     }
 
@@ -664,13 +905,13 @@ void Interpreter::Visit(const CxxReinterpretCastNode* node) {
       assert(CompareTypes(type, rhs.type()) &&
              "invalid ast: operands should have the same type");
       // Cast value to handle type aliases.
-      result_ = Value(rhs.inner_value().Cast(ToSBType(type)));
+      result_ = rhs.Cast(ToSBType(type));
     }
   } else if (type->IsEnum()) {
     assert(CompareTypes(type, rhs.type()) &&
            "invalid ast: operands should have the same type");
     // Cast value to handle type aliases.
-    result_ = Value(rhs.inner_value().Cast(ToSBType(type)));
+    result_ = rhs.Cast(ToSBType(type));
   } else if (type->IsPointerType()) {
     assert((rhs.IsInteger() || rhs.IsEnum() || rhs.IsPointer() ||
             rhs.type()->IsArrayType()) &&
@@ -680,8 +921,7 @@ void Interpreter::Visit(const CxxReinterpretCastNode* node) {
                         : rhs.GetUInt64();
     result_ = CreateValueFromPointer(target_, addr, ToSBType(type));
   } else if (type->IsReferenceType()) {
-    result_ =
-        Value(rhs.inner_value().Cast(ToSBType(type->GetDereferencedType())));
+    result_ = rhs.Cast(ToSBType(type->GetDereferencedType()));
   } else {
     assert(false && "invalid ast: unexpected reinterpret_cast kind");
     result_ = Value();
@@ -703,8 +943,18 @@ void Interpreter::Visit(const MemberOfNode* node) {
   if (!lhs) {
     return;
   }
+  // LLDB follows the pointer stored in the process, see the overlay instead.
+  bool is_pointer = lhs.IsPointer();
+  if (is_pointer) {
+    lhs = lhs.ResolveOverlay();
+  }
 
   result_ = EvaluateMemberOf(lhs, node->member_index());
+  // Members of lvalues are covered by the read of the whole object.
+  bool address_of = flow_analysis() && flow_analysis()->AddressOfIsPending();
+  if (is_pointer && !address_of && !RecordRead(result_)) {
+    result_ = Value();
+  }
 }
 
 void Interpreter::Visit(const ArraySubscriptNode* node) {
@@ -738,6 +988,9 @@ void Interpreter::Visit(const ArraySubscriptNode* node) {
     result_ = value;
   } else {
     result_ = value.Dereference();
+    if (!RecordRead(result_)) {
+      result_ = Value();
+    }
   }
 }
 
@@ -783,6 +1036,13 @@ void Interpreter::Visit(const BinaryOpNode* node) {
     return;
   }
 
+  if (node->kind() == BinaryOpKind::Assign ||
+      binary_op_kind_is_comp_assign(node->kind())) {
+    if (!PrepareWrite(node->lhs(), lhs)) {
+      return;
+    }
+  }
+
   switch (node->kind()) {
     case BinaryOpKind::Add:
       result_ = EvaluateBinaryAddition(lhs, rhs);
@@ -870,6 +1130,15 @@ void Interpreter::Visit(const UnaryOpNode* node) {
     return;
   }
 
+  if (node->kind() == UnaryOpKind::PreInc ||
+      node->kind() == UnaryOpKind::PreDec ||
+      node->kind() == UnaryOpKind::PostInc ||
+      node->kind() == UnaryOpKind::PostDec) {
+    if (!PrepareWrite(node->rhs(), rhs)) {
+      return;
+    }
+  }
+
   switch (node->kind()) {
     case UnaryOpKind::Deref:
       result_ = EvaluateDereference(rhs);
@@ -949,12 +1218,18 @@ void Interpreter::Visit(const SmartPtrToPtrDecay* node) {
   assert(ptr.type()->IsSmartPtrType() &&
          "invalid ast: must be a smart pointer");
 
+  // The pointer is stored in the smart pointer object.
+  if (!RecordRead(ptr)) {
+    result_ = Value();
+    return;
+  }
+
   // Prefer synthetic value because we need LLDB machinery to "dereference" the
   // pointer for us. This is usually the default, but if the value was obtained
   // as a field of some other object, it will inherit the value from parent.
   lldb::SBValue ptr_value = ptr.inner_value();
   ptr_value.SetPreferSyntheticValue(true);
-  ptr_value = ptr_value.GetChildAtIndex(0);
+  ptr_value = CountCreatedValue(ptr_value.GetChildAtIndex(0));
 
   lldb::addr_t base_addr = ptr_value.GetValueAsUnsigned();
   lldb::SBType pointer_type = ptr_value.GetType();
@@ -1005,7 +1280,11 @@ Value Interpreter::EvaluateDereference(Value rhs) {
     return value;
   }
 
-  return value.Dereference();
+  value = value.Dereference();
+  if (!RecordRead(value)) {
+    return Value();
+  }
+  return value;
 }
 
 Value Interpreter::EvaluateUnaryMinus(Value rhs) {
@@ -17,13 +17,18 @@
 #ifndef LLDB_EVAL_EVAL_H_
 #define LLDB_EVAL_EVAL_H_
 
+#include <chrono>
 #include <memory>
 #include <vector>
 
 #include "clang/Basic/TokenKinds.h"
 #include "lldb-eval/ast.h"
+#include "lldb-eval/budget.h"
 #include "lldb-eval/context.h"
 #include "lldb-eval/defines.h"
+#include "lldb-eval/memory_overlay.h"
+#include "lldb-eval/read_set.h"
+#include "lldb-eval/stats.h"
 #include "lldb-eval/value.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBProcess.h"
@@ -47,8 +52,8 @@ class FlowAnalysis {
 
 class Interpreter : Visitor {
  public:
-  Interpreter(lldb::SBTarget target, std::shared_ptr<SourceManager> sm);
-  Interpreter(lldb::SBTarget target, std::shared_ptr<SourceManager> sm,
+  Interpreter(lldb::SBTarget target, std::shared_ptr<const SourceText> source);
+  Interpreter(lldb::SBTarget target, std::shared_ptr<const SourceText> source,
               Value scope);
 
  public:
@@ -56,6 +61,29 @@ class Interpreter : Visitor {
 
   void SetContextVars(std::unordered_map<std::string, Value> context_vars);
 
+  // Evaluates the expression on top of the `overlay`, see `MemoryOverlay`.
+  void SetMemoryOverlay(MemoryOverlay* overlay);
+
+  // Records the memory and the registers read by the evaluations to `reads`.
+  void SetReadSet(ReadSet* reads);
+
+  // Stops the evaluations at the reads of memory which isn't in `fetched`, see
+  // `FetchSet`.
+  void SetFetchSet(FetchSet* fetched);
+
+  // Whether the last evaluation stopped at a read of memory which isn't
+  // fetched yet. It failed then and should be run again after the fetch.
+  bool read_pending() const { return read_pending_; }
+
+  // Records the evaluation time, per AST node kind, and the reads to `stats`.
+  void SetStats(EvalStats* stats);
+
+  // Limits every evaluation to the `budget`, see `EvalBudget`.
+  void SetBudget(EvalBudget budget);
+
+  // Fails the evaluations once the `cancellation` token is cancelled.
+  void SetCancellationToken(const CancellationToken* cancellation);
+
  private:
   void SetError(ErrorCode error_code, std::string error,
                 clang::SourceLocation loc);
@@ -77,6 +105,31 @@ class Interpreter : Visitor {
 
   Value EvalNode(const AstNode* node, FlowAnalysis* flow = nullptr);
 
+  // Prepares the lvalue `value` of the `node` to be written to. Writes which
+  // can't go through the memory overlay are made directly to the process, after
+  // the pending ones. Sets the error if the value can't be written to.
+  bool PrepareWrite(const AstNode* node, Value& value);
+
+  // Writes the side effects gathered in `write_back_` to the process.
+  void FlushWrites();
+
+  // Prepares the bit-field `value` of the `node` to be read. LLDB reads
+  // bit-fields directly from the process, so the pending writes are flushed
+  // first. Sets the error if the bit-field is modified in the user's overlay.
+  bool PrepareBitFieldRead(const AstNode* node, Value& value);
+
+  // Records a read of the lvalue `value` to `reads_`, if it's set. Returns
+  // false and sets the error if the memory of the value hasn't been fetched.
+  bool RecordRead(Value& value);
+
+  // Sets the error and returns false if the evaluation is cancelled or has
+  // exceeded its budget.
+  bool CheckBudget(clang::SourceLocation loc);
+
+  MemoryOverlay* active_overlay() {
+    return overlay_ != nullptr ? overlay_ : &write_back_;
+  }
+
   Value EvaluateComparison(BinaryOpKind kind, Value lhs, Value rhs);
 
   Value EvaluateDereference(Value rhs);
@@ -114,7 +167,8 @@ class Interpreter : Visitor {
   // Used by the interpreter to create objects, perform casts, etc.
   lldb::SBTarget target_;
 
-  std::shared_ptr<SourceManager> sm_;
+  // Expression text, used for formatting the error messages.
+  std::shared_ptr<const SourceText> source_;
 
   // Flow analysis chain represents the expression evaluation flow for the
   // current code branch. Each node in the chain corresponds to an AST node,
@@ -128,6 +182,29 @@ class Interpreter : Visitor {
 
   std::unordered_map<std::string, Value> context_vars_;
 
+  // Overlay set by the user. The process isn't written to if it's set.
+  MemoryOverlay* overlay_ = nullptr;
+
+  // Side effects of the evaluation, unless the user has set an overlay. They
+  // are visible to the subsequent reads, like in C++, and are written to the
+  // process at the end of the evaluation with one write per contiguous range.
+  MemoryOverlay write_back_;
+
+  ReadSet* reads_ = nullptr;
+  FetchSet* fetched_ = nullptr;
+  bool read_pending_ = false;
+
+  EvalStats* stats_ = nullptr;
+
+  EvalBudget budget_;
+  const CancellationToken* cancellation_ = nullptr;
+  // Whether any budget check is needed.
+  bool limited_ = false;
+  // State of the current evaluation the budget is checked against.
+  std::chrono::steady_clock::time_point start_time_;
+  uint64_t start_value_reads_ = 0;
+  uint64_t start_bytes_read_ = 0;
+
   Value result_;
 
   Value scope_;
@@ -18,23 +18,75 @@
 #include <errno.h>  // for `program_invocation_name`
 #endif
 
+#include <iterator>
 #include <memory>
+#include <string>
 
 #include "benchmark/benchmark.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TargetOptions.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderSearchOptions.h"
+#include "clang/Lex/ModuleLoader.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Lex/Token.h"
 #include "lldb-eval/api.h"
 #include "lldb-eval/context.h"
 #include "lldb-eval/parser.h"
 #include "lldb-eval/runner.h"
+#include "lldb-eval/value.h"
 #include "lldb/API/SBDebugger.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBProcess.h"
 #include "lldb/API/SBTarget.h"
 #include "lldb/API/SBThread.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Host.h"
 #include "tools/cpp/runfiles/runfiles.h"
 
 using bazel::tools::cpp::runfiles::Runfiles;
 
+// Lexes the whole expression using the same preprocessor setup as
+// lldb_eval::Parser and returns the number of tokens.
+static size_t LexExpression(clang::SourceManager& sm) {
+  clang::DiagnosticsEngine& de = sm.getDiagnostics();
+
+  auto tOpts = std::make_shared<clang::TargetOptions>();
+  tOpts->Triple = llvm::sys::getDefaultTargetTriple();
+  std::unique_ptr<clang::TargetInfo> ti(
+      clang::TargetInfo::CreateTargetInfo(de, tOpts));
+
+  clang::LangOptions lang_opts;
+  lang_opts.Bool = true;
+  lang_opts.WChar = true;
+  lang_opts.CPlusPlus = true;
+  lang_opts.CPlusPlus11 = true;
+  lang_opts.CPlusPlus14 = true;
+  lang_opts.CPlusPlus17 = true;
+
+  auto hOpts = std::make_shared<clang::HeaderSearchOptions>();
+  clang::HeaderSearch hs(hOpts, sm, de, lang_opts, ti.get());
+  clang::TrivialModuleLoader tml;
+
+  auto pOpts = std::make_shared<clang::PreprocessorOptions>();
+  clang::Preprocessor pp(pOpts, de, lang_opts, sm, hs, tml);
+  pp.Initialize(*ti);
+  pp.EnterMainSourceFile();
+
+  size_t num_tokens = 0;
+  clang::Token token;
+  token.setKind(clang::tok::unknown);
+  while (token.isNot(clang::tok::eof)) {
+    pp.Lex(token);
+    ++num_tokens;
+  }
+  return num_tokens;
+}
+
 class BM : public benchmark::Fixture {
  public:
   void SetUp(::benchmark::State&) override {
@@ -105,6 +157,19 @@ BENCHMARK_F(BM, ArraySubscript)(benchmark::State& state) {
   }
 }
 
+// Same as above, but without creating an lldb::SBValue for the result.
+BENCHMARK_F(BM, ArraySubscriptToInt64)(benchmark::State& state) {
+  for (auto _ : state) {
+    lldb::SBError error;
+    benchmark::DoNotOptimize(
+        lldb_eval::EvaluateToInt64(frame, "arr[0]", {}, error));
+
+    if (error.Fail()) {
+      state.SkipWithError("Failed to evaluate the expression!");
+    }
+  }
+}
+
 BENCHMARK_F(BM, TypeCasting)(benchmark::State& state) {
   for (auto _ : state) {
     lldb::SBError error;
@@ -118,6 +183,96 @@ BENCHMARK_F(BM, TypeCasting)(benchmark::State& state) {
   }
 }
 
+// Expressions with side effects are evaluated against the same state: the
+// process is restored from a snapshot after every iteration, outside of the
+// measured time.
+BENCHMARK_F(BM, CompoundAssignment)(benchmark::State& state) {
+  lldb_eval::Options opts;
+  opts.allow_side_effects = true;
+
+  lldb::SBError error;
+  auto snapshot = lldb_eval::ProcessSnapshot::Create(process, error);
+  if (error.Fail()) {
+    state.SkipWithError("Failed to take the snapshot of the process!");
+  }
+
+  for (auto _ : state) {
+    lldb_eval::EvaluateExpression(frame, "arr[0] += 1", opts, error);
+    if (error.Fail()) {
+      state.SkipWithError("Failed to evaluate the expression!");
+    }
+
+    state.PauseTiming();
+    snapshot.Restore(error);
+    if (error.Fail()) {
+      state.SkipWithError("Failed to restore the process!");
+    }
+    state.ResumeTiming();
+  }
+}
+
+BENCHMARK_F(BM, RestoreSnapshot)(benchmark::State& state) {
+  lldb_eval::Options opts;
+  opts.allow_side_effects = true;
+
+  lldb::SBError error;
+  auto snapshot = lldb_eval::ProcessSnapshot::Create(process, error);
+  if (error.Fail()) {
+    state.SkipWithError("Failed to take the snapshot of the process!");
+  }
+
+  size_t bytes_written = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    lldb_eval::EvaluateExpression(frame, "arr[0] += 1", opts, error);
+    state.ResumeTiming();
+
+    bytes_written += snapshot.Restore(error);
+    if (error.Fail()) {
+      state.SkipWithError("Failed to restore the process!");
+    }
+  }
+  state.counters["snapshot_bytes"] = snapshot.size();
+  state.counters["bytes_written"] = benchmark::Counter(
+      bytes_written, benchmark::Counter::kAvgIterations);
+}
+
+// Conditional breakpoints: the cost of checking the condition on each hit of a
+// breakpoint, reported as hits per second. The process isn't resumed, so only
+// the evaluation is measured.
+static const char* kBreakpointCondition =
+    "arr[1] > 1 && data.ptr->x == data.point.x";
+
+BENCHMARK_F(BM, BreakpointConditionExpression)(benchmark::State& state) {
+  for (auto _ : state) {
+    lldb::SBError error;
+    lldb::SBValue value =
+        lldb_eval::EvaluateExpression(frame, kBreakpointCondition, error);
+    bool hit = value.GetValueAsUnsigned() != 0;
+
+    if (error.Fail() || !hit) {
+      state.SkipWithError("Failed to evaluate the condition!");
+    }
+  }
+  state.counters["hits_per_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_F(BM, BreakpointConditionCompiled)(benchmark::State& state) {
+  lldb_eval::BreakpointCondition condition(kBreakpointCondition);
+
+  for (auto _ : state) {
+    lldb::SBError error;
+    bool hit = condition.Evaluate(frame, error);
+
+    if (error.Fail() || !hit) {
+      state.SkipWithError("Failed to evaluate the condition!");
+    }
+  }
+  state.counters["hits_per_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+
 BENCHMARK_F(BM, ParseInteger)(benchmark::State& state) {
   auto context = lldb_eval::Context::Create(
       lldb_eval::SourceManager::Create("1+1u+1l+1ul+1ll+1ull"), frame);
@@ -132,6 +287,166 @@ BENCHMARK_F(BM, ParseInteger)(benchmark::State& state) {
   }
 }
 
+// Phase-split benchmarks. Every phase of the evaluation is measured in
+// isolation for the same set of expressions, so that a regression can be
+// attributed to lexing, parsing, type resolution, identifier lookup or
+// evaluation. The expressions are evaluated in the scope of the `data` value.
+// "Cold" variants create a new `Context` on every iteration, i.e. start with
+// empty lldb-eval caches, "warm" variants reuse the same `Context`.
+//
+// Use `--benchmark_format=json` or `--benchmark_out=<file>` to get the results
+// in JSON and compare two runs with `compare.py` from Google Benchmark.
+
+static const char* kPhaseExpressions[] = {
+    "arr[0] + arr[1]",
+    "point.x * ptr->y",
+    "(long long)arr[2] + sizeof(Point)",
+    "(char)1 + (short)1.1f + (long long)1.1 + (double)(char)2",
+};
+
+static const int kNumPhaseExpressions =
+    static_cast<int>(std::size(kPhaseExpressions));
+
+class PhaseBM : public BM {
+ public:
+  void SetUp(::benchmark::State& state) override {
+    BM::SetUp(state);
+    scope = frame.FindVariable("data");
+    expr = kPhaseExpressions[state.range(0)];
+    state.SetLabel(expr);
+  }
+
+  std::shared_ptr<lldb_eval::Context> CreateContext() {
+    return lldb_eval::Context::Create(
+        lldb_eval::SourceManager::Create(expr), process.GetTarget(),
+        lldb_eval::LLDBType::CreateSP(scope.GetType()));
+  }
+
+  lldb::SBValue scope;
+  std::string expr;
+};
+
+#define REGISTER_PHASE_BENCHMARK(name) \
+  BENCHMARK_REGISTER_F(PhaseBM, name)  \
+      ->ArgName("expr")                \
+      ->DenseRange(0, kNumPhaseExpressions - 1)
+
+BENCHMARK_DEFINE_F(PhaseBM, Lex)(benchmark::State& state) {
+  auto sm = lldb_eval::SourceManager::Create(expr);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LexExpression(sm->GetSourceManager()));
+  }
+}
+REGISTER_PHASE_BENCHMARK(Lex);
+
+BENCHMARK_DEFINE_F(PhaseBM, ParseCold)(benchmark::State& state) {
+  for (auto _ : state) {
+    lldb_eval::Error err;
+    lldb_eval::Parser(CreateContext()).Run(err);
+
+    if (err) {
+      state.SkipWithError("Failed to parse the expression!");
+    }
+  }
+}
+REGISTER_PHASE_BENCHMARK(ParseCold);
+
+BENCHMARK_DEFINE_F(PhaseBM, ParseWarm)(benchmark::State& state) {
+  auto context = CreateContext();
+
+  for (auto _ : state) {
+    lldb_eval::Error err;
+    lldb_eval::Parser(context).Run(err);
+
+    if (err) {
+      state.SkipWithError("Failed to parse the expression!");
+    }
+  }
+}
+REGISTER_PHASE_BENCHMARK(ParseWarm);
+
+// Resolves the types used by the expressions: a user-defined type and a few
+// basic types, which are cached by `Context`.
+static void ResolveTypes(lldb_eval::Context& context,
+                         benchmark::State& state) {
+  if (!context.ResolveTypeByName("Point")->IsValid() ||
+      !context.GetBasicType(lldb::eBasicTypeInt)->IsValid() ||
+      !context.GetBasicType(lldb::eBasicTypeLongLong)->IsValid() ||
+      !context.GetBasicType(lldb::eBasicTypeDouble)->IsValid()) {
+    state.SkipWithError("Failed to resolve the types!");
+  }
+}
+
+BENCHMARK_DEFINE_F(PhaseBM, TypeResolutionCold)(benchmark::State& state) {
+  state.SetLabel("Point, int, long long, double");
+
+  for (auto _ : state) {
+    ResolveTypes(*CreateContext(), state);
+  }
+}
+BENCHMARK_REGISTER_F(PhaseBM, TypeResolutionCold)->Arg(0);
+
+BENCHMARK_DEFINE_F(PhaseBM, TypeResolutionWarm)(benchmark::State& state) {
+  state.SetLabel("Point, int, long long, double");
+  auto context = CreateContext();
+
+  for (auto _ : state) {
+    ResolveTypes(*context, state);
+  }
+}
+BENCHMARK_REGISTER_F(PhaseBM, TypeResolutionWarm)->Arg(0);
+
+// Looks up the identifiers used by the expressions: members of the scope value
+// and a local variable of the frame.
+BENCHMARK_DEFINE_F(PhaseBM, IdentifierLookup)(benchmark::State& state) {
+  state.SetLabel("arr, ptr, data");
+  auto scope_context = CreateContext();
+  auto frame_context =
+      lldb_eval::Context::Create(lldb_eval::SourceManager::Create(""), frame);
+
+  for (auto _ : state) {
+    if (!scope_context->LookupIdentifier("arr")->IsValid() ||
+        !scope_context->LookupIdentifier("ptr")->IsValid() ||
+        !frame_context->LookupIdentifier("data")->IsValid()) {
+      state.SkipWithError("Failed to look up the identifiers!");
+    }
+  }
+}
+BENCHMARK_REGISTER_F(PhaseBM, IdentifierLookup)->Arg(0);
+
+BENCHMARK_DEFINE_F(PhaseBM, Evaluate)(benchmark::State& state) {
+  lldb::SBError error;
+  auto compiled_expr = lldb_eval::CompileExpression(
+      process.GetTarget(), scope.GetType(), expr.c_str(), error);
+  if (error.Fail()) {
+    state.SkipWithError("Failed to compile the expression!");
+    return;
+  }
+
+  for (auto _ : state) {
+    lldb_eval::EvaluateExpression(scope, compiled_expr, error);
+
+    if (error.Fail()) {
+      state.SkipWithError("Failed to evaluate the expression!");
+    }
+  }
+}
+REGISTER_PHASE_BENCHMARK(Evaluate);
+
+// Full pipeline for comparison with the sum of the phases.
+BENCHMARK_DEFINE_F(PhaseBM, EndToEnd)(benchmark::State& state) {
+  for (auto _ : state) {
+    lldb::SBError error;
+    lldb_eval::EvaluateExpression(scope, expr.c_str(), error);
+
+    if (error.Fail()) {
+      state.SkipWithError("Failed to evaluate the expression!");
+    }
+  }
+}
+REGISTER_PHASE_BENCHMARK(EndToEnd);
+
 int main(int argc, char** argv) {
   lldb::SBDebugger::Initialize();
 
@@ -13,24 +13,42 @@
 // limitations under the License.
 
 #ifndef __EMSCRIPTEN__
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include "lldb-eval/api.h"
 #include "lldb-eval/ast.h"
 #include "lldb-eval/context.h"
+#include "lldb-eval/memory_overlay.h"
+#include "lldb-eval/parser.h"
+#include "lldb-eval/read_set.h"
 #include "lldb-eval/runner.h"
+#include "lldb-eval/stats.h"
+#include "lldb-eval/trace_buffer.h"
+#include "lldb-eval/tracepoint.h"
+#include "lldb-eval/type_cache.h"
 #include "lldb-eval/traits.h"
+#include "lldb-eval/value.h"
 #include "lldb/API/SBDebugger.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBProcess.h"
 #include "lldb/API/SBTarget.h"
 #include "lldb/API/SBThread.h"
 #include "lldb/API/SBType.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tools/cpp/runfiles/runfiles.h"
 #endif
 
@@ -71,10 +89,18 @@ struct EvalResult {
 
 class EvaluatorHelper {
  public:
-  EvaluatorHelper(lldb::SBFrame frame, bool lldb, bool side_effects)
-      : frame_(frame), lldb_(lldb), side_effects_(side_effects) {}
-  EvaluatorHelper(lldb::SBValue scope, bool lldb, bool side_effects)
-      : scope_(scope), lldb_(lldb), side_effects_(side_effects) {}
+  EvaluatorHelper(lldb::SBFrame frame, bool lldb, bool side_effects,
+                  lldb_eval::MemoryOverlay* overlay = nullptr)
+      : frame_(frame),
+        lldb_(lldb),
+        side_effects_(side_effects),
+        overlay_(overlay) {}
+  EvaluatorHelper(lldb::SBValue scope, bool lldb, bool side_effects,
+                  lldb_eval::MemoryOverlay* overlay = nullptr)
+      : scope_(scope),
+        lldb_(lldb),
+        side_effects_(side_effects),
+        overlay_(overlay) {}
 
  public:
   EvalResult Eval(const std::string& expr) {
@@ -82,6 +108,7 @@ class EvaluatorHelper {
 
     lldb_eval::Options opts;
     opts.allow_side_effects = side_effects_;
+    opts.memory_overlay = overlay_;
 
     if (scope_) {
       // Evaluate in the variable context.
@@ -203,6 +230,7 @@ class EvaluatorHelper {
   lldb::SBValue scope_;
   bool lldb_;
   bool side_effects_;
+  lldb_eval::MemoryOverlay* overlay_;
 };
 #endif
 
@@ -414,7 +442,8 @@ class EvalTest : public ::testing::Test {
   }
 
   EvalResult Eval(const std::string& expr) {
-    return EvaluatorHelper(frame_, compare_with_lldb_, allow_side_effects_)
+    return EvaluatorHelper(frame_, compare_with_lldb_, allow_side_effects_,
+                           memory_overlay_)
         .Eval(expr);
   }
 
@@ -428,7 +457,8 @@ class EvalTest : public ::testing::Test {
   EvaluatorHelper Scope(std::string scope) {
     // Resolve the scope variable (assume it's a local variable).
     lldb::SBValue scope_var = frame_.FindVariable(scope.c_str());
-    return EvaluatorHelper(scope_var, compare_with_lldb_, allow_side_effects_);
+    return EvaluatorHelper(scope_var, compare_with_lldb_, allow_side_effects_,
+                           memory_overlay_);
   }
 
   bool CreateContextVariable(std::string type, std::string name, bool is_array,
@@ -470,6 +500,9 @@ class EvalTest : public ::testing::Test {
   // Allow the expressions to have side-effects.
   bool allow_side_effects_ = false;
 
+  // Write the side-effects to the overlay instead of the process.
+  lldb_eval::MemoryOverlay* memory_overlay_ = nullptr;
+
   // Context variables.
   std::unordered_map<std::string, lldb::SBValue> vars_;
 
@@ -1428,6 +1461,26 @@ TEST_F(EvalTest, TestCStyleCastBasicType) {
               IsError("C-style cast from 'int *' to 'float' is not allowed"));
 }
 
+TEST_F(EvalTest, TestCastFloatTemporary) {
+  // Results of arithmetic are temporaries stored by lldb-eval.
+  EXPECT_THAT(Eval("(int)(1.5f * 3)"), IsEqual("4"));
+  EXPECT_THAT(Eval("(long)-(1.5 * 3)"), IsEqual("-4"));
+  EXPECT_THAT(Eval("(unsigned long long)(2.5 + 0.75)"), IsEqual("3"));
+  EXPECT_THAT(Eval("(bool)(0.25f * 2)"), IsEqual("true"));
+
+  // Floating-point temporaries are converted to integers, not reinterpreted.
+  lldb::SBTarget target = process_.GetTarget();
+  float f = -2.75f;
+  lldb_eval::Value value =
+      lldb_eval::CreateValueFromBytes(target, &f, lldb::eBasicTypeFloat);
+  EXPECT_EQ(value.GetValueAsSigned(), -2);
+  EXPECT_EQ(value.GetUInt64(), static_cast<uint64_t>(-2));
+  double d = 3.5;
+  value = lldb_eval::CreateValueFromBytes(target, &d, lldb::eBasicTypeDouble);
+  EXPECT_EQ(value.GetValueAsSigned(), 3);
+  EXPECT_EQ(value.GetUInt64(), 3u);
+}
+
 TEST_F(EvalTest, TestCStyleCastPointer) {
   EXPECT_THAT(Eval("(void*)&a"), IsOk());
   EXPECT_THAT(Eval("(void*)ap"), IsOk());
@@ -3213,6 +3266,59 @@ TEST_F(EvalTest, TestCompositeAssignmentBitwise) {
       IsError("invalid operands to binary expression ('int *' and 'int *')"));
 }
 
+TEST_F(EvalTest, TestTypedResults) {
+  lldb::SBError error;
+  lldb_eval::Options opts;
+
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, "c + ll_min + 1", opts, error),
+            std::numeric_limits<long long>::min() + 11);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, "-2.7f", opts, error), -2);
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, "uint_max", opts, error),
+            std::numeric_limits<unsigned int>::max());
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  EXPECT_EQ(lldb_eval::EvaluateToUInt64(frame_, "ull_max", opts, error),
+            std::numeric_limits<unsigned long long>::max());
+  EXPECT_EQ(lldb_eval::EvaluateToUInt64(frame_, "-1", opts, error),
+            std::numeric_limits<uint64_t>::max());
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  EXPECT_EQ(lldb_eval::EvaluateToDouble(frame_, "x / 4.0", opts, error), 0.5);
+  EXPECT_EQ(lldb_eval::EvaluateToDouble(frame_, "int_min", opts, error),
+            std::numeric_limits<int>::min());
+  EXPECT_EQ(lldb_eval::EvaluateToDouble(frame_, "1.5f", opts, error), 1.5);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  EXPECT_TRUE(lldb_eval::EvaluateToBool(frame_, "p", opts, error));
+  EXPECT_TRUE(lldb_eval::EvaluateToBool(frame_, "fnan", opts, error));
+  EXPECT_FALSE(lldb_eval::EvaluateToBool(frame_, "uint_zero", opts, error));
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  EXPECT_EQ(lldb_eval::EvaluateToAddress(frame_, "p", opts, error),
+            frame_.FindVariable("x").GetLoadAddress());
+  EXPECT_EQ(lldb_eval::EvaluateToAddress(frame_, "&r", opts, error),
+            frame_.FindVariable("x").GetLoadAddress());
+  EXPECT_EQ(lldb_eval::EvaluateToAddress(frame_, "(int*)16", opts, error), 16);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  // Errors.
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, "p", opts, error), 0);
+  EXPECT_STREQ(error.GetCString(),
+               "result of type 'int *' can't be converted to 'int64_t'");
+  EXPECT_EQ(lldb_eval::EvaluateToAddress(frame_, "1.5", opts, error),
+            LLDB_INVALID_ADDRESS);
+  EXPECT_STREQ(error.GetCString(),
+               "result of type 'double' can't be converted to 'lldb::addr_t'");
+  EXPECT_FALSE(lldb_eval::EvaluateToBool(frame_, "undeclared", opts, error));
+  EXPECT_EQ(error.GetError(), static_cast<uint32_t>(
+                                  lldb_eval::ErrorCode::kUndeclaredIdentifier));
+
+  // The error is cleared on success.
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, "a", opts, error), 1);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+}
+
 TEST_F(EvalTest, TestSideEffects) {
   // Comparing with LLDB is not possible with side effects enabled -- results
   // will always be different (because the same expression is evaluated twice).
@@ -3231,6 +3337,611 @@ TEST_F(EvalTest, TestSideEffects) {
   EXPECT_THAT(Eval("*p"), IsEqual("5"));
   EXPECT_THAT(Eval("x"), IsEqual("5"));  // `p` is `&x`
 }
+
+TEST_F(EvalTest, TestSideEffectsSequencing) {
+  this->compare_with_lldb_ = false;
+  this->allow_side_effects_ = true;
+
+  // Writes are visible to the subsequent reads in the same expression.
+  EXPECT_THAT(Eval("x += ++x"), IsEqual("4"));
+  EXPECT_THAT(Eval("*p += ++x"), IsEqual("10"));  // `p` is `&x`
+  EXPECT_THAT(Eval("x"), IsEqual("10"));
+
+  // Both elements are written back.
+  EXPECT_THAT(Eval("xa[0] += ++xa[1]"), IsEqual("4"));
+  EXPECT_THAT(Eval("xa[0]"), IsEqual("4"));
+  EXPECT_THAT(Eval("xa[1]"), IsEqual("3"));
+  EXPECT_THAT(Eval("xa[x - 10] = 5"), IsEqual("5"));
+  EXPECT_THAT(Eval("xa[0]"), IsEqual("5"));
+
+  // Bit-fields are written after the pending writes.
+  EXPECT_THAT(Eval("bf.b += bf.a += 1"), IsEqual("4"));
+  EXPECT_THAT(Eval("bf.a"), IsEqual("2"));
+  EXPECT_THAT(Eval("bf.b"), IsEqual("4"));
+  EXPECT_THAT(Eval("bf.c"), IsEqual("3"));
+  EXPECT_THAT(Eval("bf.a = bf.c++"), IsEqual("3"));
+  EXPECT_THAT(Eval("bf.a"), IsEqual("3"));
+  EXPECT_THAT(Eval("bf.c"), IsEqual("4"));
+
+  // Bit-fields are read after the pending writes to their storage unit.
+  EXPECT_THAT(Eval("(*((unsigned*)&bf + 1) = 0x75) ? bf.b : 0"),
+              IsEqual("5"));
+  EXPECT_THAT(Eval("bf.c"), IsEqual("7"));
+}
+
+TEST_F(EvalTest, TestProcessSnapshot) {
+  this->compare_with_lldb_ = false;
+  this->allow_side_effects_ = true;
+
+  lldb::SBError error;
+  auto snapshot = lldb_eval::ProcessSnapshot::Create(process_, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+
+  // Nothing to restore yet.
+  EXPECT_EQ(snapshot.Restore(error), 0);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+
+  EXPECT_THAT(Eval("x = 5"), IsEqual("5"));
+  EXPECT_THAT(Eval("xa[1] += 10"), IsEqual("12"));
+  EXPECT_THAT(Eval("*p = 7"), IsEqual("7"));
+
+  EXPECT_GT(snapshot.Restore(error), 0);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+
+  EXPECT_THAT(Eval("x"), IsEqual("1"));
+  EXPECT_THAT(Eval("xa[1]"), IsEqual("2"));
+  EXPECT_THAT(Eval("*p"), IsEqual("1"));
+
+  // The snapshot can be restored repeatedly.
+  EXPECT_THAT(Eval("++x"), IsEqual("2"));
+  snapshot.Restore(error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_THAT(Eval("x"), IsEqual("1"));
+}
+
+TEST_F(EvalTest, TestMemoryOverlay) {
+  this->compare_with_lldb_ = false;
+  this->allow_side_effects_ = true;
+
+  lldb_eval::MemoryOverlay overlay;
+  this->memory_overlay_ = &overlay;
+
+  EXPECT_THAT(Eval("x = 5"), IsEqual("5"));
+  EXPECT_THAT(Eval("xa[1] += 10"), IsEqual("12"));
+  EXPECT_FALSE(overlay.IsEmpty());
+
+  // Later evaluations see the writes, the process doesn't.
+  EXPECT_THAT(Eval("x"), IsEqual("5"));
+  EXPECT_THAT(Eval("*p"), IsEqual("5"));
+  EXPECT_THAT(Eval("++*p"), IsEqual("6"));
+  EXPECT_THAT(Eval("xa[0] + xa[1]"), IsEqual("13"));
+  EXPECT_EQ(frame_.FindVariable("x").GetValueAsSigned(), 1);
+  EXPECT_EQ(frame_.FindVariable("xa").GetChildAtIndex(1).GetValueAsSigned(),
+            2);
+
+  // Pointers are followed in the overlay too.
+  EXPECT_THAT(Eval("p = &xa[1]"), IsOk());
+  EXPECT_THAT(Eval("*p"), IsEqual("12"));
+
+  overlay.Discard();
+  EXPECT_TRUE(overlay.IsEmpty());
+  EXPECT_THAT(Eval("x"), IsEqual("1"));
+  EXPECT_THAT(Eval("*p"), IsEqual("1"));
+  EXPECT_THAT(Eval("xa[1]"), IsEqual("2"));
+
+  // Bit-fields are read from the process, their storage unit mustn't be
+  // modified in the overlay.
+  EXPECT_THAT(Eval("bf.b"), IsEqual("2"));
+  EXPECT_THAT(Eval("*((unsigned*)&bf + 1) = 0x75"), IsOk());
+  EXPECT_THAT(
+      Eval("bf.b"),
+      IsError("bit-fields modified in a memory overlay aren't supported"));
+  EXPECT_THAT(Eval("bf.a"), IsEqual("1"));
+  overlay.Discard();
+
+  EXPECT_THAT(Eval("x = 3"), IsEqual("3"));
+  EXPECT_THAT(Eval("xa[0] = 4"), IsEqual("4"));
+  lldb::SBError error;
+  overlay.Commit(process_, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_TRUE(overlay.IsEmpty());
+
+  this->memory_overlay_ = nullptr;
+  EXPECT_THAT(Eval("x"), IsEqual("3"));
+  EXPECT_THAT(Eval("xa[0]"), IsEqual("4"));
+  EXPECT_EQ(frame_.FindVariable("x").GetValueAsSigned(), 3);
+
+  // A range that can't be written doesn't stop the others.
+  int32_t value = 7;
+  overlay.Write(0, &value, sizeof(value));
+  overlay.Write(frame_.FindVariable("x").GetLoadAddress(), &value,
+                sizeof(value));
+  overlay.Commit(process_, error);
+  EXPECT_TRUE(error.Fail());
+  EXPECT_FALSE(overlay.IsEmpty());
+  EXPECT_EQ(frame_.FindVariable("x").GetValueAsSigned(), 7);
+  overlay.Discard();
+}
+
+TEST_F(EvalTest, TestBreakpointCondition) {
+  lldb::SBError error;
+
+  lldb_eval::BreakpointCondition cond("x == 1 && xa[1] > xa[0]");
+  EXPECT_TRUE(cond.Evaluate(frame_, error));
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  lldb_eval::BreakpointCondition ptr_cond("p");
+  EXPECT_TRUE(ptr_cond.Evaluate(frame_, error));
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  // The compiled condition sees the current state on every evaluation.
+  lldb_eval::Options opts;
+  opts.allow_side_effects = true;
+  lldb_eval::BreakpointCondition counter("++x > 2", opts);
+  EXPECT_FALSE(counter.Evaluate(frame_, error));
+  EXPECT_TRUE(counter.Evaluate(frame_, error));
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_FALSE(cond.Evaluate(frame_, error));
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  lldb_eval::BreakpointCondition struct_cond("bf");
+  EXPECT_FALSE(struct_cond.Evaluate(frame_, error));
+  EXPECT_EQ(error.GetError(),
+            static_cast<uint32_t>(lldb_eval::ErrorCode::kInvalidOperandType));
+
+  lldb_eval::BreakpointCondition undeclared_cond("y > 0");
+  EXPECT_FALSE(undeclared_cond.Evaluate(frame_, error));
+  EXPECT_EQ(error.GetError(), static_cast<uint32_t>(
+                                  lldb_eval::ErrorCode::kUndeclaredIdentifier));
+}
+
+TEST_F(EvalTest, TestTracepoint) {
+  this->compare_with_lldb_ = false;
+  this->allow_side_effects_ = true;
+
+  std::string path = testing::TempDir() + "tracepoint.trace";
+  lldb::SBError error;
+  auto buffer = lldb_eval::TraceBuffer::Create(path, 4096, error);
+  ASSERT_TRUE(buffer) << error.GetCString();
+
+  lldb_eval::Tracer tracer(std::move(buffer));
+  uint32_t id = tracer.AddTracepoint(
+      "TestSideEffects",
+      {"x", "xa[1] * 1.5", "x == 1", "p", "(unsigned)-x", "y", "bf"});
+
+  tracer.Hit(id, frame_, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_THAT(Eval("x = 2"), IsEqual("2"));
+  tracer.Hit(id, frame_, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(tracer.buffer().num_records(), 2u);
+
+  auto reader = lldb_eval::TraceReader::Open(path, error);
+  ASSERT_TRUE(reader) << error.GetCString();
+  const lldb_eval::TracepointSchema* schema = reader->FindSchema(id);
+  ASSERT_NE(schema, nullptr);
+  EXPECT_EQ(schema->location, "TestSideEffects");
+  std::vector<lldb_eval::TraceValueKind> kinds;
+  for (const auto& expr : schema->expressions) {
+    kinds.push_back(expr.kind);
+  }
+  EXPECT_THAT(kinds, testing::ElementsAre(lldb_eval::TraceValueKind::kInt64,
+                                          lldb_eval::TraceValueKind::kDouble,
+                                          lldb_eval::TraceValueKind::kBool,
+                                          lldb_eval::TraceValueKind::kAddress,
+                                          lldb_eval::TraceValueKind::kUInt64,
+                                          lldb_eval::TraceValueKind::kInvalid,
+                                          lldb_eval::TraceValueKind::kInvalid));
+
+  std::vector<lldb_eval::TraceRecord> records = reader->ReadRecords(error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  ASSERT_EQ(records.size(), 2u);
+
+  uint64_t address = frame_.FindVariable("x").GetLoadAddress();
+  double xa1 = 3.0;
+  uint64_t xa1_bits;
+  memcpy(&xa1_bits, &xa1, sizeof(xa1_bits));
+
+  // Values that failed to evaluate are recorded as zeros.
+  std::vector<uint64_t> values = {1, xa1_bits, 1, address, 0xffffffff, 0, 0};
+  std::vector<bool> errors = {false, false, false, false, false, true, true};
+  EXPECT_EQ(records[0].sequence, 0u);
+  EXPECT_EQ(records[0].values, values);
+  EXPECT_EQ(records[0].errors, errors);
+
+  values = {2, xa1_bits, 0, address, 0xfffffffe, 0, 0};
+  EXPECT_EQ(records[1].sequence, 1u);
+  EXPECT_EQ(records[1].values, values);
+  EXPECT_EQ(records[1].errors, errors);
+}
+
+TEST_F(EvalTest, TestTracepointWrap) {
+  this->compare_with_lldb_ = false;
+  this->allow_side_effects_ = true;
+
+  // A record of one value takes 40 bytes. The ring of 104 bytes holds two of
+  // them, and every other record leaves 24 bytes of padding at the end of the
+  // ring.
+  std::string path = testing::TempDir() + "tracepoint_wrap.trace";
+  lldb::SBError error;
+  auto buffer = lldb_eval::TraceBuffer::Create(path, 104, error);
+  ASSERT_TRUE(buffer) << error.GetCString();
+
+  lldb_eval::Tracer tracer(std::move(buffer));
+  uint32_t id = tracer.AddTracepoint("TestSideEffects", {"x"});
+  uint64_t thread_id = frame_.GetThread().GetThreadID();
+
+  const uint64_t kNumHits = 10;
+  for (uint64_t i = 0; i < kNumHits; ++i) {
+    std::string assignment = "x = " + std::to_string(i);
+    ASSERT_THAT(Eval(assignment), IsOk());
+    tracer.Hit(id, frame_, error);
+    ASSERT_TRUE(error.Success()) << error.GetCString();
+
+    // The padding is skipped and the oldest records are overwritten, the
+    // records left are the newest ones, in order and intact.
+    auto reader = lldb_eval::TraceReader::Open(path, error);
+    ASSERT_TRUE(reader) << error.GetCString();
+    EXPECT_EQ(reader->num_records(), i + 1);
+    std::vector<lldb_eval::TraceRecord> records = reader->ReadRecords(error);
+    ASSERT_TRUE(error.Success()) << error.GetCString();
+    ASSERT_EQ(records.size(), std::min<uint64_t>(i + 1, 2));
+
+    // The sequence numbers start after the overwritten records.
+    uint64_t first = i + 1 - records.size();
+    for (size_t j = 0; j < records.size(); ++j) {
+      EXPECT_EQ(records[j].tracepoint_id, id);
+      EXPECT_EQ(records[j].sequence, first + j);
+      EXPECT_EQ(records[j].thread_id, thread_id);
+      EXPECT_EQ(records[j].values, std::vector<uint64_t>{first + j});
+      EXPECT_EQ(records[j].errors, std::vector<bool>{false});
+    }
+  }
+  EXPECT_EQ(tracer.buffer().num_records(), kNumHits);
+}
+
+TEST_F(EvalTest, TestTracepointFrames) {
+  std::string path = testing::TempDir() + "tracepoint_frames.trace";
+  lldb::SBError error;
+  auto buffer = lldb_eval::TraceBuffer::Create(path, 4096, error);
+  ASSERT_TRUE(buffer) << error.GetCString();
+
+  lldb_eval::Tracer tracer(std::move(buffer));
+  uint32_t id =
+      tracer.AddTracepoint("TestRecursion", {"depth", "value", "&value"});
+
+  // The identifiers are bound to the variables of the frame of each hit.
+  lldb::SBFrame outer_frame = frame_;
+  uint64_t outer_address = outer_frame.FindVariable("value").GetLoadAddress();
+  tracer.Hit(id, outer_frame, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+
+  lldb_eval::ContinueToBreakpoint(debugger_, process_);
+  lldb::SBFrame inner_frame = process_.GetSelectedThread().GetFrameAtIndex(0);
+  uint64_t inner_address = inner_frame.FindVariable("value").GetLoadAddress();
+  ASSERT_NE(inner_address, outer_address);
+  tracer.Hit(id, inner_frame, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+
+  // The caller is the frame of the first hit.
+  tracer.Hit(id, process_.GetSelectedThread().GetFrameAtIndex(1), error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+
+  auto reader = lldb_eval::TraceReader::Open(path, error);
+  ASSERT_TRUE(reader) << error.GetCString();
+  std::vector<lldb_eval::TraceRecord> records = reader->ReadRecords(error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  ASSERT_EQ(records.size(), 3u);
+
+  std::vector<bool> errors = {false, false, false};
+  std::vector<uint64_t> values = {1, 10, outer_address};
+  EXPECT_EQ(records[0].values, values);
+  EXPECT_EQ(records[0].errors, errors);
+  values = {0, 0, inner_address};
+  EXPECT_EQ(records[1].values, values);
+  EXPECT_EQ(records[1].errors, errors);
+  values = {1, 10, outer_address};
+  EXPECT_EQ(records[2].values, values);
+  EXPECT_EQ(records[2].errors, errors);
+}
+
+TEST_F(EvalTest, TestTraceCorruptedSchema) {
+  std::string path = testing::TempDir() + "corrupted_schema.trace";
+  lldb::SBError error;
+  auto buffer = lldb_eval::TraceBuffer::Create(path, 4096, error);
+  ASSERT_TRUE(buffer) << error.GetCString();
+  buffer->AddSchema({1, "location", {}}, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  buffer.reset();
+
+  // Overwrite the length of the location, which follows the 64-byte file
+  // header and the tracepoint id, with a length larger than the file.
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    ASSERT_TRUE(file);
+    uint32_t length = UINT32_MAX;
+    file.seekp(64 + sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    ASSERT_TRUE(file);
+  }
+
+  auto reader = lldb_eval::TraceReader::Open(path, error);
+  EXPECT_EQ(reader, nullptr);
+  EXPECT_STREQ(error.GetCString(), "corrupted tracepoint schemas");
+}
+
+TEST_F(EvalTest, TestWatchSet) {
+  this->compare_with_lldb_ = false;
+  this->allow_side_effects_ = true;
+
+  using Indexes = std::vector<size_t>;
+
+  lldb_eval::WatchSet watches;
+  watches.Add("x");
+  watches.Add("xa[0] + xa[1]");
+  watches.Add("*p");
+  watches.Add("bf.b");
+  watches.Add("y");
+
+  EXPECT_EQ(watches.Update(frame_), (Indexes{0, 1, 2, 3, 4}));
+  EXPECT_EQ(watches.num_evaluated(), 4u);
+  EXPECT_EQ(watches.GetValue(1).GetValueAsSigned(), 3);
+  EXPECT_EQ(watches.GetValue(3).GetValueAsSigned(), 2);
+  EXPECT_EQ(watches.GetError(4).GetError(),
+            static_cast<uint32_t>(lldb_eval::ErrorCode::kUndeclaredIdentifier));
+
+  // Nothing has changed, nothing is evaluated.
+  EXPECT_EQ(watches.Update(frame_), Indexes{});
+  EXPECT_EQ(watches.num_evaluated(), 0u);
+
+  EXPECT_THAT(Eval("xa[1] = 5"), IsEqual("5"));
+  EXPECT_EQ(watches.Update(frame_), Indexes{1});
+  EXPECT_EQ(watches.num_evaluated(), 1u);
+  EXPECT_EQ(watches.GetValue(1).GetValueAsSigned(), 6);
+
+  // `p` points to `x`.
+  EXPECT_THAT(Eval("x = 2"), IsEqual("2"));
+  EXPECT_EQ(watches.Update(frame_), (Indexes{0, 2}));
+  EXPECT_EQ(watches.num_evaluated(), 2u);
+
+  // The input of `bf.b` changes, the result doesn't.
+  EXPECT_THAT(Eval("bf.a = 5"), IsEqual("5"));
+  EXPECT_EQ(watches.Update(frame_), Indexes{});
+  EXPECT_EQ(watches.num_evaluated(), 1u);
+
+  // The pointee of `p` is a new dependency.
+  EXPECT_THAT(Eval("p = &xa[1]"), IsOk());
+  EXPECT_EQ(watches.Update(frame_), Indexes{2});
+  EXPECT_EQ(watches.GetValue(2).GetValueAsSigned(), 5);
+  EXPECT_THAT(Eval("xa[1] = 7"), IsEqual("7"));
+  EXPECT_EQ(watches.Update(frame_), (Indexes{1, 2}));
+}
+
+TEST_F(EvalTest, TestReadSet) {
+  lldb::SBError error;
+  lldb_eval::ReadSet reads;
+  lldb_eval::Options opts;
+  opts.read_set = &reads;
+
+  using Memory = std::map<lldb_eval::MemoryRange, uint64_t>;
+  lldb::addr_t x = frame_.FindVariable("x").GetLoadAddress();
+  lldb::addr_t xa = frame_.FindVariable("xa").GetLoadAddress();
+  lldb::addr_t p = frame_.FindVariable("p").GetLoadAddress();
+  uint64_t ptr_size = process_.GetAddressByteSize();
+
+  lldb_eval::EvaluateExpression(frame_, "x + *p", opts, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(reads.memory(), (Memory{{{x, 4}, 2}, {{p, ptr_size}, 1}}));
+  EXPECT_FALSE(reads.has_untracked());
+
+  // Taking an address doesn't read the value.
+  reads.Clear();
+  lldb_eval::EvaluateExpression(frame_, "&x == &*p", opts, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(reads.memory(), (Memory{{{p, ptr_size}, 1}}));
+
+  // The array is read as a whole when it's converted to a pointer.
+  reads.Clear();
+  lldb_eval::EvaluateExpression(frame_, "xa[1]", opts, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(reads.memory(), (Memory{{{xa, 8}, 1}, {{xa + 4, 4}, 1}}));
+
+  reads.Clear();
+  lldb_eval::EvaluateExpression(frame_, "$rax + $rax", opts, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_TRUE(reads.memory().empty());
+  EXPECT_EQ(reads.registers(), (std::map<std::string, uint64_t>{{"rax", 2}}));
+
+  // Reads are recorded with the typed APIs too.
+  reads.Clear();
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, "bf.a", opts, error), 1);
+  auto bf = frame_.FindVariable("bf");
+  EXPECT_EQ(reads.memory(),
+            (Memory{{{bf.GetLoadAddress(), bf.GetByteSize()}, 1}}));
+}
+
+TEST_F(EvalTest, TestEvalStats) {
+  lldb::SBError error;
+  lldb_eval::EvalStats stats;
+  lldb_eval::Options opts;
+  opts.stats = &stats;
+
+  lldb_eval::EvaluateExpression(frame_, "x + *p", opts, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(stats.parse.count, 1u);
+  EXPECT_EQ(stats.eval.count, 1u);
+  EXPECT_EQ(stats.nodes["BinaryOpNode"].count, 1u);
+  EXPECT_EQ(stats.nodes["UnaryOpNode"].count, 1u);
+  EXPECT_EQ(stats.nodes["IdentifierNode"].count, 2u);
+  EXPECT_EQ(stats.identifier_lookups.count, 2u);
+  EXPECT_EQ(stats.global_lookups.count, 0u);
+  EXPECT_GE(stats.value_reads, 3u);
+  EXPECT_GE(stats.bytes_read, 4u + process_.GetAddressByteSize() + 4u);
+
+  // Statistics are accumulated until they're reset.
+  lldb_eval::EvaluateExpression(frame_, "(char)x", opts, error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(stats.parse.count, 2u);
+  EXPECT_EQ(stats.nodes["CStyleCastNode"].count, 1u);
+  EXPECT_EQ(stats.nodes["IdentifierNode"].count, 3u);
+
+  std::string json = stats.ToJSON();
+  EXPECT_THAT(json, testing::HasSubstr("\"CStyleCastNode\":{\"count\":1,"));
+  EXPECT_THAT(json, testing::HasSubstr("\"parse\":{\"count\":2,"));
+
+  stats.Reset();
+  EXPECT_EQ(stats.parse.count, 0u);
+  EXPECT_TRUE(stats.nodes.empty());
+}
+
+TEST_F(EvalTest, TestTimeTrace) {
+  llvm::timeTraceProfilerInitialize(/*TimeTraceGranularity*/ 0, "eval_test");
+  lldb::SBError error;
+  lldb_eval::EvaluateExpression(frame_, "x + *p", error);
+  ASSERT_TRUE(error.Success()) << error.GetCString();
+
+  llvm::SmallString<1024> json;
+  llvm::raw_svector_ostream os(json);
+  llvm::timeTraceProfilerWrite(os);
+  llvm::timeTraceProfilerCleanup();
+
+  // The phases and every evaluated node are recorded as separate events.
+  for (const char* name :
+       {"Parse", "Lex", "LookupIdentifier", "Evaluate", "BinaryOpNode",
+        "UnaryOpNode", "IdentifierNode"}) {
+    std::string event = "\"name\":\"" + std::string(name) + "\"";
+    EXPECT_THAT(json.str().str(), testing::HasSubstr(event));
+  }
+}
+
+TEST_F(EvalTest, TestEvalBudget) {
+  lldb::SBError error;
+  const char* expr = "x + *p + xa[0] + xa[1]";
+  const uint32_t kBudgetExceeded =
+      static_cast<uint32_t>(lldb_eval::ErrorCode::kBudgetExceeded);
+
+  lldb_eval::Options opts;
+  opts.budget.max_value_reads = 1000;
+  opts.budget.max_bytes_read = 1000;
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, expr, opts, error), 5);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  opts.budget.max_value_reads = 2;
+  lldb_eval::EvaluateExpression(frame_, expr, opts, error);
+  EXPECT_EQ(error.GetError(), kBudgetExceeded);
+  EXPECT_THAT(error.GetCString(), testing::HasSubstr("2 value reads"));
+
+  opts.budget = {};
+  opts.budget.max_bytes_read = 4;
+  lldb_eval::EvaluateExpression(frame_, expr, opts, error);
+  EXPECT_EQ(error.GetError(), kBudgetExceeded);
+
+  opts.budget = {};
+  opts.budget.max_time = std::chrono::nanoseconds(1);
+  lldb_eval::EvaluateExpression(frame_, expr, opts, error);
+  EXPECT_EQ(error.GetError(), kBudgetExceeded);
+
+  opts.budget = {};
+  lldb_eval::CancellationToken token;
+  opts.cancellation = &token;
+  token.Cancel();
+  lldb_eval::EvaluateExpression(frame_, expr, opts, error);
+  EXPECT_EQ(error.GetError(),
+            static_cast<uint32_t>(lldb_eval::ErrorCode::kCancelled));
+
+  token.Reset();
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(frame_, expr, opts, error), 5);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+}
+
+TEST_F(EvalTest, TestMacroLocations) {
+  // LLDB expands `__LINE__` in its own source.
+  this->compare_with_lldb_ = false;
+  EXPECT_THAT(Eval("x +  __LINE__"), IsEqual("2"));
+
+  // The literal is located in the expansion of the macro.
+  auto sm = lldb_eval::SourceManager::Create("  __LINE__");
+  lldb_eval::Error err;
+  lldb_eval::ExprResult tree =
+      lldb_eval::Parser(lldb_eval::Context::Create(sm, frame_)).Run(err);
+  ASSERT_FALSE(err) << err.message();
+  clang::SourceLocation loc = tree->location();
+  ASSERT_TRUE(loc.isMacroID());
+
+  // It's mapped to where the macro is expanded, also after the source manager
+  // used for parsing is gone.
+  std::shared_ptr<const lldb_eval::SourceText> text = sm->GetSourceText();
+  sm.reset();
+  EXPECT_EQ(text->text(), "  __LINE__");
+  EXPECT_EQ(text->GetOffset(loc), 2u);
+  EXPECT_EQ(lldb_eval::FormatDiagnostics(*text, "error", loc),
+            "<expr>:1:3: error\n"
+            "  __LINE__\n"
+            "  ^");
+}
+
+TEST_F(EvalTest, TestTypeCache) {
+  lldb_eval::TypeCache type_cache(process_.GetTarget());
+  lldb_eval::Options opts;
+  opts.type_cache = &type_cache;
+
+  for (int i = 0; i < 2; ++i) {
+    lldb::SBError error;
+    lldb::SBValue value =
+        lldb_eval::EvaluateExpression(frame_, "(ns::myint)1", opts, error);
+    ASSERT_TRUE(error.Success()) << error.GetCString();
+    EXPECT_EQ(value.GetValueAsSigned(), 1);
+  }
+  lldb_eval::TypeSP type = type_cache.Find("ns::myint");
+  ASSERT_NE(type, nullptr);
+  EXPECT_TRUE(type->IsValid());
+
+  // Failed lookups aren't cached.
+  lldb::SBError error;
+  lldb_eval::EvaluateExpression(frame_, "(ns::nonexistent)1", opts, error);
+  EXPECT_TRUE(error.Fail());
+  EXPECT_EQ(type_cache.Find("ns::nonexistent"), nullptr);
+
+  type_cache.Clear();
+  EXPECT_EQ(type_cache.Find("ns::myint"), nullptr);
+}
+
+TEST_F(EvalTest, TestAsyncEvaluator) {
+  lldb_eval::AsyncEvaluator evaluator(frame_);
+  std::vector<std::future<lldb_eval::EvalResult>> results;
+  for (int i = 0; i < 25; ++i) {
+    results.push_back(evaluator.Evaluate("x + *p + xa[0] + xa[1]"));
+    results.push_back(evaluator.Evaluate("bf.c"));
+    results.push_back(evaluator.Evaluate("y"));
+    results.push_back(evaluator.Evaluate("x = 2"));
+  }
+  evaluator.Run();
+
+  for (size_t i = 0; i < results.size(); i += 4) {
+    lldb_eval::EvalResult result = results[i].get();
+    EXPECT_TRUE(result.error.Success()) << result.error.GetCString();
+    EXPECT_EQ(result.value.GetValueAsSigned(), 5);
+    EXPECT_EQ(results[i + 1].get().value.GetValueAsUnsigned(), 3u);
+    EXPECT_EQ(results[i + 2].get().error.GetError(),
+              static_cast<uint32_t>(
+                  lldb_eval::ErrorCode::kUndeclaredIdentifier));
+    // Side effects aren't allowed.
+    EXPECT_TRUE(results[i + 3].get().error.Fail());
+  }
+  EXPECT_EQ(frame_.FindVariable("x").GetValueAsSigned(), 1);
+  // The reads of all expressions are batched, at worst every read of the
+  // longest expression takes a round.
+  EXPECT_LE(evaluator.num_rounds(), 6u);
+  EXPECT_LE(evaluator.num_fetches(), 5u);
+
+  std::future<lldb_eval::EvalResult> cancelled;
+  {
+    lldb_eval::AsyncEvaluator unused(frame_);
+    cancelled = unused.Evaluate("x");
+  }
+  EXPECT_EQ(cancelled.get().error.GetError(),
+            static_cast<uint32_t>(lldb_eval::ErrorCode::kCancelled));
+}
 #endif
 
 TEST_F(EvalTest, TestBuiltinFunction_findnonnull) {
@@ -3551,6 +4262,40 @@ TEST_F(EvalTest, TestSeparateParsing) {
       IsError("expression isn't parsed in the context of compatible type"));
 }
 
+TEST_F(EvalTest, TestSeparateParsingTypedResults) {
+  lldb::SBError error;
+  lldb_eval::Options opts;
+
+  auto expr_c = Scope("c").Compile("a_ * b_ * c_", error);
+  ASSERT_TRUE(error.Success());
+  auto expr_a_half = Scope("a").Compile("a_ / 2.0", error);
+  ASSERT_TRUE(error.Success());
+
+  lldb::SBValue c = frame_.FindVariable("c");
+  lldb::SBValue d = frame_.FindVariable("d");
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(c, expr_c, {}, error), 60);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(lldb_eval::EvaluateToUInt64(d, expr_c, {}, error), 336);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(lldb_eval::EvaluateToDouble(c, expr_a_half, {}, error), 1.5);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_TRUE(lldb_eval::EvaluateToBool(d, expr_c, {}, error));
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(d, "d_ - c_", opts, error), 1);
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+  EXPECT_EQ(lldb_eval::EvaluateToAddress(d, "&d_", opts, error),
+            d.GetChildMemberWithName("d_").GetLoadAddress());
+  EXPECT_TRUE(error.Success()) << error.GetCString();
+
+  // Expression parsed in derived-type scope, evaluated in base-type scope.
+  EXPECT_EQ(lldb_eval::EvaluateToInt64(c, Scope("d").Compile("d_", error), {},
+                                       error),
+            0);
+  EXPECT_STREQ(error.GetCString(),
+               "expression isn't parsed in the context of compatible type");
+}
+
 TEST_F(EvalTest, TestSeparateParsingWithContextVars) {
   ASSERT_TRUE(CreateContextVariable("$x", "1"));
   ASSERT_TRUE(CreateContextVariable("$y", "2.5"));
@@ -3577,7 +4322,9 @@ TEST_F(EvalTest, TestSeparateParsingWithContextVars) {
   std::unordered_map<std::string, lldb::SBValue> incomplete_vars = {
       {"$x", vars_["$x"]}};
   EXPECT_THAT(Scope("c").EvalWithContext(expr_c, incomplete_vars),
-              IsError("use of undeclared identifier '$y'"));
+              IsError("<expr>:1:11: use of undeclared identifier '$y'\n"
+                      "c_ + $x + $y\n"
+                      "          ^"));
 }
 
 TEST_F(EvalTest, TestRegisters) {
@@ -0,0 +1,161 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks evaluating many expressions against a process behind a proxy,
+// which adds a fixed latency to every round trip to lldb-server. Each
+// expression follows a chain of pointers through one of the lists of the test
+// program. Evaluated one by one, every node costs a round trip. Evaluated by
+// `AsyncEvaluator`, the nodes at the same depth of all lists are fetched at
+// once, so the wall time approaches (depth + 1) round trips.
+
+#ifndef _WIN32
+
+#include <errno.h>  // for `program_invocation_name`
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lldb-eval/api.h"
+#include "lldb-eval/runner.h"
+#include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBProcess.h"
+#include "lldb/API/SBThread.h"
+#include "lldb/API/SBValue.h"
+#include "tools/cpp/runfiles/runfiles.h"
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+// Must match the test program.
+static constexpr int kNumLists = 32;
+
+static constexpr auto kRoundTrip = std::chrono::milliseconds(1);
+
+// Expressions reading the value at the `depth` of every list.
+static std::vector<std::string> GetExpressions(int depth) {
+  std::vector<std::string> expressions;
+  for (int i = 0; i < kNumLists; ++i) {
+    std::string expr = "lists[" + std::to_string(i) + "]";
+    for (int j = 1; j < depth; ++j) {
+      expr += "->next";
+    }
+    expressions.push_back(expr + "->value");
+  }
+  return expressions;
+}
+
+class BM : public benchmark::Fixture {
+ public:
+  void SetUp(::benchmark::State& state) override {
+    runfiles.reset(Runfiles::Create(program_invocation_name));
+
+    lldb_eval::SetupLLDBServerEnv(*runfiles);
+
+    auto binary_path = runfiles->Rlocation("lldb_eval/testdata/chain_binary");
+    auto source_path =
+        runfiles->Rlocation("lldb_eval/testdata/chain_binary.cc");
+
+    lldb::SBError error;
+    proxy = lldb_eval::LatencyProxy::Create(kRoundTrip, error);
+    if (error.Fail()) {
+      state.SkipWithError(error.GetCString());
+      return;
+    }
+
+    debugger = lldb::SBDebugger::Create(false);
+    process = lldb_eval::LaunchRemoteTestProgram(
+        debugger, source_path, binary_path, "// BREAK HERE", *proxy);
+  }
+
+  void TearDown(::benchmark::State&) override {
+    process.Destroy();
+    lldb::SBDebugger::Destroy(debugger);
+    proxy.reset();
+  }
+
+  // Resumes the process to drop LLDB's memory cache, which would otherwise
+  // serve all the reads after the first iteration.
+  lldb::SBFrame Restart(benchmark::State& state) {
+    state.PauseTiming();
+    lldb_eval::ContinueToBreakpoint(debugger, process);
+    lldb::SBFrame frame = process.GetSelectedThread().GetSelectedFrame();
+    state.ResumeTiming();
+    return frame;
+  }
+
+  std::unique_ptr<lldb_eval::LatencyProxy> proxy;
+  lldb::SBDebugger debugger;
+  lldb::SBProcess process;
+
+  std::unique_ptr<Runfiles> runfiles;
+};
+
+BENCHMARK_DEFINE_F(BM, Sequential)(benchmark::State& state) {
+  std::vector<std::string> expressions = GetExpressions(state.range(0));
+  for (auto _ : state) {
+    lldb::SBFrame frame = Restart(state);
+    for (const auto& expr : expressions) {
+      lldb::SBError error;
+      lldb::SBValue value =
+          lldb_eval::EvaluateExpression(frame, expr.c_str(), error);
+      value.GetValueAsSigned();
+      if (error.Fail()) {
+        state.SkipWithError(error.GetCString());
+      }
+    }
+  }
+}
+
+BENCHMARK_REGISTER_F(BM, Sequential)
+    ->DenseRange(1, 8)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(BM, Async)(benchmark::State& state) {
+  std::vector<std::string> expressions = GetExpressions(state.range(0));
+  size_t num_rounds = 0;
+  size_t num_fetches = 0;
+  for (auto _ : state) {
+    lldb::SBFrame frame = Restart(state);
+    lldb_eval::AsyncEvaluator evaluator(frame);
+    std::vector<std::future<lldb_eval::EvalResult>> results;
+    for (const auto& expr : expressions) {
+      results.push_back(evaluator.Evaluate(expr));
+    }
+    evaluator.Run();
+    for (auto& future : results) {
+      lldb_eval::EvalResult result = future.get();
+      result.value.GetValueAsSigned();
+      if (result.error.Fail()) {
+        state.SkipWithError(result.error.GetCString());
+      }
+    }
+    num_rounds += evaluator.num_rounds();
+    num_fetches += evaluator.num_fetches();
+  }
+  state.counters["rounds"] =
+      benchmark::Counter(num_rounds, benchmark::Counter::kAvgIterations);
+  state.counters["fetches"] =
+      benchmark::Counter(num_fetches, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_REGISTER_F(BM, Async)
+    ->DenseRange(1, 8)
+    ->Unit(benchmark::kMillisecond);
+
+#endif  // !_WIN32
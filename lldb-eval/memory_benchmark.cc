@@ -0,0 +1,422 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring the memory footprint of parsing and evaluation: the
+// number of heap allocations, allocated bytes, values obtained from LLDB (see
+// `lldb_eval::GetNumCreatedValues`) and the growth of the resident set size.
+
+#ifdef _WIN32
+#include <filesystem>
+#else
+#include <errno.h>  // for `program_invocation_name`
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lldb-eval/api.h"
+#include "lldb-eval/context.h"
+#include "lldb-eval/eval.h"
+#include "lldb-eval/parser.h"
+#include "lldb-eval/runner.h"
+#include "lldb-eval/value.h"
+#include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBProcess.h"
+#include "lldb/API/SBTarget.h"
+#include "lldb/API/SBThread.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "tools/cpp/runfiles/runfiles.h"
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+static std::atomic<uint64_t> num_allocations{0};
+static std::atomic<uint64_t> num_allocated_bytes{0};
+
+// Counts the allocation and allocates the memory with the `alignment`, or the
+// default one if it's 0. Returns nullptr if the allocation fails.
+static void* CountedAlloc(size_t size, size_t alignment) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  num_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+  // Zero-sized allocations must return a unique non-null pointer.
+  size = size > 0 ? size : 1;
+  if (alignment == 0) {
+    return std::malloc(size);
+  }
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  // The size has to be a multiple of the alignment.
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void AlignedFree(void* ptr) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+static void* CheckAlloc(void* ptr) {
+  if (ptr == nullptr) {
+    // Exceptions are disabled, so std::bad_alloc can't be thrown.
+    std::abort();
+  }
+  return ptr;
+}
+
+// Replace the global allocation functions to count every heap allocation made
+// by the process. On Linux this includes the allocations made by liblldb, on
+// Windows only the ones made by lldb-eval and the benchmark itself. The array
+// forms call these ones.
+void* operator new(size_t size) { return CheckAlloc(CountedAlloc(size, 0)); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return CountedAlloc(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  return CheckAlloc(CountedAlloc(size, static_cast<size_t>(alignment)));
+}
+
+void* operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return CountedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept { AlignedFree(ptr); }
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  AlignedFree(ptr);
+}
+
+// Returns the resident set size of the current process in bytes or 0 if it
+// can't be determined on this platform.
+static size_t GetResidentSetSize() {
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  statm >> total_pages >> resident_pages;
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+  return 0;
+#endif
+}
+
+// Snapshot of the process-wide memory counters. Reports the difference to the
+// current state as per-iteration benchmark counters.
+class MemoryCounters {
+ public:
+  MemoryCounters()
+      : allocations_(num_allocations.load(std::memory_order_relaxed)),
+        allocated_bytes_(num_allocated_bytes.load(std::memory_order_relaxed)),
+        created_values_(lldb_eval::GetNumCreatedValues()) {}
+
+  void Report(benchmark::State& state) const {
+    MemoryCounters now;
+    auto per_iteration = [](uint64_t value) {
+      return benchmark::Counter(static_cast<double>(value),
+                                benchmark::Counter::kAvgIterations);
+    };
+    state.counters["allocs"] = per_iteration(now.allocations_ - allocations_);
+    state.counters["bytes"] =
+        per_iteration(now.allocated_bytes_ - allocated_bytes_);
+    state.counters["lldb_values"] =
+        per_iteration(now.created_values_ - created_values_);
+  }
+
+ private:
+  uint64_t allocations_;
+  uint64_t allocated_bytes_;
+  uint64_t created_values_;
+};
+
+static const char* kExpressions[] = {
+    "1 + 1",
+    "*arr",
+    "arr[0]",
+    "arr[0] + arr[1] * arr[2]",
+    "(char)1 + (short)1.1f + (long long)1.1 + (double)(char)2",
+};
+
+static const int kNumExpressions = static_cast<int>(std::size(kExpressions));
+
+class BM : public benchmark::Fixture {
+ public:
+  void SetUp(::benchmark::State&) override {
+#ifdef _WIN32
+    auto cwd = std::filesystem::current_path();
+    std::string argv0 =
+        cwd.parent_path().append("memory_benchmark.exe").string();
+#else
+    std::string argv0 = program_invocation_name;
+#endif
+
+    runfiles.reset(Runfiles::Create(argv0));
+
+    lldb_eval::SetupLLDBServerEnv(*runfiles);
+
+    auto binary_path =
+        runfiles->Rlocation("lldb_eval/testdata/benchmark_binary");
+    auto source_path =
+        runfiles->Rlocation("lldb_eval/testdata/benchmark_binary.cc");
+
+    debugger = lldb::SBDebugger::Create(false);
+    process = lldb_eval::LaunchTestProgram(debugger, source_path, binary_path,
+                                           "// BREAK HERE");
+    frame = process.GetSelectedThread().GetSelectedFrame();
+  }
+
+  void TearDown(::benchmark::State&) override {
+    process.Destroy();
+    lldb::SBDebugger::Destroy(debugger);
+  }
+
+  lldb::SBDebugger debugger;
+  lldb::SBProcess process;
+  lldb::SBFrame frame;
+
+  std::unique_ptr<Runfiles> runfiles;
+};
+
+// Measures the memory cost of parsing an expression in the context of a frame.
+BENCHMARK_DEFINE_F(BM, ParseAllocations)(benchmark::State& state) {
+  const char* expr = kExpressions[state.range(0)];
+  state.SetLabel(expr);
+
+  MemoryCounters counters;
+  for (auto _ : state) {
+    auto context = lldb_eval::Context::Create(
+        lldb_eval::SourceManager::Create(expr), frame);
+
+    lldb_eval::Error err;
+    lldb_eval::Parser(context).Run(err);
+
+    if (err) {
+      state.SkipWithError("Failed to parse the expression!");
+    }
+  }
+  counters.Report(state);
+}
+
+BENCHMARK_REGISTER_F(BM, ParseAllocations)->DenseRange(0, kNumExpressions - 1);
+
+// Measures the memory cost of evaluating an already parsed expression.
+BENCHMARK_DEFINE_F(BM, EvalAllocations)(benchmark::State& state) {
+  const char* expr = kExpressions[state.range(0)];
+  state.SetLabel(expr);
+
+  auto source = lldb_eval::SourceManager::Create(expr);
+  auto context = lldb_eval::Context::Create(source, frame);
+  lldb_eval::Error err;
+  auto tree = lldb_eval::Parser(context).Run(err);
+  if (err) {
+    state.SkipWithError("Failed to parse the expression!");
+    return;
+  }
+  lldb::SBTarget target = process.GetTarget();
+  auto text = source->GetSourceText();
+
+  MemoryCounters counters;
+  for (auto _ : state) {
+    lldb_eval::Interpreter interpreter(target, text);
+    interpreter.Eval(tree.get(), err);
+
+    if (err) {
+      state.SkipWithError("Failed to evaluate the expression!");
+    }
+  }
+  counters.Report(state);
+}
+
+BENCHMARK_REGISTER_F(BM, EvalAllocations)->DenseRange(0, kNumExpressions - 1);
+
+// Measures how much the resident set grows over a long series of evaluations.
+// A steady growth means that memory is held for every evaluation (e.g. by the
+// values created for the intermediate results) and never released.
+BENCHMARK_DEFINE_F(BM, EvalRssGrowth)(benchmark::State& state) {
+  const char* expr = kExpressions[kNumExpressions - 1];
+  state.SetLabel(expr);
+
+  auto source = lldb_eval::SourceManager::Create(expr);
+  auto context = lldb_eval::Context::Create(source, frame);
+  lldb_eval::Error err;
+  auto tree = lldb_eval::Parser(context).Run(err);
+  if (err) {
+    state.SkipWithError("Failed to parse the expression!");
+    return;
+  }
+  lldb::SBTarget target = process.GetTarget();
+  auto text = source->GetSourceText();
+
+  MemoryCounters counters;
+  size_t rss_before = GetResidentSetSize();
+  for (auto _ : state) {
+    lldb_eval::Interpreter interpreter(target, text);
+    interpreter.Eval(tree.get(), err);
+
+    if (err) {
+      state.SkipWithError("Failed to evaluate the expression!");
+    }
+  }
+  size_t rss_after = GetResidentSetSize();
+  counters.Report(state);
+
+  double rss_growth =
+      static_cast<double>(rss_after) - static_cast<double>(rss_before);
+  state.counters["rss_growth_bytes"] = rss_growth;
+  state.counters["rss_bytes_per_eval"] =
+      benchmark::Counter(rss_growth, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_REGISTER_F(BM, EvalRssGrowth)
+    ->Iterations(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+// Soak test simulating a long-running session, e.g. a breakpoint condition
+// evaluated on every hit. The resident set is expected to stay flat after the
+// warm-up, since the intermediate results don't allocate anything in LLDB.
+BENCHMARK_DEFINE_F(BM, EvalRssSoak)(benchmark::State& state) {
+  const int64_t kNumEvals = state.range(0);
+  const int64_t kNumWarmupEvals = kNumEvals / 10;
+  const char* expr = "arr[0] + arr[1] * (char)arr[2] > (short)1.1f && arr[1]";
+  state.SetLabel(expr);
+
+  auto source = lldb_eval::SourceManager::Create(expr);
+  auto context = lldb_eval::Context::Create(source, frame);
+  lldb_eval::Error err;
+  auto tree = lldb_eval::Parser(context).Run(err);
+  if (err) {
+    state.SkipWithError("Failed to parse the expression!");
+    return;
+  }
+  lldb::SBTarget target = process.GetTarget();
+  auto text = source->GetSourceText();
+
+  for (auto _ : state) {
+    uint64_t values_before = lldb_eval::GetNumCreatedValues();
+    size_t rss_after_warmup = 0;
+
+    for (int64_t i = 0; i < kNumEvals; ++i) {
+      if (i == kNumWarmupEvals) {
+        rss_after_warmup = GetResidentSetSize();
+      }
+
+      lldb_eval::Interpreter interpreter(target, text);
+      interpreter.Eval(tree.get(), err);
+
+      if (err) {
+        state.SkipWithError("Failed to evaluate the expression!");
+        break;
+      }
+    }
+    size_t rss_after = GetResidentSetSize();
+    uint64_t values_after = lldb_eval::GetNumCreatedValues();
+
+    state.counters["rss_growth_bytes"] = static_cast<double>(rss_after) -
+                                         static_cast<double>(rss_after_warmup);
+    state.counters["lldb_values_per_eval"] =
+        static_cast<double>(values_after - values_before) / kNumEvals;
+  }
+}
+
+BENCHMARK_REGISTER_F(BM, EvalRssSoak)
+    ->ArgName("evals")
+    ->Arg(10000000)
+    ->Iterations(1)
+    ->Unit(benchmark::kSecond);
+
+// Measures the memory footprint of cached compiled expressions. If the argument
+// is non-zero, a source manager is retained alongside every compiled
+// expression, which is how `CompiledExpr` used to store the expression source.
+BENCHMARK_DEFINE_F(BM, CompiledExprFootprint)(benchmark::State& state) {
+  const size_t kNumExprs = 10000;
+  bool retain_source_manager = state.range(0) != 0;
+  lldb::SBTarget target = process.GetTarget();
+
+  for (auto _ : state) {
+    std::vector<std::shared_ptr<lldb_eval::CompiledExpr>> compiled_exprs;
+    std::vector<std::shared_ptr<lldb_eval::SourceManager>> source_managers;
+    compiled_exprs.reserve(kNumExprs);
+    source_managers.reserve(kNumExprs);
+
+    size_t rss_before = GetResidentSetSize();
+    for (size_t i = 0; i < kNumExprs; ++i) {
+      std::string expr = llvm::formatv("(char){0} + (short)1.1f", i % 128);
+
+      lldb::SBError error;
+      compiled_exprs.push_back(lldb_eval::CompileExpression(
+          target, lldb::SBType(), expr.c_str(), error));
+      if (error.Fail()) {
+        state.SkipWithError("Failed to compile the expression!");
+        break;
+      }
+      if (retain_source_manager) {
+        source_managers.push_back(lldb_eval::SourceManager::Create(expr));
+      }
+    }
+    size_t rss_after = GetResidentSetSize();
+
+    state.counters["rss_bytes_per_expr"] =
+        (static_cast<double>(rss_after) - static_cast<double>(rss_before)) /
+        kNumExprs;
+  }
+}
+
+BENCHMARK_REGISTER_F(BM, CompiledExprFootprint)
+    ->ArgName("retain_source_manager")
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+  lldb::SBDebugger::Initialize();
+
+  // Same as BENCHMARK_MAIN()
+  // clang-format off
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  // clang-format on
+
+  lldb::SBDebugger::Terminate();
+}
@@ -0,0 +1,133 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lldb-eval/memory_overlay.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBProcess.h"
+
+namespace lldb_eval {
+
+void MemoryOverlay::Write(lldb::addr_t addr, const void* data, size_t size) {
+  auto src = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    lldb::addr_t base = addr - addr % kPageSize;
+    size_t offset = addr - base;
+    size_t count = std::min<size_t>(size, kPageSize - offset);
+
+    Page& page = pages_[base];
+    std::copy(src, src + count, page.data + offset);
+    for (size_t i = offset; i < offset + count; ++i) {
+      page.written.set(i);
+    }
+
+    addr += count;
+    src += count;
+    size -= count;
+  }
+}
+
+void MemoryOverlay::Read(lldb::addr_t addr, void* data, size_t size) const {
+  auto dst = static_cast<uint8_t*>(data);
+  while (size > 0) {
+    lldb::addr_t base = addr - addr % kPageSize;
+    size_t offset = addr - base;
+    size_t count = std::min<size_t>(size, kPageSize - offset);
+
+    auto it = pages_.find(base);
+    if (it != pages_.end()) {
+      const Page& page = it->second;
+      for (size_t i = 0; i < count; ++i) {
+        if (page.written.test(offset + i)) {
+          dst[i] = page.data[offset + i];
+        }
+      }
+    }
+
+    addr += count;
+    dst += count;
+    size -= count;
+  }
+}
+
+bool MemoryOverlay::Covers(lldb::addr_t addr, size_t size) const {
+  while (size > 0) {
+    lldb::addr_t base = addr - addr % kPageSize;
+    size_t offset = addr - base;
+    size_t count = std::min<size_t>(size, kPageSize - offset);
+
+    auto it = pages_.find(base);
+    if (it != pages_.end()) {
+      for (size_t i = offset; i < offset + count; ++i) {
+        if (it->second.written.test(i)) {
+          return true;
+        }
+      }
+    }
+
+    addr += count;
+    size -= count;
+  }
+  return false;
+}
+
+void MemoryOverlay::Commit(lldb::SBProcess process, lldb::SBError& error) {
+  error.Clear();
+
+  // Written bytes are collected into a contiguous range until there is a gap,
+  // then the range is written at once.
+  lldb::addr_t range_addr = 0;
+  std::vector<uint8_t> range;
+  auto flush = [&]() {
+    if (range.empty()) {
+      return;
+    }
+    // A failed write doesn't stop the other ranges, the first error is kept.
+    lldb::SBError write_error;
+    process.WriteMemory(range_addr, range.data(), range.size(), write_error);
+    if (write_error.Fail() && error.Success()) {
+      error = write_error;
+    }
+    range.clear();
+  };
+
+  for (const auto& [base, page] : pages_) {
+    for (size_t i = 0; i < kPageSize; ++i) {
+      if (!page.written.test(i)) {
+        flush();
+        continue;
+      }
+      if (range.empty()) {
+        range_addr = base + i;
+      }
+      range.push_back(page.data[i]);
+    }
+    // The range continues on the next page only if it's adjacent.
+    auto next = pages_.upper_bound(base);
+    if (next == pages_.end() || next->first != base + kPageSize) {
+      flush();
+    }
+  }
+  flush();
+
+  if (error.Success()) {
+    Discard();
+  }
+}
+
+}  // namespace lldb_eval
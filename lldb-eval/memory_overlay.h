@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_MEMORY_OVERLAY_H_
+#define LLDB_EVAL_MEMORY_OVERLAY_H_
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBProcess.h"
+#include "lldb/lldb-types.h"
+
+namespace lldb_eval {
+
+// Copy-on-write overlay of the process memory. If an overlay is passed via
+// `Options::memory_overlay`, the side effects of the evaluation (e.g. `x = 1`
+// or `++p->y`) are written to the overlay instead of the process, and all
+// later reads through the overlay -- in the same evaluation or in subsequent
+// ones -- see the written data. The process isn't modified until the overlay
+// is committed, so "what-if" evaluations can be discarded without a trace.
+//
+// Memory is tracked in pages, only the bytes written are taken from the
+// overlay. The overlay isn't thread-safe.
+class MemoryOverlay {
+ public:
+  static constexpr lldb::addr_t kPageSize = 4096;
+
+  // Writes `size` bytes of `data` to the overlay at the address `addr`.
+  void Write(lldb::addr_t addr, const void* data, size_t size);
+
+  // Replaces the bytes of `data`, which were read from the process at `addr`,
+  // with the bytes written to the overlay.
+  void Read(lldb::addr_t addr, void* data, size_t size) const;
+
+  // Returns true if any byte of the range was written to the overlay.
+  bool Covers(lldb::addr_t addr, size_t size) const;
+
+  // Writes the data of the overlay to the `process`, with a single write per
+  // contiguous range, and clears the overlay. Every range is written even if
+  // some of them fail; the first error is reported and the overlay is kept.
+  void Commit(lldb::SBProcess process, lldb::SBError& error);
+
+  // Drops all writes.
+  void Discard() { pages_.clear(); }
+
+  bool IsEmpty() const { return pages_.empty(); }
+
+ private:
+  struct Page {
+    uint8_t data[kPageSize];
+    std::bitset<kPageSize> written;
+  };
+
+  // Pages by their base address. Ordered, so that the adjacent pages can be
+  // committed together.
+  std::map<lldb::addr_t, Page> pages_;
+};
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_MEMORY_OVERLAY_H_
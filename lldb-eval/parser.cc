@@ -40,12 +40,14 @@
 #include "clang/Lex/Token.h"
 #include "lldb-eval/ast.h"
 #include "lldb-eval/defines.h"
+#include "lldb-eval/stats.h"
 #include "lldb/lldb-enumerations.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/FormatAdapters.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/TimeProfiler.h"
 
 namespace {
 
@@ -722,6 +724,10 @@ Parser::Parser(std::shared_ptr<ParserContext> ctx) : ctx_(std::move(ctx)) {
 }
 
 ExprResult Parser::Run(Error& error) {
+  llvm::TimeTraceScope trace("Parse");
+  EvalStats* stats = ctx_->stats();
+  ScopedStatsTimer timer(stats ? &stats->parse : nullptr);
+
   ConsumeToken();
 
   ExprResult expr;
@@ -782,6 +788,7 @@ void Parser::ConsumeToken() {
     // occurred during parsing and we're trying to bail out.
     return;
   }
+  llvm::TimeTraceScope trace("Lex");
   pp_->Lex(token_);
 }
 
@@ -802,7 +809,10 @@ void Parser::BailOut(ErrorCode code, const std::string& error,
 //  expression:
 //    assignment_expression
 //
-ExprResult Parser::ParseExpression() { return ParseAssignmentExpression(); }
+ExprResult Parser::ParseExpression() {
+  llvm::TimeTraceScope trace("ParseExpression");
+  return ParseAssignmentExpression();
+}
 
 // Parse an assingment_expression.
 //
@@ -828,6 +838,7 @@ ExprResult Parser::ParseExpression() { return ParseAssignmentExpression(); }
 //    logical_or_expression "?" expression ":" assignment_expression
 //
 ExprResult Parser::ParseAssignmentExpression() {
+  llvm::TimeTraceScope trace("ParseAssignmentExpression");
   auto lhs = ParseLogicalOrExpression();
 
   // Check if it's an assingment expression.
@@ -866,6 +877,7 @@ ExprResult Parser::ParseAssignmentExpression() {
 //    logical_and_expression {"||" logical_and_expression}
 //
 ExprResult Parser::ParseLogicalOrExpression() {
+  llvm::TimeTraceScope trace("ParseLogicalOrExpression");
   auto lhs = ParseLogicalAndExpression();
 
   while (token_.is(clang::tok::pipepipe)) {
@@ -885,6 +897,7 @@ ExprResult Parser::ParseLogicalOrExpression() {
 //    inclusive_or_expression {"&&" inclusive_or_expression}
 //
 ExprResult Parser::ParseLogicalAndExpression() {
+  llvm::TimeTraceScope trace("ParseLogicalAndExpression");
   auto lhs = ParseInclusiveOrExpression();
 
   while (token_.is(clang::tok::ampamp)) {
@@ -904,6 +917,7 @@ ExprResult Parser::ParseLogicalAndExpression() {
 //    exclusive_or_expression {"|" exclusive_or_expression}
 //
 ExprResult Parser::ParseInclusiveOrExpression() {
+  llvm::TimeTraceScope trace("ParseInclusiveOrExpression");
   auto lhs = ParseExclusiveOrExpression();
 
   while (token_.is(clang::tok::pipe)) {
@@ -923,6 +937,7 @@ ExprResult Parser::ParseInclusiveOrExpression() {
 //    and_expression {"^" and_expression}
 //
 ExprResult Parser::ParseExclusiveOrExpression() {
+  llvm::TimeTraceScope trace("ParseExclusiveOrExpression");
   auto lhs = ParseAndExpression();
 
   while (token_.is(clang::tok::caret)) {
@@ -942,6 +957,7 @@ ExprResult Parser::ParseExclusiveOrExpression() {
 //    equality_expression {"&" equality_expression}
 //
 ExprResult Parser::ParseAndExpression() {
+  llvm::TimeTraceScope trace("ParseAndExpression");
   auto lhs = ParseEqualityExpression();
 
   while (token_.is(clang::tok::amp)) {
@@ -962,6 +978,7 @@ ExprResult Parser::ParseAndExpression() {
 //    relational_expression {"!=" relational_expression}
 //
 ExprResult Parser::ParseEqualityExpression() {
+  llvm::TimeTraceScope trace("ParseEqualityExpression");
   auto lhs = ParseRelationalExpression();
 
   while (token_.isOneOf(clang::tok::equalequal, clang::tok::exclaimequal)) {
@@ -984,6 +1001,7 @@ ExprResult Parser::ParseEqualityExpression() {
 //    shift_expression {">=" shift_expression}
 //
 ExprResult Parser::ParseRelationalExpression() {
+  llvm::TimeTraceScope trace("ParseRelationalExpression");
   auto lhs = ParseShiftExpression();
 
   while (token_.isOneOf(clang::tok::less, clang::tok::greater,
@@ -1005,6 +1023,7 @@ ExprResult Parser::ParseRelationalExpression() {
 //    additive_expression {">>" additive_expression}
 //
 ExprResult Parser::ParseShiftExpression() {
+  llvm::TimeTraceScope trace("ParseShiftExpression");
   auto lhs = ParseAdditiveExpression();
 
   while (token_.isOneOf(clang::tok::lessless, clang::tok::greatergreater)) {
@@ -1025,6 +1044,7 @@ ExprResult Parser::ParseShiftExpression() {
 //    multiplicative_expression {"-" multiplicative_expression}
 //
 ExprResult Parser::ParseAdditiveExpression() {
+  llvm::TimeTraceScope trace("ParseAdditiveExpression");
   auto lhs = ParseMultiplicativeExpression();
 
   while (token_.isOneOf(clang::tok::plus, clang::tok::minus)) {
@@ -1046,6 +1066,7 @@ ExprResult Parser::ParseAdditiveExpression() {
 //    cast_expression {"%" cast_expression}
 //
 ExprResult Parser::ParseMultiplicativeExpression() {
+  llvm::TimeTraceScope trace("ParseMultiplicativeExpression");
   auto lhs = ParseCastExpression();
 
   while (token_.isOneOf(clang::tok::star, clang::tok::slash,
@@ -1067,6 +1088,7 @@ ExprResult Parser::ParseMultiplicativeExpression() {
 //    "(" type_id ")" cast_expression
 //
 ExprResult Parser::ParseCastExpression() {
+  llvm::TimeTraceScope trace("ParseCastExpression");
   // This can be a C-style cast, try parsing the contents as a type declaration.
   if (token_.is(clang::tok::l_paren)) {
     clang::Token token = token_;
@@ -1125,6 +1147,7 @@ ExprResult Parser::ParseCastExpression() {
 //    "!"
 //
 ExprResult Parser::ParseUnaryExpression() {
+  llvm::TimeTraceScope trace("ParseUnaryExpression");
   if (token_.isOneOf(clang::tok::plusplus, clang::tok::minusminus,
                      clang::tok::star, clang::tok::amp, clang::tok::plus,
                      clang::tok::minus, clang::tok::exclaim,
@@ -1224,6 +1247,7 @@ ExprResult Parser::ParseUnaryExpression() {
 //    reinterpret_cast "<" type_id ">" "(" expression ")" ;
 //
 ExprResult Parser::ParsePostfixExpression() {
+  llvm::TimeTraceScope trace("ParsePostfixExpression");
   // Parse the first part of the postfix_expression. This could be either a
   // primary_expression, or a postfix_expression itself.
   ExprResult lhs;
@@ -1331,6 +1355,7 @@ ExprResult Parser::ParsePostfixExpression() {
 //    builtin_func
 //
 ExprResult Parser::ParsePrimaryExpression() {
+  llvm::TimeTraceScope trace("ParsePrimaryExpression");
   if (token_.is(clang::tok::numeric_constant)) {
     return ParseNumericLiteral();
   } else if (token_.isOneOf(clang::tok::kw_true, clang::tok::kw_false)) {
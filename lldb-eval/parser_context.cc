@@ -1,5 +1,12 @@
 #include "lldb-eval/parser_context.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+
 #include "clang/Basic/SourceManager.h"
 #include "llvm/Support/FormatAdapters.h"
 #include "llvm/Support/FormatVariadic.h"
@@ -89,13 +96,9 @@ static Type::MemberInfo GetFieldWithNameIndexPath(TypeSP type,
   return {{}, empty_type, false, 0};
 }
 
-std::string FormatDiagnostics(clang::SourceManager& sm,
-                              const std::string& message,
-                              clang::SourceLocation loc) {
-  // Get the source buffer and the location of the current token.
-  llvm::StringRef text = sm.getBufferData(sm.getFileID(loc));
-  size_t loc_offset = sm.getCharacterData(loc) - text.data();
-
+static std::string FormatDiagnostics(llvm::StringRef text,
+                                     const std::string& message,
+                                     size_t loc_offset) {
   // Look for the start of the line.
   size_t line_start = text.rfind('\n', loc_offset);
   line_start = line_start == llvm::StringRef::npos ? 0 : line_start + 1;
@@ -107,18 +110,79 @@ std::string FormatDiagnostics(clang::SourceManager& sm,
   // Get a view of the current line in the source code and the position of the
   // diagnostics pointer.
   llvm::StringRef line = text.slice(line_start, line_end);
-  int32_t arrow = sm.getPresumedColumnNumber(loc);
+  size_t line_number = text.take_front(line_start).count('\n') + 1;
+  int32_t arrow = static_cast<int32_t>(loc_offset - line_start) + 1;
 
   // Calculate the padding in case we point outside of the expression (this can
   // happen if the parser expected something, but got EOF).
   size_t expr_rpad = std::max(0, arrow - static_cast<int32_t>(line.size()));
   size_t arrow_rpad = std::max(0, static_cast<int32_t>(line.size()) - arrow);
 
-  return llvm::formatv("{0}: {1}\n{2}\n{3}", loc.printToString(sm), message,
-                       llvm::fmt_pad(line, 0, expr_rpad),
+  return llvm::formatv("<expr>:{0}:{1}: {2}\n{3}\n{4}", line_number, arrow,
+                       message, llvm::fmt_pad(line, 0, expr_rpad),
                        llvm::fmt_pad("^", arrow - 1, arrow_rpad));
 }
 
+std::string FormatDiagnostics(clang::SourceManager& sm,
+                              const std::string& message,
+                              clang::SourceLocation loc) {
+  // Get the source buffer and the location of the current token.
+  llvm::StringRef text = sm.getBufferData(sm.getFileID(loc));
+  size_t loc_offset = sm.getCharacterData(loc) - text.data();
+
+  return FormatDiagnostics(text, message, loc_offset);
+}
+
+std::shared_ptr<const SourceText> SourceText::Create(
+    std::string text, const clang::SourceManager& sm) {
+  std::vector<Expansion> expansions;
+  for (unsigned i = 0; i < sm.local_sloc_entry_size(); ++i) {
+    const clang::SrcMgr::SLocEntry& entry = sm.getLocalSLocEntry(i);
+    if (!entry.isExpansion()) {
+      continue;
+    }
+    // The first entry is a placeholder without a location.
+    clang::SourceLocation loc = entry.getExpansion().getExpansionLocStart();
+    if (loc.isValid()) {
+      expansions.emplace_back(entry.getOffset(), sm.getExpansionLoc(loc));
+    }
+  }
+  clang::SourceLocation start = sm.getLocForStartOfFile(sm.getMainFileID());
+  return std::shared_ptr<const SourceText>(
+      new SourceText(std::move(text), start, std::move(expansions)));
+}
+
+size_t SourceText::GetOffset(clang::SourceLocation loc) const {
+  if (loc.isInvalid()) {
+    // Nodes which don't originate from a token, e.g. `ErrorNode`.
+    return 0;
+  }
+  if (loc.isMacroID()) {
+    loc = GetExpansionLoc(loc);
+  }
+  size_t offset = loc.getRawEncoding() - start_.getRawEncoding();
+  assert(offset <= text_.size() && "location is outside of the expression");
+  return offset;
+}
+
+clang::SourceLocation SourceText::GetExpansionLoc(
+    clang::SourceLocation loc) const {
+  // The raw encoding of a macro location is its offset with the top bit set.
+  auto raw = loc.getRawEncoding();
+  uint64_t offset = raw & ~(decltype(raw){1} << (sizeof(raw) * 8 - 1));
+  auto it = std::upper_bound(expansions_.begin(), expansions_.end(), offset,
+                             [](uint64_t value, const Expansion& e) {
+                               return value < e.first;
+                             });
+  return it == expansions_.begin() ? start_ : std::prev(it)->second;
+}
+
+std::string FormatDiagnostics(const SourceText& source,
+                              const std::string& message,
+                              clang::SourceLocation loc) {
+  return FormatDiagnostics(source.text(), message, source.GetOffset(loc));
+}
+
 void ParserContext::SetAllowSideEffects(bool allow_side_effects) {
   allow_side_effects_ = allow_side_effects;
 }
@@ -127,6 +191,7 @@ bool ParserContext::AllowSideEffects() const { return allow_side_effects_; }
 
 std::tuple<Type::MemberInfo, std::vector<uint32_t>>
 ParserContext::GetMemberInfo(TypeSP type, const std::string& name) const {
+  ScopedStatsTimer timer(stats_ ? &stats_->member_lookups : nullptr);
   std::vector<uint32_t> idx;
   auto member = GetFieldWithNameIndexPath(type, name, &idx, GetEmptyType());
   std::reverse(idx.begin(), idx.end());
@@ -1,7 +1,14 @@
 #ifndef LLDB_EVAL_PARSER_CONTEXT_H_
 #define LLDB_EVAL_PARSER_CONTEXT_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "clang/Basic/SourceManager.h"
+#include "lldb-eval/stats.h"
 #include "lldb-eval/type.h"
 #include "lldb/lldb-enumerations.h"
 
@@ -15,6 +22,8 @@ enum class ErrorCode : unsigned char {
   kUndeclaredIdentifier,
   kNotImplemented,
   kUnknown,
+  kBudgetExceeded,
+  kCancelled,
 };
 
 enum class UbStatus : unsigned char {
@@ -72,17 +81,67 @@ class ParserContext {
   void SetAllowSideEffects(bool allow_side_effects);
   bool AllowSideEffects() const;
 
+  // Records the parsing time and the lookups to `stats`, if it's set.
+  void SetStats(EvalStats* stats) { stats_ = stats; }
+  EvalStats* stats() const { return stats_; }
+
   std::tuple<Type::MemberInfo, std::vector<uint32_t>> GetMemberInfo(
       TypeSP type, const std::string& name) const;
 
  private:
   // Whether side effects should be allowed.
   bool allow_side_effects_ = false;
+
+ protected:
+  EvalStats* stats_ = nullptr;
+};
+
+// Expression text along with the location of its first character and of the
+// macro expansions in the source manager used for parsing. This is enough to
+// map source locations stored in the AST back to the text, so unlike
+// clang::SourceManager it is cheap to keep around after parsing (e.g. for
+// formatting evaluation errors). It's immutable and doesn't refer to the
+// source manager, so it can be shared across threads.
+class SourceText {
+ public:
+  // Takes a snapshot of the expression parsed with `sm`. Macros expanded later
+  // aren't known to the snapshot, so it should be taken after parsing.
+  static std::shared_ptr<const SourceText> Create(
+      std::string text, const clang::SourceManager& sm);
+
+  const std::string& text() const { return text_; }
+
+  // Returns the byte offset of `loc` in the expression text. Locations in
+  // macro expansions (e.g. `__LINE__`) are mapped to where the macro is
+  // expanded.
+  size_t GetOffset(clang::SourceLocation loc) const;
+
+ private:
+  // Offset of a macro expansion in the source location space along with the
+  // location it's expanded at.
+  using Expansion = std::pair<uint64_t, clang::SourceLocation>;
+
+  SourceText(std::string text, clang::SourceLocation start,
+             std::vector<Expansion> expansions)
+      : text_(std::move(text)),
+        start_(start),
+        expansions_(std::move(expansions)) {}
+
+  clang::SourceLocation GetExpansionLoc(clang::SourceLocation loc) const;
+
+  const std::string text_;
+  const clang::SourceLocation start_;
+  // Sorted by the offsets.
+  const std::vector<Expansion> expansions_;
 };
 
 std::string FormatDiagnostics(clang::SourceManager& sm,
                               const std::string& message,
                               clang::SourceLocation loc);
 
+std::string FormatDiagnostics(const SourceText& source,
+                              const std::string& message,
+                              clang::SourceLocation loc);
+
 }  // namespace lldb_eval
 #endif  // LLDB_EVAL_PARSER_CONTEXT_H_
@@ -0,0 +1,92 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lldb-eval/read_set.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lldb_eval {
+
+void ReadSet::AddMemory(lldb::addr_t addr, uint64_t size) {
+  if (size > 0) {
+    ++memory_[{addr, size}];
+  }
+}
+
+void ReadSet::AddRegister(const std::string& name) { ++registers_[name]; }
+
+void ReadSet::Clear() {
+  memory_.clear();
+  registers_.clear();
+  has_untracked_ = false;
+}
+
+// End of the range, saturated for the ranges wrapping around the address
+// space.
+static lldb::addr_t GetRangeEnd(lldb::addr_t addr, uint64_t size) {
+  lldb::addr_t max = std::numeric_limits<lldb::addr_t>::max();
+  return size > max - addr ? max : addr + size;
+}
+
+bool FetchSet::Check(lldb::addr_t addr, uint64_t size) {
+  if (size == 0) {
+    return true;
+  }
+  // The fetched range containing `addr` is the last one starting before it.
+  auto it = fetched_.upper_bound(addr);
+  if (it != fetched_.begin() &&
+      GetRangeEnd(addr, size) <= std::prev(it)->second) {
+    return true;
+  }
+  queued_.push_back({addr, size});
+  return false;
+}
+
+std::vector<MemoryRange> FetchSet::TakeQueued() {
+  std::vector<MemoryRange> queued = std::move(queued_);
+  queued_.clear();
+  std::sort(queued.begin(), queued.end());
+  queued.erase(std::unique(queued.begin(), queued.end()), queued.end());
+  return queued;
+}
+
+void FetchSet::AddFetched(lldb::addr_t addr, uint64_t size) {
+  if (size == 0) {
+    return;
+  }
+  lldb::addr_t begin = addr;
+  lldb::addr_t end = GetRangeEnd(addr, size);
+  // Merge with the fetched ranges overlapping or touching this one.
+  auto it = fetched_.upper_bound(begin);
+  if (it != fetched_.begin() && std::prev(it)->second >= begin) {
+    --it;
+  }
+  while (it != fetched_.end() && it->first <= end) {
+    begin = std::min(begin, it->first);
+    end = std::max(end, it->second);
+    it = fetched_.erase(it);
+  }
+  fetched_.emplace(begin, end);
+}
+
+void FetchSet::Clear() {
+  fetched_.clear();
+  queued_.clear();
+}
+
+}  // namespace lldb_eval
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_READ_SET_H_
+#define LLDB_EVAL_READ_SET_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lldb/lldb-types.h"
+
+namespace lldb_eval {
+
+struct MemoryRange {
+  lldb::addr_t addr;
+  uint64_t size;
+
+  bool operator==(const MemoryRange& other) const {
+    return addr == other.addr && size == other.size;
+  }
+  bool operator<(const MemoryRange& other) const {
+    return addr != other.addr ? addr < other.addr : size < other.size;
+  }
+};
+
+// Memory ranges and registers read by an evaluation, with the number of reads
+// of each. The result of the evaluation depends only on these, unless
+// `has_untracked()` is true (e.g. the expression reads a variable stored in a
+// register, which LLDB doesn't name).
+//
+// Reads are recorded for values of identifiers, dereferences, subscripts,
+// members accessed through pointers, smart pointers converted to pointers and
+// the memory scanned by `__findnonnull`. A read of a whole object covers the
+// reads of its members. Taking an address doesn't read anything.
+class ReadSet {
+ public:
+  void AddMemory(lldb::addr_t addr, uint64_t size);
+  void AddRegister(const std::string& name);
+  void AddUntracked() { has_untracked_ = true; }
+
+  void Clear();
+
+  const std::map<MemoryRange, uint64_t>& memory() const { return memory_; }
+  const std::map<std::string, uint64_t>& registers() const {
+    return registers_;
+  }
+  bool has_untracked() const { return has_untracked_; }
+
+ private:
+  std::map<MemoryRange, uint64_t> memory_;
+  std::map<std::string, uint64_t> registers_;
+  bool has_untracked_ = false;
+};
+
+// Memory fetched ahead of the evaluations which read it (e.g. into LLDB's
+// memory cache). An interpreter with a fetch set stops at the first read of
+// memory outside of the fetched ranges: the range is queued and the evaluation
+// fails with `Interpreter::read_pending()` set. The ranges queued by many
+// evaluations are then fetched at once and the evaluations are run again, see
+// `AsyncEvaluator`. The same reads as in `ReadSet` are checked, except for the
+// memory scanned by `__findnonnull`.
+class FetchSet {
+ public:
+  // Returns true if the range has been fetched, otherwise queues it.
+  bool Check(lldb::addr_t addr, uint64_t size);
+
+  // Returns the queued ranges in increasing order and clears the queue.
+  std::vector<MemoryRange> TakeQueued();
+
+  // Marks the range as fetched, even if it couldn't be read. The evaluations
+  // then read it directly and report the failure.
+  void AddFetched(lldb::addr_t addr, uint64_t size);
+
+  bool has_queued() const { return !queued_.empty(); }
+
+  void Clear();
+
+ private:
+  // Disjoint fetched ranges, from the start to the end of each.
+  std::map<lldb::addr_t, lldb::addr_t> fetched_;
+  std::vector<MemoryRange> queued_;
+};
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_READ_SET_H_
@@ -14,28 +14,61 @@
 
 #include "lldb-eval/runner.h"
 
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "lldb/API/SBBreakpoint.h"
 #include "lldb/API/SBBreakpointLocation.h"
 #include "lldb/API/SBCommandInterpreter.h"
 #include "lldb/API/SBCommandReturnObject.h"
+#include "lldb/API/SBData.h"
 #include "lldb/API/SBDebugger.h"
 #include "lldb/API/SBDefines.h"
 #include "lldb/API/SBEvent.h"
 #include "lldb/API/SBFileSpec.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBListener.h"
+#include "lldb/API/SBMemoryRegionInfo.h"
+#include "lldb/API/SBMemoryRegionInfoList.h"
 #include "lldb/API/SBProcess.h"
 #include "lldb/API/SBTarget.h"
 #include "lldb/API/SBThread.h"
 #include "lldb/API/SBValue.h"
+#include "lldb/API/SBValueList.h"
+#include "lldb/lldb-defines.h"
 #include "lldb/lldb-enumerations.h"
 #include "lldb/lldb-types.h"
 #include "tools/cpp/runfiles/runfiles.h"
 
+#ifndef _WIN32
+extern char** environ;
+#endif  // !_WIN32
+
 namespace lldb_eval {
 
 using bazel::tools::cpp::runfiles::Runfiles;
@@ -85,22 +118,11 @@ std::string filename_of_source_path(const std::string& source_path) {
   return source_path.substr(idx);
 }
 
-lldb::SBProcess LaunchTestProgram(lldb::SBDebugger debugger,
-                                  const std::string& source_path,
-                                  const std::string& binary_path,
-                                  const std::string& break_line) {
-  auto target = debugger.CreateTarget(binary_path.c_str());
-
-  auto source_file = filename_of_source_path(source_path);
-
-  const char* argv[] = {binary_path.c_str(), nullptr};
-
-  auto bp = target.BreakpointCreateByLocation(
-      source_file.c_str(), FindBreakpointLine(source_path.c_str(), break_line));
-  // Test programs don't perform any I/O, so current directory doesn't
-  // matter.
-  auto process = target.LaunchSimple(argv, nullptr, ".");
-
+// Waits until the process stops at the breakpoint `bp_id`. Exits if it stops
+// at another breakpoint or exits.
+static void WaitForBreakpoint(lldb::SBDebugger debugger,
+                              lldb::SBProcess process,
+                              lldb::break_id_t bp_id) {
   lldb::SBEvent event;
   auto listener = debugger.GetListener();
 
@@ -145,15 +167,389 @@ lldb::SBProcess LaunchTestProgram(lldb::SBDebugger debugger,
 
     auto bpId =
         static_cast<lldb::break_id_t>(thread.GetStopReasonDataAtIndex(0));
-    if (bpId != bp.GetID()) {
+    if (bpId != bp_id) {
       std::cerr << "Stopped at unknown breakpoint: " << bpId << std::endl
                 << "Now killing process and exiting" << std::endl;
       process.Destroy();
       exit(1);
     }
 
-    return process;
+    return;
   }
 }
 
+lldb::SBProcess LaunchTestProgram(lldb::SBDebugger debugger,
+                                  const std::string& source_path,
+                                  const std::string& binary_path,
+                                  const std::string& break_line) {
+  auto target = debugger.CreateTarget(binary_path.c_str());
+
+  auto source_file = filename_of_source_path(source_path);
+
+  const char* argv[] = {binary_path.c_str(), nullptr};
+
+  auto bp = target.BreakpointCreateByLocation(
+      source_file.c_str(), FindBreakpointLine(source_path.c_str(), break_line));
+  // Test programs don't perform any I/O, so current directory doesn't
+  // matter.
+  auto process = target.LaunchSimple(argv, nullptr, ".");
+
+  WaitForBreakpoint(debugger, process, bp.GetID());
+  return process;
+}
+
+void ContinueToBreakpoint(lldb::SBDebugger debugger, lldb::SBProcess process) {
+  auto bp_id = static_cast<lldb::break_id_t>(
+      process.GetSelectedThread().GetStopReasonDataAtIndex(0));
+  process.Continue();
+  WaitForBreakpoint(debugger, process, bp_id);
+}
+
+#ifndef _WIN32
+
+struct LatencyProxy::Channel {
+  std::mutex mutex;
+  std::condition_variable received;
+  // Received data and the time it's due to be sent. Empty data marks the end
+  // of the stream.
+  std::deque<std::pair<std::chrono::steady_clock::time_point,
+                       std::vector<char>>>
+      chunks;
+};
+
+// Listens on a free port of the loopback interface. Returns the socket or -1.
+static int Listen(uint16_t* port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addr_size = sizeof(addr);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, 1) != 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addr_size) != 0) {
+    close(fd);
+    return -1;
+  }
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+// Accepts a connection, with Nagle's algorithm disabled, as the gdb-remote
+// packets are small and each of them is waited for.
+static int AcceptNoDelay(int listener) {
+  int fd = accept(listener, nullptr, nullptr);
+  if (fd >= 0) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  return fd;
+}
+
+std::unique_ptr<LatencyProxy> LatencyProxy::Create(
+    std::chrono::microseconds round_trip, lldb::SBError& error) {
+  std::unique_ptr<LatencyProxy> proxy(new LatencyProxy());
+  proxy->delay_ = round_trip / 2;
+  proxy->debugger_listener_ = Listen(&proxy->debugger_port_);
+  proxy->server_listener_ = Listen(&proxy->server_port_);
+  if (proxy->debugger_listener_ < 0 || proxy->server_listener_ < 0) {
+    error.SetErrorStringWithFormat("can't listen on the loopback interface: %s",
+                                   strerror(errno));
+    return nullptr;
+  }
+  proxy->to_server_ = std::make_unique<Channel>();
+  proxy->to_debugger_ = std::make_unique<Channel>();
+  proxy->accept_thread_ = std::thread(&LatencyProxy::Accept, proxy.get());
+  return proxy;
+}
+
+LatencyProxy::~LatencyProxy() {
+  // Unblock the threads waiting for a connection or data.
+  for (int fd : {debugger_listener_, server_listener_}) {
+    if (fd >= 0) {
+      shutdown(fd, SHUT_RDWR);
+    }
+  }
+  if (accept_thread_.joinable()) {
+    accept_thread_.join();
+  }
+  for (int fd : {debugger_socket_, server_socket_}) {
+    if (fd >= 0) {
+      shutdown(fd, SHUT_RDWR);
+    }
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  for (int fd : {debugger_listener_, server_listener_, debugger_socket_,
+                 server_socket_}) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  // lldb-server exits once its connection is closed, it's killed if it's
+  // still running after a while.
+  if (server_pid_ > 0) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (waitpid(server_pid_, nullptr, WNOHANG) == 0) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        kill(server_pid_, SIGKILL);
+        waitpid(server_pid_, nullptr, 0);
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+void LatencyProxy::Accept() {
+  server_socket_ = AcceptNoDelay(server_listener_);
+  debugger_socket_ = AcceptNoDelay(debugger_listener_);
+  if (server_socket_ < 0 || debugger_socket_ < 0) {
+    return;
+  }
+  threads_.emplace_back(&LatencyProxy::Receive, this, debugger_socket_,
+                        std::ref(*to_server_));
+  threads_.emplace_back(&LatencyProxy::Send, this, server_socket_,
+                        std::ref(*to_server_));
+  threads_.emplace_back(&LatencyProxy::Receive, this, server_socket_,
+                        std::ref(*to_debugger_));
+  threads_.emplace_back(&LatencyProxy::Send, this, debugger_socket_,
+                        std::ref(*to_debugger_));
+}
+
+void LatencyProxy::Receive(int socket, Channel& channel) {
+  std::vector<char> buffer(64 << 10);
+  while (true) {
+    ssize_t size = recv(socket, buffer.data(), buffer.size(), 0);
+    auto due = std::chrono::steady_clock::now() + delay_;
+    std::vector<char> data;
+    if (size > 0) {
+      data.assign(buffer.begin(), buffer.begin() + size);
+    }
+    {
+      std::lock_guard<std::mutex> lock(channel.mutex);
+      channel.chunks.emplace_back(due, std::move(data));
+    }
+    channel.received.notify_one();
+    if (size <= 0) {
+      return;
+    }
+  }
+}
+
+void LatencyProxy::Send(int socket, Channel& channel) {
+  while (true) {
+    std::unique_lock<std::mutex> lock(channel.mutex);
+    channel.received.wait(lock, [&] { return !channel.chunks.empty(); });
+    auto [due, data] = std::move(channel.chunks.front());
+    channel.chunks.pop_front();
+    lock.unlock();
+
+    if (data.empty()) {
+      shutdown(socket, SHUT_WR);
+      return;
+    }
+    std::this_thread::sleep_until(due);
+    for (size_t sent = 0; sent < data.size();) {
+      ssize_t size = send(socket, data.data() + sent, data.size() - sent, 0);
+      if (size <= 0) {
+        return;
+      }
+      sent += size;
+    }
+  }
+}
+
+lldb::SBProcess LaunchRemoteTestProgram(lldb::SBDebugger debugger,
+                                        const std::string& source_path,
+                                        const std::string& binary_path,
+                                        const std::string& break_line,
+                                        LatencyProxy& proxy) {
+  const char* lldb_server = getenv("LLDB_DEBUGSERVER_PATH");
+  if (lldb_server == nullptr) {
+    std::cerr << "LLDB_DEBUGSERVER_PATH isn't set." << std::endl;
+    exit(1);
+  }
+
+  // lldb-server connects to the proxy, the debugger can't attach otherwise.
+  std::string server_address =
+      "127.0.0.1:" + std::to_string(proxy.server_port());
+  const char* server_argv[] = {lldb_server,
+                               "gdbserver",
+                               "--reverse-connect",
+                               server_address.c_str(),
+                               "--",
+                               binary_path.c_str(),
+                               nullptr};
+  pid_t server_pid;
+  if (posix_spawn(&server_pid, lldb_server, nullptr, nullptr,
+                  const_cast<char**>(server_argv), environ) != 0) {
+    std::cerr << "Can't start lldb-server." << std::endl;
+    exit(1);
+  }
+  proxy.SetServerPid(server_pid);
+
+  auto target = debugger.CreateTarget(binary_path.c_str());
+  auto source_file = filename_of_source_path(source_path);
+  auto bp = target.BreakpointCreateByLocation(
+      source_file.c_str(), FindBreakpointLine(source_path.c_str(), break_line));
+
+  std::string url =
+      "connect://127.0.0.1:" + std::to_string(proxy.debugger_port());
+  auto listener = debugger.GetListener();
+  lldb::SBError error;
+  auto process =
+      target.ConnectRemote(listener, url.c_str(), "gdb-remote", error);
+  if (error.Fail()) {
+    std::cerr << "Can't connect to lldb-server: " << error.GetCString()
+              << std::endl;
+    exit(1);
+  }
+
+  // The process is stopped at the entry point.
+  process.Continue();
+  WaitForBreakpoint(debugger, process, bp.GetID());
+  return process;
+}
+
+#endif  // !_WIN32
+
+// Modified ranges closer than this are written back together, as a single
+// write is cheaper than two round trips to the process.
+const size_t kRestoreMergeDistance = 256;
+
+static std::vector<uint8_t> ReadRegister(lldb::SBValue reg) {
+  lldb::SBError error;
+  lldb::SBData data = reg.GetData();
+  std::vector<uint8_t> bytes(data.GetByteSize());
+  bytes.resize(data.ReadRawData(error, 0, bytes.data(), bytes.size()));
+  return bytes;
+}
+
+ProcessSnapshot ProcessSnapshot::Create(lldb::SBProcess process,
+                                        lldb::SBError& error,
+                                        size_t max_size) {
+  ProcessSnapshot snapshot;
+  snapshot.process_ = process;
+
+  lldb::SBMemoryRegionInfoList regions = process.GetMemoryRegions();
+  for (uint32_t i = 0; i < regions.GetSize(); ++i) {
+    lldb::SBMemoryRegionInfo region;
+    if (!regions.GetMemoryRegionAtIndex(i, region) || !region.IsReadable() ||
+        !region.IsWritable()) {
+      continue;
+    }
+
+    size_t size = region.GetRegionEnd() - region.GetRegionBase();
+    if (snapshot.size_ + size > max_size) {
+      error.SetErrorStringWithFormat(
+          "writable memory of the process exceeds %zu bytes", max_size);
+      return ProcessSnapshot();
+    }
+
+    MemoryRegion saved{region.GetRegionBase(), std::vector<uint8_t>(size)};
+    lldb::SBError read_error;
+    size = process.ReadMemory(saved.base, saved.data.data(), size, read_error);
+    // Regions can be only partially readable, save what can be restored.
+    saved.data.resize(size);
+    if (size > 0) {
+      snapshot.size_ += size;
+      snapshot.regions_.push_back(std::move(saved));
+    }
+  }
+
+  for (uint32_t i = 0; i < process.GetNumThreads(); ++i) {
+    lldb::SBThread thread = process.GetThreadAtIndex(i);
+    lldb::SBValueList sets = thread.GetFrameAtIndex(0).GetRegisters();
+    for (uint32_t set = 0; set < sets.GetSize(); ++set) {
+      lldb::SBValue registers = sets.GetValueAtIndex(set);
+      for (uint32_t reg = 0; reg < registers.GetNumChildren(); ++reg) {
+        snapshot.registers_.push_back(
+            {thread.GetThreadID(), set, reg,
+             ReadRegister(registers.GetChildAtIndex(reg))});
+      }
+    }
+  }
+
+  error.Clear();
+  return snapshot;
+}
+
+size_t ProcessSnapshot::Restore(lldb::SBError& error) {
+  size_t bytes_written = 0;
+  std::vector<uint8_t> current;
+
+  for (const MemoryRegion& region : regions_) {
+    current.resize(region.data.size());
+    process_.ReadMemory(region.base, current.data(), current.size(), error);
+    if (error.Fail()) {
+      return bytes_written;
+    }
+
+    const uint8_t* saved = region.data.data();
+    size_t size = current.size();
+    size_t pos = 0;
+    while (true) {
+      pos = std::mismatch(current.begin() + pos, current.end(), saved + pos)
+                .first -
+            current.begin();
+      if (pos == size) {
+        break;
+      }
+
+      // Extend the modified range while the next modified byte is close.
+      size_t begin = pos;
+      size_t end = pos + 1;
+      for (size_t i = end; i < size && i - end < kRestoreMergeDistance; ++i) {
+        if (current[i] != saved[i]) {
+          end = i + 1;
+        }
+      }
+
+      process_.WriteMemory(region.base + begin, saved + begin, end - begin,
+                           error);
+      if (error.Fail()) {
+        return bytes_written;
+      }
+      bytes_written += end - begin;
+      pos = end;
+    }
+  }
+
+  // Registers are saved grouped by thread.
+  lldb::tid_t thread_id = LLDB_INVALID_THREAD_ID;
+  lldb::SBValueList sets;
+  for (const Register& reg : registers_) {
+    if (reg.thread_id != thread_id) {
+      thread_id = reg.thread_id;
+      lldb::SBThread thread = process_.GetThreadByID(thread_id);
+      sets = thread.GetFrameAtIndex(0).GetRegisters();
+    }
+
+    lldb::SBValue value =
+        sets.GetValueAtIndex(reg.set_index).GetChildAtIndex(reg.register_index);
+    if (!value.IsValid() || ReadRegister(value) == reg.data) {
+      continue;
+    }
+
+    lldb::SBData data;
+    data.SetData(error, reg.data.data(), reg.data.size(),
+                 process_.GetByteOrder(), process_.GetAddressByteSize());
+    if (error.Success()) {
+      value.SetData(data, error);
+    }
+    if (error.Fail()) {
+      return bytes_written;
+    }
+  }
+
+  error.Clear();
+  return bytes_written;
+}
+
 }  // namespace lldb_eval
@@ -17,10 +17,22 @@
 #ifndef LLDB_EVAL_RUNNER_H_
 #define LLDB_EVAL_RUNNER_H_
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif  // !_WIN32
 
 #include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBError.h"
 #include "lldb/API/SBProcess.h"
+#include "lldb/lldb-types.h"
 #include "tools/cpp/runfiles/runfiles.h"
 
 namespace lldb_eval {
@@ -31,6 +43,114 @@ lldb::SBProcess LaunchTestProgram(lldb::SBDebugger debugger,
                                   const std::string& source_path,
                                   const std::string& binary_path,
                                   const std::string& break_line);
+
+// Resumes the process stopped at a breakpoint and waits until it stops at the
+// same breakpoint again. LLDB drops its memory cache at every stop.
+void ContinueToBreakpoint(lldb::SBDebugger debugger, lldb::SBProcess process);
+
+#ifndef _WIN32
+
+// TCP proxy between a debugger and lldb-server on the loopback interface,
+// which delays the data sent in each direction by half of the round-trip time.
+// It simulates debugging a remote process, where the cost of a read is
+// dominated by the round trip. Serves a single pair of connections.
+class LatencyProxy {
+ public:
+  // Starts listening for the connections of the debugger and lldb-server.
+  static std::unique_ptr<LatencyProxy> Create(
+      std::chrono::microseconds round_trip, lldb::SBError& error);
+  ~LatencyProxy();
+
+  LatencyProxy(const LatencyProxy&) = delete;
+  LatencyProxy& operator=(const LatencyProxy&) = delete;
+
+  uint16_t debugger_port() const { return debugger_port_; }
+  uint16_t server_port() const { return server_port_; }
+
+  // Makes the proxy reap the lldb-server process `pid`, which is connected to
+  // it, once the connections are closed.
+  void SetServerPid(pid_t pid) { server_pid_ = pid; }
+
+ private:
+  struct Channel;
+
+  LatencyProxy() = default;
+
+  void Accept();
+  void Receive(int socket, Channel& channel);
+  void Send(int socket, Channel& channel);
+
+  std::chrono::microseconds delay_{0};
+  int debugger_listener_ = -1;
+  int server_listener_ = -1;
+  uint16_t debugger_port_ = 0;
+  uint16_t server_port_ = 0;
+  int debugger_socket_ = -1;
+  int server_socket_ = -1;
+  pid_t server_pid_ = -1;
+  std::unique_ptr<Channel> to_server_;
+  std::unique_ptr<Channel> to_debugger_;
+  std::thread accept_thread_;
+  std::vector<std::thread> threads_;
+};
+
+// Launches the test program under lldb-server, which connects back to the
+// `proxy`, and attaches the debugger to it through the proxy. lldb-server is
+// reaped by the proxy when it's destroyed. Otherwise the same as
+// `LaunchTestProgram`.
+lldb::SBProcess LaunchRemoteTestProgram(lldb::SBDebugger debugger,
+                                        const std::string& source_path,
+                                        const std::string& binary_path,
+                                        const std::string& break_line,
+                                        LatencyProxy& proxy);
+
+#endif  // !_WIN32
+
+// Snapshot of a stopped process, i.e. of its writable memory and the
+// registers of its threads. Restoring the snapshot undoes the side effects of
+// the evaluated expressions (e.g. `x++` or `p->x = 1`), so that side-effect
+// fuzzing and benchmarks can run against the same state without relaunching
+// the process. The state of LLDB itself (e.g. persistent variables like `$0`)
+// isn't part of the snapshot.
+class ProcessSnapshot {
+ public:
+  // Snapshots larger than this are likely a mistake, e.g. a huge heap.
+  static constexpr size_t kDefaultMaxSize = 256 << 20;
+
+  // Takes a snapshot of the stopped `process`. Fails if the writable memory
+  // of the process is larger than `max_size` bytes.
+  static ProcessSnapshot Create(lldb::SBProcess process, lldb::SBError& error,
+                                size_t max_size = kDefaultMaxSize);
+
+  // Restores the memory and the registers of the process. Memory is compared
+  // with the snapshot first and only the modified ranges are written back,
+  // each with a single write. Returns the number of bytes written.
+  size_t Restore(lldb::SBError& error);
+
+  // Size of the saved memory in bytes.
+  size_t size() const { return size_; }
+
+ private:
+  struct MemoryRegion {
+    lldb::addr_t base;
+    std::vector<uint8_t> data;
+  };
+
+  struct Register {
+    lldb::tid_t thread_id;
+    uint32_t set_index;
+    uint32_t register_index;
+    std::vector<uint8_t> data;
+  };
+
+  ProcessSnapshot() = default;
+
+  lldb::SBProcess process_;
+  std::vector<MemoryRegion> regions_;
+  std::vector<Register> registers_;
+  size_t size_ = 0;
+};
+
 }  // namespace lldb_eval
 
 #endif  // LLDB_EVAL_RUNNER_H_
@@ -0,0 +1,221 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring how type resolution and identifier lookup scale with
+// the number of symbols in the target. Every benchmark runs against the
+// generated binaries with 1k, 10k and 100k symbols (see
+// testdata/gen_scaling_binary.py) and reports the fitted complexity.
+
+#ifdef _WIN32
+#include <filesystem>
+#else
+#include <errno.h>  // for `program_invocation_name`
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "lldb-eval/api.h"
+#include "lldb-eval/context.h"
+#include "lldb-eval/runner.h"
+#include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBProcess.h"
+#include "lldb/API/SBTarget.h"
+#include "lldb/API/SBThread.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "tools/cpp/runfiles/runfiles.h"
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+class BM : public benchmark::Fixture {
+ public:
+  void SetUp(::benchmark::State& state) override {
+#ifdef _WIN32
+    auto cwd = std::filesystem::current_path();
+    std::string argv0 =
+        cwd.parent_path().append("scaling_benchmark.exe").string();
+#else
+    std::string argv0 = program_invocation_name;
+#endif
+
+    runfiles.reset(Runfiles::Create(argv0));
+
+    lldb_eval::SetupLLDBServerEnv(*runfiles);
+
+    // The benchmark argument is the number of symbols in the target.
+    num_symbols = state.range(0);
+    std::string binary_name =
+        llvm::formatv("lldb_eval/testdata/scaling_binary_{0}", num_symbols);
+    auto binary_path = runfiles->Rlocation(binary_name);
+    auto source_path = runfiles->Rlocation(binary_name + ".cc");
+
+    debugger = lldb::SBDebugger::Create(false);
+    process = lldb_eval::LaunchTestProgram(debugger, source_path, binary_path,
+                                           "// BREAK HERE");
+    frame = process.GetSelectedThread().GetSelectedFrame();
+    context = lldb_eval::Context::Create(lldb_eval::SourceManager::Create(""),
+                                         frame);
+  }
+
+  void TearDown(::benchmark::State&) override {
+    context.reset();
+    process.Destroy();
+    lldb::SBDebugger::Destroy(debugger);
+  }
+
+  // Names of the symbols, generated the same way as in gen_scaling_binary.py.
+  // The symbols from the end of the lists are used to avoid the lookups being
+  // faster just because the symbol happens to come first.
+  std::string LastGlobalName() const {
+    return llvm::formatv("global_{0}", num_symbols / 4 / 2 - 1);
+  }
+  std::string LastTypeName() const {
+    return llvm::formatv("Type_{0}", num_symbols / 4 / 2 - 1);
+  }
+  std::string LastFieldName() const {
+    return llvm::formatv("field_{0}", num_symbols / 4 - 1);
+  }
+
+  void LookupIdentifier(benchmark::State& state, const std::string& name) {
+    for (auto _ : state) {
+      if (!context->LookupIdentifier(name)->IsValid()) {
+        state.SkipWithError("Failed to look up the identifier!");
+        break;
+      }
+    }
+    state.SetComplexityN(num_symbols);
+  }
+
+  void ResolveTypeByName(benchmark::State& state, const std::string& name) {
+    for (auto _ : state) {
+      if (!context->ResolveTypeByName(name)->IsValid()) {
+        state.SkipWithError("Failed to resolve the type!");
+        break;
+      }
+    }
+    state.SetComplexityN(num_symbols);
+  }
+
+  void Evaluate(benchmark::State& state, const std::string& expr) {
+    for (auto _ : state) {
+      lldb::SBError error;
+      lldb_eval::EvaluateExpression(frame, expr.c_str(), error);
+
+      if (error.Fail()) {
+        state.SkipWithError("Failed to evaluate the expression!");
+        break;
+      }
+    }
+    state.SetComplexityN(num_symbols);
+  }
+
+  lldb::SBDebugger debugger;
+  lldb::SBProcess process;
+  lldb::SBFrame frame;
+  std::shared_ptr<lldb_eval::Context> context;
+  int64_t num_symbols = 0;
+
+  std::unique_ptr<Runfiles> runfiles;
+};
+
+#define REGISTER_SCALING_BENCHMARK(name) \
+  BENCHMARK_REGISTER_F(BM, name)         \
+      ->ArgName("symbols")               \
+      ->Arg(1000)                        \
+      ->Arg(10000)                       \
+      ->Arg(100000)                      \
+      ->Complexity()
+
+BENCHMARK_DEFINE_F(BM, ResolveTypeByName)(benchmark::State& state) {
+  ResolveTypeByName(state, LastTypeName());
+}
+REGISTER_SCALING_BENCHMARK(ResolveTypeByName);
+
+BENCHMARK_DEFINE_F(BM, ResolveNestedTypeByName)(benchmark::State& state) {
+  ResolveTypeByName(state, "deep_0::deep_1::deep_2::deep_3::deep_4::deep_5::"
+                           "deep_6::deep_7::deep_8::deep_9::DeepType");
+}
+REGISTER_SCALING_BENCHMARK(ResolveNestedTypeByName);
+
+BENCHMARK_DEFINE_F(BM, ResolveTemplateTypeByName)(benchmark::State& state) {
+  ResolveTypeByName(state, "std::map<int, int>");
+}
+REGISTER_SCALING_BENCHMARK(ResolveTemplateTypeByName);
+
+BENCHMARK_DEFINE_F(BM, LookupLocal)(benchmark::State& state) {
+  LookupIdentifier(state, "vec");
+}
+REGISTER_SCALING_BENCHMARK(LookupLocal);
+
+BENCHMARK_DEFINE_F(BM, LookupGlobal)(benchmark::State& state) {
+  LookupIdentifier(state, LastGlobalName());
+}
+REGISTER_SCALING_BENCHMARK(LookupGlobal);
+
+BENCHMARK_DEFINE_F(BM, LookupNamespacedGlobal)(benchmark::State& state) {
+  LookupIdentifier(state, "ns_0::ns_global_0");
+}
+REGISTER_SCALING_BENCHMARK(LookupNamespacedGlobal);
+
+BENCHMARK_DEFINE_F(BM, LookupDeepNamespacedGlobal)(benchmark::State& state) {
+  LookupIdentifier(state,
+                   "deep_0::deep_1::deep_2::deep_3::deep_4::deep_5::deep_6::"
+                   "deep_7::deep_8::deep_9::deep_global");
+}
+REGISTER_SCALING_BENCHMARK(LookupDeepNamespacedGlobal);
+
+BENCHMARK_DEFINE_F(BM, LookupEnumerator)(benchmark::State& state) {
+  // The scoped enum has at most 10000 enumerators, a half of the enumerators
+  // generated for the binary.
+  int64_t big_enum_size = std::min<int64_t>(num_symbols / 4 / 2, 10000);
+  LookupIdentifier(state,
+                   llvm::formatv("BigEnum::kBigEnum_{0}", big_enum_size - 1));
+}
+REGISTER_SCALING_BENCHMARK(LookupEnumerator);
+
+BENCHMARK_DEFINE_F(BM, MemberOfWideStruct)(benchmark::State& state) {
+  Evaluate(state, "wide_struct." + LastFieldName());
+}
+REGISTER_SCALING_BENCHMARK(MemberOfWideStruct);
+
+BENCHMARK_DEFINE_F(BM, MemberOfVirtualBase)(benchmark::State& state) {
+  Evaluate(state, "level_9.level_0 + level_9.level_5");
+}
+REGISTER_SCALING_BENCHMARK(MemberOfVirtualBase);
+
+BENCHMARK_DEFINE_F(BM, LinkedList)(benchmark::State& state) {
+  Evaluate(state, "list_head->next->next->next->next->value");
+}
+REGISTER_SCALING_BENCHMARK(LinkedList);
+
+BENCHMARK_DEFINE_F(BM, ArraySubscript)(benchmark::State& state) {
+  Evaluate(state, llvm::formatv("big_array[{0}]", num_symbols - 1));
+}
+REGISTER_SCALING_BENCHMARK(ArraySubscript);
+
+int main(int argc, char** argv) {
+  lldb::SBDebugger::Initialize();
+
+  // Same as BENCHMARK_MAIN()
+  // clang-format off
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  // clang-format on
+
+  lldb::SBDebugger::Terminate();
+}
@@ -0,0 +1,64 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lldb-eval/stats.h"
+
+#include <string>
+
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace lldb_eval {
+
+static llvm::json::Object ToJSON(const EvalStats::Counter& counter) {
+  return llvm::json::Object{
+      {"count", static_cast<int64_t>(counter.count)},
+      {"time_ns", static_cast<int64_t>(counter.time.count())},
+  };
+}
+
+std::string EvalStats::ToJSON() const {
+  using lldb_eval::ToJSON;
+
+  llvm::json::Object node_stats;
+  for (const auto& [kind, counter] : nodes) {
+    node_stats[kind] = ToJSON(counter);
+  }
+
+  llvm::json::Object stats{
+      {"parse", ToJSON(parse)},
+      {"eval", ToJSON(eval)},
+      {"nodes", std::move(node_stats)},
+      {"lookups",
+       llvm::json::Object{
+           {"identifier", ToJSON(identifier_lookups)},
+           {"global", ToJSON(global_lookups)},
+           {"enum", ToJSON(enum_lookups)},
+           {"type", ToJSON(type_lookups)},
+           {"member", ToJSON(member_lookups)},
+           {"basic_type_hits", static_cast<int64_t>(basic_type_hits)},
+           {"basic_type_misses", static_cast<int64_t>(basic_type_misses)},
+       }},
+      {"created_values", static_cast<int64_t>(created_values)},
+      {"value_reads", static_cast<int64_t>(value_reads)},
+      {"bytes_read", static_cast<int64_t>(bytes_read)},
+  };
+
+  std::string ret;
+  llvm::raw_string_ostream os(ret);
+  os << llvm::json::Value(std::move(stats));
+  return os.str();
+}
+
+}  // namespace lldb_eval
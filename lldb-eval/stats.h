@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_STATS_H_
+#define LLDB_EVAL_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace lldb_eval {
+
+// Statistics of the compilations and evaluations made with `Options::stats`
+// set. They're accumulated until `Reset()` is called. Collecting them costs two
+// clock reads per AST node and per lookup, nothing is collected otherwise.
+// Not thread-safe, use an object per thread and merge the JSON reports.
+struct EvalStats {
+  struct Counter {
+    uint64_t count = 0;
+    std::chrono::nanoseconds time{0};
+
+    void Add(std::chrono::nanoseconds elapsed) {
+      ++count;
+      time += elapsed;
+    }
+  };
+
+  // Parsing, including the lookups below.
+  Counter parse;
+  // Evaluation, including the reads of the values.
+  Counter eval;
+  // Evaluation of the AST nodes by kind, e.g. "BinaryOpNode". The time of a
+  // node includes the time of its operands.
+  std::map<std::string, Counter> nodes;
+
+  // Lookups made by the parser. Every one of them is a query to LLDB, only the
+  // basic types are cached.
+  Counter identifier_lookups;
+  Counter global_lookups;
+  Counter enum_lookups;
+  Counter type_lookups;
+  Counter member_lookups;
+  uint64_t basic_type_hits = 0;
+  uint64_t basic_type_misses = 0;
+
+  // Values obtained from LLDB (see `GetNumCreatedValues`) and reads of the
+  // values stored in the process, during the evaluation.
+  uint64_t created_values = 0;
+  uint64_t value_reads = 0;
+  uint64_t bytes_read = 0;
+
+  void Reset() { *this = EvalStats(); }
+
+  // Returns the statistics as a JSON object, with the times in nanoseconds.
+  std::string ToJSON() const;
+};
+
+// Adds the time spent in its scope to the `counter`, unless it's null.
+class ScopedStatsTimer {
+ public:
+  explicit ScopedStatsTimer(EvalStats::Counter* counter) : counter_(counter) {
+    if (counter_ != nullptr) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+  ~ScopedStatsTimer() {
+    if (counter_ != nullptr) {
+      counter_->Add(std::chrono::steady_clock::now() - start_);
+    }
+  }
+
+  ScopedStatsTimer(const ScopedStatsTimer&) = delete;
+  ScopedStatsTimer& operator=(const ScopedStatsTimer&) = delete;
+
+ private:
+  EvalStats::Counter* counter_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_STATS_H_
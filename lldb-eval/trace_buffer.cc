@@ -0,0 +1,433 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lldb-eval/trace_buffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "lldb/API/SBError.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+
+namespace lldb_eval {
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'L', 'D', 'B', 'E', 'V', 'T', 'R'};
+constexpr uint32_t kVersion = 1;
+
+// Marks the unused space at the end of the ring, when a record doesn't fit
+// there and is written at the start instead.
+constexpr uint32_t kPaddingId = UINT32_MAX;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t schema_capacity;
+  uint64_t schema_size;
+  uint64_t capacity;
+  // Positions in the ring only grow, the offset in the ring is the position
+  // modulo `capacity`. `tail` is the position of the oldest record and `head`
+  // the position of the next one.
+  uint64_t head;
+  uint64_t tail;
+  uint64_t num_records;
+};
+static_assert(sizeof(FileHeader) == 64, "unexpected padding");
+
+// Followed by the error bitmap and the value slots, all 8-byte words.
+struct RecordHeader {
+  // Size of the whole record, a multiple of 8.
+  uint32_t size;
+  uint32_t tracepoint_id;
+  uint64_t sequence;
+  uint64_t thread_id;
+};
+static_assert(sizeof(RecordHeader) == 24, "unexpected padding");
+
+// Padding needs only the `size` and `tracepoint_id` fields.
+constexpr uint64_t kMinPaddingSize = 8;
+
+size_t NumErrorWords(size_t num_values) { return (num_values + 63) / 64; }
+
+uint64_t RecordSize(size_t num_values) {
+  return sizeof(RecordHeader) +
+         (NumErrorWords(num_values) + num_values) * sizeof(uint64_t);
+}
+
+std::unique_ptr<llvm::sys::fs::mapped_file_region> MapFile(
+    const std::string& path, llvm::sys::fs::mapped_file_region::mapmode mode,
+    uint64_t size, lldb::SBError& error) {
+  bool readonly = mode == llvm::sys::fs::mapped_file_region::readonly;
+  int fd;
+  std::error_code ec =
+      readonly ? llvm::sys::fs::openFileForRead(path, fd)
+               : llvm::sys::fs::openFileForReadWrite(
+                     path, fd, llvm::sys::fs::CD_CreateAlways,
+                     llvm::sys::fs::OF_None);
+  if (ec) {
+    error.SetErrorStringWithFormat("can't open %s: %s", path.c_str(),
+                                   ec.message().c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> region;
+  if (readonly) {
+    // The size of an existing file is taken from the file.
+    llvm::sys::fs::file_status status;
+    ec = llvm::sys::fs::status(fd, status);
+    size = status.getSize();
+  } else {
+    ec = llvm::sys::fs::resize_file(fd, size);
+  }
+  if (!ec && size < sizeof(FileHeader)) {
+    error.SetErrorStringWithFormat("%s isn't a trace file", path.c_str());
+  } else if (!ec) {
+    // The mapping stays valid after the file is closed.
+    region = std::make_unique<llvm::sys::fs::mapped_file_region>(
+        llvm::sys::fs::convertFDToNativeFile(fd), mode, size, 0, ec);
+  }
+  if (ec) {
+    error.SetErrorStringWithFormat("can't map %s: %s", path.c_str(),
+                                   ec.message().c_str());
+    region.reset();
+  }
+  llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+  return region;
+}
+
+// Accessors of the file sections, for both the writable and the read-only
+// mappings.
+
+FileHeader* GetHeader(char* file) {
+  return reinterpret_cast<FileHeader*>(file);
+}
+
+const FileHeader* GetHeader(const char* file) {
+  return reinterpret_cast<const FileHeader*>(file);
+}
+
+template <typename Char>
+Char* GetSchemas(Char* file) {
+  return file + sizeof(FileHeader);
+}
+
+template <typename Char>
+Char* GetRing(Char* file) {
+  return GetSchemas(file) + GetHeader(file)->schema_capacity;
+}
+
+void WriteU32(std::vector<uint8_t>& data, uint32_t value) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+  data.insert(data.end(), bytes, bytes + sizeof(value));
+}
+
+void WriteString(std::vector<uint8_t>& data, const std::string& str) {
+  WriteU32(data, static_cast<uint32_t>(str.size()));
+  data.insert(data.end(), str.begin(), str.end());
+}
+
+// Reads the schema entries. All reads fail once the data is exhausted.
+class SchemaReader {
+ public:
+  SchemaReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  bool ok() const { return ok_; }
+  bool empty() const { return size_ == 0; }
+
+  uint32_t ReadU32() {
+    uint32_t value = 0;
+    ReadBytes(&value, sizeof(value));
+    return value;
+  }
+
+  uint8_t ReadU8() {
+    uint8_t value = 0;
+    ReadBytes(&value, sizeof(value));
+    return value;
+  }
+
+  std::string ReadString() {
+    uint32_t size = ReadU32();
+    // Check the untrusted size before allocating the string.
+    if (!ok_ || size > size_) {
+      ok_ = false;
+      return std::string();
+    }
+    std::string str(size, '\0');
+    ReadBytes(str.data(), str.size());
+    return str;
+  }
+
+ private:
+  void ReadBytes(void* dst, size_t size) {
+    if (!ok_ || size > size_) {
+      ok_ = false;
+      return;
+    }
+    std::memcpy(dst, data_, size);
+    data_ += size;
+    size_ -= size;
+  }
+
+  const char* data_;
+  size_t size_;
+  bool ok_ = true;
+};
+
+}  // namespace
+
+std::unique_ptr<TraceBuffer> TraceBuffer::Create(const std::string& path,
+                                                 size_t capacity,
+                                                 lldb::SBError& error) {
+  error.Clear();
+
+  // Records are 8-byte aligned, so is the ring.
+  capacity = (capacity + 7) & ~static_cast<size_t>(7);
+  if (capacity < RecordSize(0)) {
+    error.SetErrorString("the capacity of the trace buffer is too small");
+    return nullptr;
+  }
+
+  auto region = MapFile(path, llvm::sys::fs::mapped_file_region::readwrite,
+                        sizeof(FileHeader) + kSchemaCapacity + capacity,
+                        error);
+  if (!region) {
+    return nullptr;
+  }
+
+  FileHeader* header = GetHeader(region->data());
+  std::memset(header, 0, sizeof(FileHeader));
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+  header->version = kVersion;
+  header->header_size = sizeof(FileHeader);
+  header->schema_capacity = kSchemaCapacity;
+  header->capacity = capacity;
+
+  return std::unique_ptr<TraceBuffer>(new TraceBuffer(std::move(region)));
+}
+
+TraceBuffer::TraceBuffer(
+    std::unique_ptr<llvm::sys::fs::mapped_file_region> region)
+    : region_(std::move(region)) {}
+
+TraceBuffer::~TraceBuffer() = default;
+
+void TraceBuffer::AddSchema(const TracepointSchema& schema,
+                            lldb::SBError& error) {
+  error.Clear();
+
+  std::vector<uint8_t> entry;
+  WriteU32(entry, schema.id);
+  WriteString(entry, schema.location);
+  WriteU32(entry, static_cast<uint32_t>(schema.expressions.size()));
+  for (const auto& expr : schema.expressions) {
+    entry.push_back(static_cast<uint8_t>(expr.kind));
+    WriteString(entry, expr.text);
+  }
+
+  FileHeader* header = GetHeader(region_->data());
+  if (header->schema_size + entry.size() > header->schema_capacity) {
+    error.SetErrorString("no space left for the tracepoint schema");
+    return;
+  }
+  std::memcpy(GetSchemas(region_->data()) + header->schema_size, entry.data(),
+              entry.size());
+  header->schema_size += entry.size();
+}
+
+bool TraceBuffer::Append(uint32_t tracepoint_id, uint64_t thread_id,
+                         const uint64_t* values, const uint64_t* errors,
+                         size_t num_values) {
+  FileHeader* header = GetHeader(region_->data());
+  uint64_t size = RecordSize(num_values);
+  if (size > header->capacity) {
+    return false;
+  }
+
+  // Records are never split, the rest of the ring is skipped instead.
+  uint64_t offset = header->head % header->capacity;
+  char* ring = GetRing(region_->data());
+  if (offset + size > header->capacity) {
+    uint64_t padding = header->capacity - offset;
+    Reserve(padding);
+    assert(padding >= kMinPaddingSize && "records should be 8-byte aligned");
+    RecordHeader pad = {static_cast<uint32_t>(padding), kPaddingId, 0, 0};
+    std::memcpy(ring + offset, &pad, kMinPaddingSize);
+    header->head += padding;
+    offset = 0;
+  }
+  Reserve(size);
+
+  RecordHeader record = {static_cast<uint32_t>(size), tracepoint_id,
+                         header->num_records, thread_id};
+  char* dst = ring + offset;
+  std::memcpy(dst, &record, sizeof(record));
+  dst += sizeof(record);
+  size_t error_size = NumErrorWords(num_values) * sizeof(uint64_t);
+  std::memcpy(dst, errors, error_size);
+  dst += error_size;
+  std::memcpy(dst, values, num_values * sizeof(uint64_t));
+
+  header->head += size;
+  header->num_records++;
+  return true;
+}
+
+void TraceBuffer::Reserve(uint64_t size) {
+  FileHeader* header = GetHeader(region_->data());
+  const char* ring = GetRing(region_->data());
+  while (header->head + size - header->tail > header->capacity) {
+    uint32_t record_size;
+    std::memcpy(&record_size, ring + header->tail % header->capacity,
+                sizeof(record_size));
+    header->tail += record_size;
+  }
+}
+
+uint64_t TraceBuffer::num_records() const {
+  return GetHeader(region_->const_data())->num_records;
+}
+
+std::unique_ptr<TraceReader> TraceReader::Open(const std::string& path,
+                                               lldb::SBError& error) {
+  error.Clear();
+
+  auto region = MapFile(path, llvm::sys::fs::mapped_file_region::readonly,
+                        /*size*/ 0, error);
+  if (!region) {
+    return nullptr;
+  }
+
+  const FileHeader* header = GetHeader(region->const_data());
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion ||
+      header->header_size != sizeof(FileHeader) ||
+      sizeof(FileHeader) + header->schema_capacity + header->capacity !=
+          region->size()) {
+    error.SetErrorStringWithFormat("%s isn't a valid trace file",
+                                   path.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<TraceReader> reader(new TraceReader(std::move(region)));
+  if (!reader->ReadSchemas(error)) {
+    return nullptr;
+  }
+  return reader;
+}
+
+TraceReader::TraceReader(
+    std::unique_ptr<llvm::sys::fs::mapped_file_region> region)
+    : region_(std::move(region)) {}
+
+TraceReader::~TraceReader() = default;
+
+bool TraceReader::ReadSchemas(lldb::SBError& error) {
+  const FileHeader* header = GetHeader(region_->const_data());
+  if (header->schema_size > header->schema_capacity) {
+    error.SetErrorString("corrupted tracepoint schemas");
+    return false;
+  }
+
+  SchemaReader reader(GetSchemas(region_->const_data()), header->schema_size);
+  while (!reader.empty()) {
+    TracepointSchema schema;
+    schema.id = reader.ReadU32();
+    schema.location = reader.ReadString();
+    uint32_t num_expressions = reader.ReadU32();
+    for (uint32_t i = 0; i < num_expressions && reader.ok(); ++i) {
+      auto kind = static_cast<TraceValueKind>(reader.ReadU8());
+      schema.expressions.push_back({reader.ReadString(), kind});
+    }
+    if (!reader.ok()) {
+      error.SetErrorString("corrupted tracepoint schemas");
+      return false;
+    }
+    schemas_.push_back(std::move(schema));
+  }
+  return true;
+}
+
+const TracepointSchema* TraceReader::FindSchema(uint32_t tracepoint_id) const {
+  for (const auto& schema : schemas_) {
+    if (schema.id == tracepoint_id) {
+      return &schema;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<TraceRecord> TraceReader::ReadRecords(lldb::SBError& error) const {
+  error.Clear();
+
+  std::vector<TraceRecord> records;
+  const FileHeader* header = GetHeader(region_->const_data());
+  const char* ring = GetRing(region_->const_data());
+  for (uint64_t pos = header->tail; pos < header->head;) {
+    uint64_t offset = pos % header->capacity;
+    RecordHeader record_header = {};
+    std::memcpy(&record_header, ring + offset,
+                std::min<uint64_t>(sizeof(RecordHeader),
+                                   header->capacity - offset));
+    if (record_header.size < kMinPaddingSize ||
+        record_header.size > header->capacity - offset ||
+        record_header.size % 8 != 0) {
+      error.SetErrorString("corrupted trace record");
+      break;
+    }
+    pos += record_header.size;
+    if (record_header.tracepoint_id == kPaddingId) {
+      continue;
+    }
+
+    const TracepointSchema* schema = FindSchema(record_header.tracepoint_id);
+    size_t num_values = schema ? schema->expressions.size() : 0;
+    if (schema == nullptr || record_header.size != RecordSize(num_values)) {
+      error.SetErrorString("trace record doesn't match its schema");
+      break;
+    }
+
+    TraceRecord record;
+    record.tracepoint_id = record_header.tracepoint_id;
+    record.sequence = record_header.sequence;
+    record.thread_id = record_header.thread_id;
+    record.values.resize(num_values);
+    record.errors.resize(num_values);
+
+    const char* data = ring + offset + sizeof(RecordHeader);
+    std::vector<uint64_t> errors(NumErrorWords(num_values));
+    std::memcpy(errors.data(), data, errors.size() * sizeof(uint64_t));
+    data += errors.size() * sizeof(uint64_t);
+    std::memcpy(record.values.data(), data, num_values * sizeof(uint64_t));
+    for (size_t i = 0; i < num_values; ++i) {
+      record.errors[i] = (errors[i / 64] >> (i % 64)) & 1;
+    }
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+uint64_t TraceReader::num_records() const {
+  return GetHeader(region_->const_data())->num_records;
+}
+
+}  // namespace lldb_eval
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_TRACE_BUFFER_H_
+#define LLDB_EVAL_TRACE_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lldb/API/SBError.h"
+
+namespace llvm {
+namespace sys {
+namespace fs {
+class mapped_file_region;
+}  // namespace fs
+}  // namespace sys
+}  // namespace llvm
+
+namespace lldb_eval {
+
+// Kind of the values recorded for an expression, determined by its type.
+// Values are stored in 8-byte slots: integers are sign- or zero-extended,
+// doubles are stored as their bit pattern.
+enum class TraceValueKind : uint8_t {
+  kInvalid,  // The expression failed to compile, the value is always missing.
+  kInt64,
+  kUInt64,
+  kDouble,
+  kBool,
+  kAddress,
+};
+
+struct TraceExpression {
+  std::string text;
+  TraceValueKind kind;
+};
+
+// Describes the records of a tracepoint: the values of a record are the
+// values of the `expressions`, in order.
+struct TracepointSchema {
+  uint32_t id;
+  std::string location;
+  std::vector<TraceExpression> expressions;
+};
+
+struct TraceRecord {
+  uint32_t tracepoint_id;
+  // Sequence number of the record, counting from 0. Gaps in the sequence
+  // numbers mean that records were overwritten.
+  uint64_t sequence;
+  uint64_t thread_id;
+  std::vector<uint64_t> values;
+  // True for values that failed to evaluate.
+  std::vector<bool> errors;
+};
+
+// Ring buffer of trace records, backed by a memory-mapped file. Appending a
+// record is a copy into the mapped memory, the oldest records are overwritten
+// once the buffer is full. The file consists of:
+//   header   magic, version, sizes and the positions of the ring
+//   schemas  the schema of each tracepoint, see `TracepointSchema`
+//   ring     records, each is a header, an error bitmap and the value slots
+// All fields are in the byte order of the host. The file is meant to be
+// decoded with `TraceReader` once the tracing is done. Not thread-safe.
+class TraceBuffer {
+ public:
+  static constexpr size_t kDefaultCapacity = 64 << 20;
+  static constexpr size_t kSchemaCapacity = 1 << 20;
+
+  // Creates the file at `path` (or truncates it) with a ring of `capacity`
+  // bytes.
+  static std::unique_ptr<TraceBuffer> Create(const std::string& path,
+                                             size_t capacity,
+                                             lldb::SBError& error);
+  ~TraceBuffer();
+
+  TraceBuffer(const TraceBuffer&) = delete;
+  TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+  void AddSchema(const TracepointSchema& schema, lldb::SBError& error);
+
+  // Appends a record of `num_values` values. `errors` is a bitmap of
+  // `(num_values + 63) / 64` words. Returns false if the record is larger
+  // than the ring.
+  bool Append(uint32_t tracepoint_id, uint64_t thread_id,
+              const uint64_t* values, const uint64_t* errors,
+              size_t num_values);
+
+  // Total number of records appended, including the overwritten ones.
+  uint64_t num_records() const;
+
+ private:
+  explicit TraceBuffer(std::unique_ptr<llvm::sys::fs::mapped_file_region> r);
+
+  // Drops the oldest records until `size` bytes fit at the head of the ring.
+  void Reserve(uint64_t size);
+
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> region_;
+};
+
+// Decodes a file written by `TraceBuffer`.
+class TraceReader {
+ public:
+  static std::unique_ptr<TraceReader> Open(const std::string& path,
+                                           lldb::SBError& error);
+  ~TraceReader();
+
+  TraceReader(const TraceReader&) = delete;
+  TraceReader& operator=(const TraceReader&) = delete;
+
+  const std::vector<TracepointSchema>& schemas() const { return schemas_; }
+
+  // Returns the schema of the tracepoint, or nullptr if there isn't any.
+  const TracepointSchema* FindSchema(uint32_t tracepoint_id) const;
+
+  // Returns the records still in the ring, from the oldest to the newest.
+  std::vector<TraceRecord> ReadRecords(lldb::SBError& error) const;
+
+  // Total number of records written, including the overwritten ones.
+  uint64_t num_records() const;
+
+ private:
+  explicit TraceReader(std::unique_ptr<llvm::sys::fs::mapped_file_region> r);
+
+  bool ReadSchemas(lldb::SBError& error);
+
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> region_;
+  std::vector<TracepointSchema> schemas_;
+};
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_TRACE_BUFFER_H_
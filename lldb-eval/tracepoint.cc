@@ -0,0 +1,219 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lldb-eval/tracepoint.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lldb-eval/api_internal.h"
+#include "lldb-eval/ast.h"
+#include "lldb-eval/context.h"
+#include "lldb-eval/eval.h"
+#include "lldb-eval/trace_buffer.h"
+#include "lldb-eval/value.h"
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBProcess.h"
+#include "lldb/API/SBTarget.h"
+#include "lldb/API/SBThread.h"
+#include "lldb/API/SBType.h"
+#include "llvm/ADT/APFloat.h"
+
+namespace lldb_eval {
+
+struct Tracer::Tracepoint {
+  struct Slot {
+    std::string text;
+    TraceValueKind kind = TraceValueKind::kInvalid;
+    // Not set if the expression failed to compile.
+    std::shared_ptr<CompiledExpr> expr;
+    std::unique_ptr<Interpreter> interpreter;
+  };
+
+  uint32_t id;
+  std::string location;
+  Options opts;
+  std::vector<Slot> slots;
+
+  // Frame the identifiers of the expressions are bound to.
+  bool compiled = false;
+  lldb::tid_t thread_id = 0;
+  lldb::addr_t cfa = 0;
+
+  // Buffers of the record, reused between the hits.
+  std::vector<uint64_t> values;
+  std::vector<uint64_t> errors;
+};
+
+static TraceValueKind GetValueKind(TypeSP type) {
+  if (type->IsBool()) {
+    return TraceValueKind::kBool;
+  }
+  if (type->IsInteger() || type->IsEnum()) {
+    return type->IsSigned() ? TraceValueKind::kInt64 : TraceValueKind::kUInt64;
+  }
+  if (type->IsFloat()) {
+    return TraceValueKind::kDouble;
+  }
+  if (type->IsPointerType() || type->IsNullPtrType() || type->IsArrayType()) {
+    return TraceValueKind::kAddress;
+  }
+  return TraceValueKind::kInvalid;
+}
+
+static uint64_t GetSlotValue(Value& value, TraceValueKind kind) {
+  switch (kind) {
+    case TraceValueKind::kInt64:
+      return static_cast<uint64_t>(
+          value.GetInteger().extOrTrunc(64).getSExtValue());
+    case TraceValueKind::kUInt64:
+      return value.GetInteger().extOrTrunc(64).getZExtValue();
+    case TraceValueKind::kDouble: {
+      llvm::APFloat v = value.GetFloat();
+      bool ignore;
+      v.convert(llvm::APFloat::IEEEdouble(),
+                llvm::APFloat::rmNearestTiesToEven, &ignore);
+      return v.bitcastToAPInt().getZExtValue();
+    }
+    case TraceValueKind::kBool:
+      return value.GetBool();
+    case TraceValueKind::kAddress:
+      if (value.type()->IsArrayType()) {
+        return value.AddressOf().GetUInt64();
+      }
+      return value.GetUInt64();
+    case TraceValueKind::kInvalid:
+      break;
+  }
+  return 0;
+}
+
+Tracer::Tracer(std::unique_ptr<TraceBuffer> buffer)
+    : buffer_(std::move(buffer)) {}
+
+Tracer::~Tracer() = default;
+
+uint32_t Tracer::AddTracepoint(std::string location,
+                               std::vector<std::string> expressions,
+                               Options opts) {
+  auto tracepoint = std::make_unique<Tracepoint>();
+  tracepoint->id = static_cast<uint32_t>(tracepoints_.size());
+  tracepoint->location = std::move(location);
+  tracepoint->opts = opts;
+  tracepoint->slots.resize(expressions.size());
+  for (size_t i = 0; i < expressions.size(); ++i) {
+    tracepoint->slots[i].text = std::move(expressions[i]);
+  }
+  tracepoint->values.resize(expressions.size());
+  tracepoint->errors.resize((expressions.size() + 63) / 64);
+
+  tracepoints_.push_back(std::move(tracepoint));
+  return tracepoints_.back()->id;
+}
+
+void Tracer::Compile(Tracepoint& tracepoint, lldb::SBFrame frame,
+                     lldb::SBError& error) {
+  lldb::SBTarget target = frame.GetThread().GetProcess().GetTarget();
+  for (auto& slot : tracepoint.slots) {
+    slot.expr.reset();
+    slot.interpreter.reset();
+
+    auto source = SourceManager::Create(slot.text);
+    lldb::SBError compile_error;
+    auto expr =
+        CompileExpressionImpl(source, Context::Create(source, frame),
+                              tracepoint.opts, lldb::SBType(), compile_error);
+    if (compile_error.Fail()) {
+      continue;
+    }
+    TraceValueKind kind = GetValueKind(expr->tree->result_type_deref());
+    if (!tracepoint.compiled) {
+      slot.kind = kind;
+    }
+    // The kind is fixed by the schema, the types shouldn't change between
+    // frames at the same location though.
+    if (kind == TraceValueKind::kInvalid || kind != slot.kind) {
+      continue;
+    }
+
+    slot.interpreter = std::make_unique<Interpreter>(target, expr->source);
+    ConfigureInterpreter(*slot.interpreter, tracepoint.opts);
+    slot.expr = std::move(expr);
+  }
+
+  if (!tracepoint.compiled) {
+    TracepointSchema schema;
+    schema.id = tracepoint.id;
+    schema.location = tracepoint.location;
+    for (const auto& slot : tracepoint.slots) {
+      schema.expressions.push_back({slot.text, slot.kind});
+    }
+    buffer_->AddSchema(schema, error);
+    if (error.Fail()) {
+      return;
+    }
+    tracepoint.compiled = true;
+  }
+}
+
+void Tracer::Hit(uint32_t tracepoint_id, lldb::SBFrame frame,
+                 lldb::SBError& error) {
+  error.Clear();
+  if (tracepoint_id >= tracepoints_.size()) {
+    error.SetErrorStringWithFormat("unknown tracepoint %u", tracepoint_id);
+    return;
+  }
+  Tracepoint& tracepoint = *tracepoints_[tracepoint_id];
+
+  // The identifiers are bound to the variables of a specific frame.
+  lldb::tid_t thread_id = frame.GetThread().GetThreadID();
+  lldb::addr_t cfa = frame.GetCFA();
+  if (!tracepoint.compiled || thread_id != tracepoint.thread_id ||
+      cfa != tracepoint.cfa) {
+    Compile(tracepoint, frame, error);
+    if (error.Fail()) {
+      return;
+    }
+    tracepoint.thread_id = thread_id;
+    tracepoint.cfa = cfa;
+  }
+
+  std::fill(tracepoint.errors.begin(), tracepoint.errors.end(), 0);
+  for (size_t i = 0; i < tracepoint.slots.size(); ++i) {
+    auto& slot = tracepoint.slots[i];
+    tracepoint.values[i] = 0;
+
+    Error err;
+    Value value;
+    if (slot.expr) {
+      value = slot.interpreter->Eval(slot.expr->tree.get(), err);
+    }
+    if (!slot.expr || err) {
+      tracepoint.errors[i / 64] |= uint64_t{1} << (i % 64);
+      continue;
+    }
+    tracepoint.values[i] = GetSlotValue(value, slot.kind);
+  }
+
+  if (!buffer_->Append(tracepoint.id, thread_id, tracepoint.values.data(),
+                       tracepoint.errors.data(), tracepoint.values.size())) {
+    error.SetErrorString("the record is larger than the trace buffer");
+  }
+}
+
+}  // namespace lldb_eval
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_TRACEPOINT_H_
+#define LLDB_EVAL_TRACEPOINT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lldb-eval/api.h"
+#include "lldb-eval/trace_buffer.h"
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBFrame.h"
+
+namespace lldb_eval {
+
+// Records the values of groups of expressions at code locations into a
+// `TraceBuffer`. The identifiers of the expressions are bound to the variables
+// of the frame (see `BreakpointCondition`), so the expressions are recompiled
+// whenever the tracepoint is hit in another frame than the previous hit, e.g.
+// at another depth of a recursion. The schema of the records is fixed at the
+// first hit. Each hit evaluates the expressions to raw scalars, which are
+// appended to the buffer as a single fixed-layout record.
+//
+// The expressions must have scalar, pointer or array types. Expressions that
+// fail to compile or evaluate are marked in the error bitmap of the record.
+// Not thread-safe.
+class Tracer {
+ public:
+  explicit Tracer(std::unique_ptr<TraceBuffer> buffer);
+  ~Tracer();
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  // Adds a tracepoint recording the `expressions`. The `location` is a
+  // description for the decoder, e.g. "file.cc:42". Returns the id of the
+  // tracepoint. The context arguments and variables of `opts` must outlive
+  // the tracer.
+  uint32_t AddTracepoint(std::string location,
+                         std::vector<std::string> expressions,
+                         Options opts = {});
+
+  // Records the values of the expressions of the tracepoint in the `frame`.
+  // Call it from the callback of the breakpoint at the tracepoint's location.
+  // Fails if the record can't be written to the buffer.
+  void Hit(uint32_t tracepoint_id, lldb::SBFrame frame, lldb::SBError& error);
+
+  const TraceBuffer& buffer() const { return *buffer_; }
+
+ private:
+  struct Tracepoint;
+
+  void Compile(Tracepoint& tracepoint, lldb::SBFrame frame,
+               lldb::SBError& error);
+
+  std::unique_ptr<TraceBuffer> buffer_;
+  std::vector<std::unique_ptr<Tracepoint>> tracepoints_;
+};
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_TRACEPOINT_H_
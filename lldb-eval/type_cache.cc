@@ -0,0 +1,31 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lldb-eval/type_cache.h"
+
+#include <string>
+#include <utility>
+
+namespace lldb_eval {
+
+TypeSP TypeCache::Find(const std::string& name) const {
+  auto it = types_.find(name);
+  return it != types_.end() ? it->second : nullptr;
+}
+
+void TypeCache::Insert(const std::string& name, TypeSP type) {
+  types_.emplace(name, std::move(type));
+}
+
+}  // namespace lldb_eval
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LLDB_EVAL_TYPE_CACHE_H_
+#define LLDB_EVAL_TYPE_CACHE_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "lldb-eval/type.h"
+#include "lldb/API/SBTarget.h"
+
+namespace lldb_eval {
+
+// Types resolved by name (see `Context::ResolveTypeByName`), shared by the
+// contexts of the `target`. The names are resolved in the whole target, so the
+// entries stay valid until the target loads or unloads a module, `Clear()` the
+// cache then. Failed lookups aren't cached. Not thread-safe.
+class TypeCache {
+ public:
+  explicit TypeCache(lldb::SBTarget target) : target_(target) {}
+
+  // The entries are keyed by name only, so a cache serves a single target.
+  lldb::SBTarget target() const { return target_; }
+
+  // Returns the cached type, or nullptr if there isn't one.
+  TypeSP Find(const std::string& name) const;
+  void Insert(const std::string& name, TypeSP type);
+  void Clear() { types_.clear(); }
+
+ private:
+  lldb::SBTarget target_;
+  std::unordered_map<std::string, TypeSP> types_;
+};
+
+}  // namespace lldb_eval
+
+#endif  // LLDB_EVAL_TYPE_CACHE_H_
@@ -105,7 +105,7 @@ class UbDetectionTest : public ::testing::Test {
 
     assert(!err && "Error while parsing expression!");
 
-    lldb_eval::Interpreter eval(process_.GetTarget(), sm);
+    lldb_eval::Interpreter eval(process_.GetTarget(), sm->GetSourceText());
     lldb_eval::Value ret = eval.Eval(tree.get(), err);
 
     assert(!err && "Error while evaluating expression!");
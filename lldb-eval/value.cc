@@ -14,10 +14,13 @@
 
 #include "lldb-eval/value.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "lldb-eval/context.h"
 #include "lldb-eval/defines.h"
+#include "lldb-eval/memory_overlay.h"
 #include "lldb-eval/traits.h"
 #include "lldb/API/SBTarget.h"
 #include "lldb/API/SBType.h"
@@ -77,6 +80,29 @@ static uint64_t GetValueAsUnsigned(lldb::SBValue& value) {
   return ret;
 }
 
+static thread_local uint64_t num_created_values = 0;
+
+uint64_t GetNumCreatedValues() { return num_created_values; }
+
+lldb::SBValue CountCreatedValue(lldb::SBValue value) {
+  if (value.IsValid()) {
+    ++num_created_values;
+  }
+  return value;
+}
+
+static thread_local uint64_t num_value_reads = 0;
+static thread_local uint64_t num_bytes_read = 0;
+
+void CountProcessRead(uint64_t size) {
+  ++num_value_reads;
+  num_bytes_read += size;
+}
+
+uint64_t GetNumValueReads() { return num_value_reads; }
+
+uint64_t GetNumBytesRead() { return num_bytes_read; }
+
 bool LLDBType::IsScopedEnum() { return IsScopedEnum_V(type_); }
 
 TypeSP LLDBType::GetEnumerationIntegerType(ParserContext& ctx) {
@@ -107,6 +133,61 @@ bool LLDBType::CompareTo(TypeSP other) {
   return name == rhs_name;
 }
 
+Value::Value(lldb::SBTarget target, lldb::SBType type, const void* bytes)
+    : temp_(std::make_shared<Temporary>()), type_(LLDBType::CreateSP(type)) {
+  auto data = static_cast<const uint8_t*>(bytes);
+  temp_->target = target;
+  temp_->type = type;
+  temp_->bytes.assign(data, data + type.GetByteSize());
+}
+
+lldb::SBValue Value::inner_value() const {
+  if (!temp_) {
+    return value_;
+  }
+  if (!temp_->value.IsValid()) {
+    ++num_created_values;
+
+    lldb::SBError ignore;
+    lldb::SBData data;
+    lldb::SBTarget& target = temp_->target;
+    data.SetData(ignore, temp_->bytes.data(), temp_->bytes.size(),
+                 target.GetByteOrder(),
+                 static_cast<uint8_t>(target.GetAddressByteSize()));
+
+    // Force static value, otherwise we can end up with the "real" type.
+    temp_->value =
+        target.CreateValueFromData("$result", data, temp_->type)
+            .GetStaticValue();
+  }
+  return temp_->value;
+}
+
+llvm::APInt Value::GetRawInteger() {
+  if (temp_->bytes.empty()) {
+    return llvm::APInt(64, 0);
+  }
+  unsigned bit_width = static_cast<unsigned>(temp_->bytes.size() * CHAR_BIT);
+  llvm::APInt ret(bit_width, 0);
+  llvm::LoadIntFromMemory(ret, temp_->bytes.data(),
+                          static_cast<unsigned>(temp_->bytes.size()));
+  return ret;
+}
+
+void Value::ReadRawData(void* dst, size_t size) {
+  if (temp_) {
+    std::memcpy(dst, temp_->bytes.data(), std::min(size, temp_->bytes.size()));
+    return;
+  }
+  if (IsOverlaid()) {
+    ResolveOverlay().ReadRawData(dst, size);
+    return;
+  }
+  CountProcessRead(size);
+  lldb::SBError ignore;
+  value_.GetData().ReadRawData(ignore, 0, dst, size);
+}
+
 bool Value::IsScalar() { return type_->IsScalar(); }
 
 bool Value::IsInteger() { return type_->IsInteger(); }
@@ -141,20 +222,77 @@ bool Value::GetBool() {
   return false;
 }
 
+// Converts a floating-point value to a 64-bit integer like LLDB's scalars do,
+// i.e. truncating it toward zero.
+static llvm::APSInt FloatToInt64(const llvm::APFloat& value, bool is_unsigned) {
+  llvm::APSInt ret(64, is_unsigned);
+  bool ignore;
+  value.convertToInteger(ret, llvm::APFloat::rmTowardZero, &ignore);
+  return ret;
+}
+
 uint64_t Value::GetUInt64() {
   // GetValueAsUnsigned performs overflow according to the underlying type. For
   // example, if the underlying type is `int32_t` and the value is `-1`,
   // GetValueAsUnsigned will return 4294967295.
+  if (temp_) {
+    if (IsFloat()) {
+      llvm::APFloat value = GetFloat();
+      return FloatToInt64(value, !value.isNegative()).getZExtValue();
+    }
+    return static_cast<uint64_t>(GetValueAsSigned());
+  }
+  if (IsOverlaid()) {
+    return ResolveOverlay().GetUInt64();
+  }
+  CountProcessRead(type_->GetByteSize());
   return IsSigned() ? value_.GetValueAsSigned() : GetValueAsUnsigned(value_);
 }
 
-int64_t Value::GetValueAsSigned() { return value_.GetValueAsSigned(); }
+int64_t Value::GetValueAsSigned() {
+  if (temp_) {
+    // The bytes of floating-point values are converted, not reinterpreted.
+    if (IsFloat()) {
+      return FloatToInt64(GetFloat(), /*is_unsigned*/ false).getSExtValue();
+    }
+    llvm::APInt raw = GetRawInteger();
+    if (IsSigned()) {
+      return raw.sextOrTrunc(64).getSExtValue();
+    }
+    return static_cast<int64_t>(raw.zextOrTrunc(64).getZExtValue());
+  }
+  if (IsOverlaid()) {
+    return ResolveOverlay().GetValueAsSigned();
+  }
+  CountProcessRead(type_->GetByteSize());
+  return value_.GetValueAsSigned();
+}
+
+Value Value::AddressOf() {
+  return Value(CountCreatedValue(inner_value().AddressOf()));
+}
 
-Value Value::AddressOf() { return Value(value_.AddressOf()); }
+Value Value::Dereference() {
+  if (IsOverlaid()) {
+    // LLDB would follow the pointer stored in the process.
+    return ResolveOverlay().Dereference();
+  }
+  return Value(CountCreatedValue(inner_value().Dereference()));
+}
 
-Value Value::Dereference() { return Value(value_.Dereference()); }
+Value Value::Cast(lldb::SBType type) {
+  return Value(CountCreatedValue(inner_value().Cast(type)));
+}
 
 llvm::APSInt Value::GetInteger() {
+  if (temp_) {
+    return llvm::APSInt(GetRawInteger(), !IsSigned());
+  }
+  if (IsOverlaid()) {
+    return ResolveOverlay().GetInteger();
+  }
+
+  CountProcessRead(type_->GetByteSize());
   unsigned bit_width = static_cast<unsigned>(type_->GetByteSize() * CHAR_BIT);
   uint64_t value = GetValueAsUnsigned(value_);
   bool is_signed = IsSigned();
@@ -164,19 +302,18 @@ llvm::APSInt Value::GetInteger() {
 
 llvm::APFloat Value::GetFloat() {
   lldb::BasicType basic_type = type_->GetCanonicalType()->GetBasicType();
-  lldb::SBError ignore;
 
   switch (basic_type) {
     case lldb::eBasicTypeFloat: {
       float v = 0;
-      value_.GetData().ReadRawData(ignore, 0, &v, sizeof(float));
+      ReadRawData(&v, sizeof(float));
       return llvm::APFloat(v);
     }
     case lldb::eBasicTypeDouble:
       // No way to get more precision at the moment.
     case lldb::eBasicTypeLongDouble: {
       double v = 0;
-      value_.GetData().ReadRawData(ignore, 0, &v, sizeof(double));
+      ReadRawData(&v, sizeof(double));
       return llvm::APFloat(v);
     }
     default:
@@ -185,25 +322,49 @@ llvm::APFloat Value::GetFloat() {
 }
 
 Value Value::Clone() {
+  if (temp_) {
+    return Value(temp_->target, temp_->type, temp_->bytes.data());
+  }
+  if (IsOverlaid()) {
+    return ResolveOverlay();
+  }
+
   lldb::SBData data = value_.GetData();
+  CountProcessRead(data.GetByteSize());
   lldb::SBError ignore;
   auto raw_data = std::make_unique<uint8_t[]>(data.GetByteSize());
   data.ReadRawData(ignore, 0, raw_data.get(), data.GetByteSize());
-  return CreateValueFromBytes(value_.GetTarget(), raw_data.get(),
-                              ToSBType(type_));
+  return Value(value_.GetTarget(), ToSBType(type_), raw_data.get());
 }
 
 void Value::Update(const llvm::APInt& v) {
   assert(v.getBitWidth() == type_->GetByteSize() * CHAR_BIT &&
          "illegal argument: new value should be of the same size");
 
+  if (temp_) {
+    llvm::StoreIntToMemory(v, temp_->bytes.data(),
+                           static_cast<unsigned>(temp_->bytes.size()));
+    // Keep the LLDB object in sync, if it was created already.
+    if (!temp_->value.IsValid()) {
+      return;
+    }
+  } else if (overlay_ != nullptr) {
+    // Values without an address (e.g. in registers) are rejected by the
+    // interpreter before they're updated.
+    lldb::addr_t addr = value_.GetLoadAddress();
+    assert(addr != LLDB_INVALID_ADDRESS && "value must be in memory");
+    overlay_->Write(addr, v.getRawData(), type_->GetByteSize());
+    return;
+  }
+
+  lldb::SBValue value = inner_value();
   lldb::SBData data;
   lldb::SBError ignore;
-  lldb::SBTarget target = value_.GetTarget();
+  lldb::SBTarget target = value.GetTarget();
   data.SetData(ignore, v.getRawData(), type_->GetByteSize(),
                target.GetByteOrder(),
                static_cast<uint8_t>(target.GetAddressByteSize()));
-  value_.SetData(data, ignore);
+  value.SetData(data, ignore);
 }
 
 void Value::Update(Value v) {
@@ -219,6 +380,35 @@ void Value::Update(Value v) {
   }
 }
 
+void Value::SetMemoryOverlay(MemoryOverlay* overlay) {
+  if (!temp_) {
+    overlay_ = overlay;
+  }
+}
+
+bool Value::IsOverlaid() {
+  if (overlay_ == nullptr || overlay_->IsEmpty()) {
+    return false;
+  }
+  lldb::addr_t addr = value_.GetLoadAddress();
+  return addr != LLDB_INVALID_ADDRESS &&
+         overlay_->Covers(addr, type_->GetByteSize());
+}
+
+Value Value::ResolveOverlay() {
+  if (!IsOverlaid()) {
+    return *this;
+  }
+
+  size_t size = type_->GetByteSize();
+  CountProcessRead(size);
+  llvm::SmallVector<uint8_t, 16> bytes(size);
+  lldb::SBError ignore;
+  value_.GetData().ReadRawData(ignore, 0, bytes.data(), size);
+  overlay_->Read(value_.GetLoadAddress(), bytes.data(), size);
+  return Value(value_.GetTarget(), ToSBType(type_), bytes.data());
+}
+
 static llvm::APFloat CreateAPFloatFromAPSInt(const llvm::APSInt& value,
                                              lldb::BasicType basic_type) {
   switch (basic_type) {
@@ -382,16 +572,10 @@ Value CastFloatToEnumType(lldb::SBTarget target, Value val, TypeSP type,
 
 Value CreateValueFromBytes(lldb::SBTarget target, const void* bytes,
                            lldb::SBType type) {
-  lldb::SBError ignore;
-  lldb::SBData data;
-  data.SetData(ignore, bytes, type.GetByteSize(), target.GetByteOrder(),
-               static_cast<uint8_t>(target.GetAddressByteSize()));
-
-  // CreateValueFromData copies the data referenced by `bytes` to its own
-  // storage. `value` should be valid up until this point.
-  return Value(
-      // Force static value, otherwise we can end up with the "real" type.
-      target.CreateValueFromData("$result", data, type).GetStaticValue());
+  // The data referenced by `bytes` is copied to the value's own storage. The
+  // LLDB object is created only if the value is passed back to LLDB, e.g. as
+  // the result of the evaluation.
+  return Value(target, type, bytes);
 }
 
 Value CreateValueFromBytes(lldb::SBTarget target, const void* bytes,
@@ -24,11 +24,13 @@
 #include "lldb/API/SBValue.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/SmallVector.h"
 #include "type.h"
 
 namespace lldb_eval {
 
 class Error;
+class MemoryOverlay;
 
 /// Wrapper for lldb::SBType adding some convenience methods.
 class LLDBType : public Type {
@@ -123,11 +125,17 @@ class Value {
     type_ = LLDBType::CreateSP(value_.GetType());
   }
 
+  // Creates a temporary value of the given type from the raw bytes. Unlike the
+  // values created via SBTarget::CreateValueFromData, temporaries are stored
+  // natively and don't allocate anything in LLDB. The LLDB object is created
+  // lazily, only if it's requested via `inner_value()`.
+  Value(lldb::SBTarget target, lldb::SBType type, const void* bytes);
+
  public:
-  bool IsValid() { return value_.IsValid(); }
+  bool IsValid() { return temp_ ? temp_->type.IsValid() : value_.IsValid(); }
   explicit operator bool() { return IsValid(); }
 
-  lldb::SBValue inner_value() const { return value_; }
+  lldb::SBValue inner_value() const;
   std::shared_ptr<LLDBType> type() { return type_; }
 
   bool IsScalar();
@@ -146,6 +154,8 @@ class Value {
 
   Value AddressOf();
   Value Dereference();
+  // Reinterprets the value as the `type`, see `lldb::SBValue::Cast`.
+  Value Cast(lldb::SBType type);
 
   llvm::APSInt GetInteger();
   llvm::APFloat GetFloat();
@@ -154,9 +164,36 @@ class Value {
   void Update(const llvm::APInt& v);
   void Update(Value v);
 
+  // Attaches the memory overlay to a value living in the process memory. Reads
+  // of the value see the data written to the overlay and updates are written
+  // to the overlay instead of the process.
+  void SetMemoryOverlay(MemoryOverlay* overlay);
+
+  // Returns a temporary holding the current data of the value if the value is
+  // covered by its memory overlay, otherwise the value itself.
+  Value ResolveOverlay();
+
  private:
+  // Storage of a temporary value. It's shared between the copies of `Value`,
+  // so that all of them observe the updates and refer to the same LLDB object
+  // once it's created.
+  struct Temporary {
+    lldb::SBTarget target;
+    lldb::SBType type;
+    llvm::SmallVector<uint8_t, 16> bytes;
+    // Created on demand by `inner_value()`.
+    lldb::SBValue value;
+  };
+
+  // Returns the data of a temporary as an integer of the value's size.
+  llvm::APInt GetRawInteger();
+  void ReadRawData(void* dst, size_t size);
+  bool IsOverlaid();
+
   lldb::SBValue value_;
+  std::shared_ptr<Temporary> temp_;
   std::shared_ptr<LLDBType> type_;
+  MemoryOverlay* overlay_ = nullptr;
 };
 
 Value CastScalarToBasicType(lldb::SBTarget target, Value val, TypeSP type,
@@ -191,6 +228,27 @@ Value CreateValueFromBool(lldb::SBTarget target, bool value);
 
 Value CreateValueNullptr(lldb::SBTarget target, lldb::SBType type);
 
+// Returns the number of values obtained from LLDB on the calling thread since
+// it started: temporaries materialized in LLDB, members, dereferenced pointers,
+// casts and addresses, and the variables found by the identifier lookups. Every
+// such value is a ValueObject in LLDB, which makes this number useful for
+// tracking the memory footprint of the evaluation. It's an upper bound of the
+// objects LLDB allocates, since LLDB caches the children of a value.
+uint64_t GetNumCreatedValues();
+
+// Counts a value obtained from LLDB without a `Value`, unless it's invalid, and
+// returns it.
+lldb::SBValue CountCreatedValue(lldb::SBValue value);
+
+// Returns the number of reads of the values stored in the process (memory or
+// registers) and the number of bytes read, on the calling thread since it
+// started. Reads of temporary values, which are stored locally, aren't counted.
+uint64_t GetNumValueReads();
+uint64_t GetNumBytesRead();
+
+// Counts a read from the process made without a `Value`.
+void CountProcessRead(uint64_t size);
+
 inline lldb::SBType ToSBType(TypeSP type) {
   return static_cast<LLDBType&>(*type).type_;
 }
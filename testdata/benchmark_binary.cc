@@ -1,7 +1,19 @@
 #include <iostream>
 
+struct Point {
+  int x;
+  int y;
+};
+
+struct Data {
+  int arr[3] = {1, 2, 3};
+  Point point = {1, 2};
+  Point* ptr = &point;
+};
+
 int main() {
   int arr[] = {1, 2, 3};
+  Data data;
 
   // BREAK HERE
 
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Linked lists on the heap, for benchmarking expressions following chains of
+// pointers. The nodes at the same depth of all lists are allocated one after
+// another, the nodes of a single list are far apart.
+
+constexpr int kNumLists = 32;
+constexpr int kDepth = 8;
+
+struct Node {
+  Node* next;
+  int value;
+  char payload[1000];
+};
+
+int main() {
+  Node* nodes[kDepth][kNumLists];
+  for (int depth = 0; depth < kDepth; ++depth) {
+    for (int i = 0; i < kNumLists; ++i) {
+      nodes[depth][i] = new Node{nullptr, depth * kNumLists + i, {}};
+    }
+  }
+  Node* lists[kNumLists];
+  for (int i = 0; i < kNumLists; ++i) {
+    lists[i] = nodes[0][i];
+    for (int depth = 1; depth < kDepth; ++depth) {
+      nodes[depth - 1][i]->next = nodes[depth][i];
+    }
+  }
+
+  // The breakpoint is hit in every iteration, so that LLDB's memory cache can
+  // be dropped by resuming the process.
+  volatile int iteration = 0;
+  while (true) {
+    // BREAK HERE
+    iteration = iteration + 1;
+  }
+}
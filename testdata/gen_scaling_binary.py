@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+# Copyright 2021 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+""" Generates the source of a benchmark binary with the given number of
+    symbols, used to measure how lookups and type resolution scale.
+
+    Roughly a quarter of the symbols goes to each of: global variables, struct
+    types (with one instance each), enumerators and fields of a single wide
+    struct. Regardless of the size, the binary also has a deep namespace, a
+    10-level class hierarchy with virtual bases, a linked list and a few STL
+    containers.
+
+    Usage examples:
+        python gen_scaling_binary.py --num_symbols=1000 > scaling_binary.cc
+"""
+
+import argparse
+
+# Depth of the nested namespaces and of the class hierarchy.
+DEPTH = 10
+# Number of globals per namespace and enumerators per (small) enum.
+CHUNK_SIZE = 100
+# Maximum number of enumerators in the big scoped enum.
+MAX_BIG_ENUM_SIZE = 10000
+LIST_SIZE = 1000
+
+
+def gen_globals(out, count):
+  num_file_scope = count // 2
+  for i in range(num_file_scope):
+    out.append(f"int global_{i} = {i};")
+
+  for i in range(count - num_file_scope):
+    if i % CHUNK_SIZE == 0:
+      if i > 0:
+        out.append("}")
+      out.append(f"namespace ns_{i // CHUNK_SIZE} {{")
+    out.append(f"int ns_global_{i % CHUNK_SIZE} = {i};")
+  if count - num_file_scope > 0:
+    out.append("}")
+
+  for i in range(DEPTH):
+    out.append(f"namespace deep_{i} {{")
+  out.append("int deep_global = 1;")
+  out.append("struct DeepType { int value = 2; };")
+  out.append("DeepType deep_value;")
+  out.append("}" * DEPTH)
+
+
+def gen_types(out, count):
+  for i in range(count):
+    out.append(f"struct Type_{i} {{ int value_{i} = {i}; }};")
+    out.append(f"Type_{i} type_{i};")
+
+
+def gen_enums(out, count):
+  big_enum_size = min(count // 2, MAX_BIG_ENUM_SIZE)
+  out.append("enum class BigEnum {")
+  for i in range(big_enum_size):
+    out.append(f"  kBigEnum_{i},")
+  out.append("};")
+  out.append("BigEnum big_enum = BigEnum::kBigEnum_0;")
+
+  for i in range(count - big_enum_size):
+    if i % CHUNK_SIZE == 0:
+      if i > 0:
+        out.append("};")
+        out.append(f"Enum_{i // CHUNK_SIZE - 1} enum_{i // CHUNK_SIZE - 1};")
+      out.append(f"enum Enum_{i // CHUNK_SIZE} {{")
+    out.append(f"  kEnum_{i // CHUNK_SIZE}_{i % CHUNK_SIZE},")
+  if count - big_enum_size > 0:
+    last = (count - big_enum_size - 1) // CHUNK_SIZE
+    out.append("};")
+    out.append(f"Enum_{last} enum_{last};")
+
+
+def gen_wide_struct(out, count):
+  out.append("struct WideStruct {")
+  for i in range(count):
+    out.append(f"  int field_{i} = {i};")
+  out.append("};")
+  out.append("WideStruct wide_struct;")
+
+
+def gen_hierarchy(out):
+  out.append("struct Level_0 {")
+  out.append("  virtual ~Level_0() = default;")
+  out.append("  int level_0 = 0;")
+  out.append("};")
+  for i in range(1, DEPTH):
+    out.append(f"struct Level_{i} : virtual Level_{i - 1} {{")
+    out.append(f"  int level_{i} = {i};")
+    out.append("};")
+  out.append(f"Level_{DEPTH - 1} level_{DEPTH - 1};")
+
+
+def gen_source(num_symbols):
+  out = [
+      "// Generated by gen_scaling_binary.py, do not edit.",
+      "",
+      "#include <map>",
+      "#include <string>",
+      "#include <vector>",
+      "",
+  ]
+
+  quarter = num_symbols // 4
+  gen_globals(out, quarter)
+  gen_types(out, quarter // 2)
+  gen_enums(out, quarter)
+  gen_wide_struct(out, quarter)
+  gen_hierarchy(out)
+
+  out.extend([
+      f"int big_array[{num_symbols}];",
+      "",
+      "struct ListNode {",
+      "  int value;",
+      "  ListNode* next;",
+      "};",
+      f"ListNode list_nodes[{LIST_SIZE}];",
+      "ListNode* list_head = &list_nodes[0];",
+      "",
+      "int main() {",
+      f"  for (int i = 0; i < {LIST_SIZE}; ++i) {{",
+      "    list_nodes[i].value = i;",
+      f"    if (i + 1 < {LIST_SIZE}) {{",
+      "      list_nodes[i].next = &list_nodes[i + 1];",
+      "    }",
+      "  }",
+      f"  for (int i = 0; i < {num_symbols}; ++i) {{",
+      "    big_array[i] = i;",
+      "  }",
+      "",
+      f"  std::vector<int> vec(big_array, big_array + {num_symbols});",
+      "  std::map<int, int> map;",
+      f"  for (int i = 0; i < {num_symbols}; i += 10) {{",
+      "    map[i] = i;",
+      "  }",
+      "  std::string str = \"Hello, world\";",
+      "",
+      "  // BREAK HERE",
+      "",
+      "  return static_cast<int>(vec.size() + map.size() + str.size()) & 0;",
+      "}",
+  ])
+  return "\n".join(out) + "\n"
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument("--num_symbols", type=int, required=True,
+                      help="approximate number of symbols to generate")
+  args = parser.parse_args()
+  print(gen_source(args.num_symbols), end="")
+
+
+if __name__ == "__main__":
+  main()
@@ -43,6 +43,7 @@ static void TestArithmetic() {
   auto fdenorm = 0x0.1p-145f;
 
   // BREAK(TestArithmetic)
+  // BREAK(TestTypedResults)
   // BREAK(TestZeroDivision)
 }
 
@@ -454,6 +455,7 @@ static void TestCStyleCast() {
 
   // BREAK(TestCStyleCastBuiltins)
   // BREAK(TestCStyleCastBasicType)
+  // BREAK(TestCastFloatTemporary)
   // BREAK(TestCStyleCastPointer)
   // BREAK(TestCStyleCastNullptrType)
 
@@ -1041,7 +1043,38 @@ void TestSideEffects() {
   int xa[] = {1, 2};
   int* p = &x;
 
+  struct BitFields {
+    int a;
+    unsigned b : 4;
+    unsigned c : 4;
+  };
+  BitFields bf = {1, 2, 3};
+
   // BREAK(TestSideEffects)
+  // BREAK(TestSideEffectsSequencing)
+  // BREAK(TestProcessSnapshot)
+  // BREAK(TestMemoryOverlay)
+  // BREAK(TestBreakpointCondition)
+  // BREAK(TestTracepoint)
+  // BREAK(TestTracepointWrap)
+  // BREAK(TestTraceCorruptedSchema)
+  // BREAK(TestWatchSet)
+  // BREAK(TestReadSet)
+  // BREAK(TestEvalStats)
+  // BREAK(TestTimeTrace)
+  // BREAK(TestEvalBudget)
+  // BREAK(TestMacroLocations)
+  // BREAK(TestTypeCache)
+  // BREAK(TestAsyncEvaluator)
+}
+
+int TestRecursion(int depth) {
+  int value = depth * 10;
+  // BREAK(TestTracepointFrames)
+  if (depth > 0) {
+    value += TestRecursion(depth - 1);
+  }
+  return value;
 }
 
 void TestUniquePtr() {
@@ -1168,6 +1201,7 @@ static void TestSeparateParsing() {
 
   // BREAK(TestSeparateParsing)
   // BREAK(TestSeparateParsingWithContextVars)
+  // BREAK(TestSeparateParsingTypedResults)
 }
 
 // Used by TestRegistersNoDollar
@@ -1235,6 +1269,7 @@ void main() {
   TestMemberFunctionCall();
   TestCompositeAssignment();
   TestSideEffects();
+  TestRecursion(1);
   TestUniquePtr();
   TestSharedPtr();
   TestTypeComparison();
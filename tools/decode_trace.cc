@@ -0,0 +1,131 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Prints the records of a trace file written by `lldb_eval::Tracer`.
+//
+//   decode_trace <trace file>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lldb-eval/trace_buffer.h"
+#include "lldb/API/SBError.h"
+
+namespace lldb_eval {
+
+std::string kind_to_string(TraceValueKind kind) {
+  switch (kind) {
+    case TraceValueKind::kInvalid:
+      return "invalid";
+    case TraceValueKind::kInt64:
+      return "int64";
+    case TraceValueKind::kUInt64:
+      return "uint64";
+    case TraceValueKind::kDouble:
+      return "double";
+    case TraceValueKind::kBool:
+      return "bool";
+    case TraceValueKind::kAddress:
+      return "address";
+  }
+  return "unknown";
+}
+
+std::string value_to_string(uint64_t value, TraceValueKind kind) {
+  char buffer[64];
+  switch (kind) {
+    case TraceValueKind::kInt64:
+      snprintf(buffer, sizeof(buffer), "%" PRId64,
+               static_cast<int64_t>(value));
+      break;
+    case TraceValueKind::kUInt64:
+      snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+      break;
+    case TraceValueKind::kDouble: {
+      double v;
+      memcpy(&v, &value, sizeof(v));
+      snprintf(buffer, sizeof(buffer), "%g", v);
+      break;
+    }
+    case TraceValueKind::kBool:
+      return value ? "true" : "false";
+    case TraceValueKind::kAddress:
+      snprintf(buffer, sizeof(buffer), "0x%016" PRIx64, value);
+      break;
+    case TraceValueKind::kInvalid:
+      return "<invalid>";
+  }
+  return buffer;
+}
+
+}  // namespace lldb_eval
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+    return 1;
+  }
+
+  lldb::SBError error;
+  auto reader = lldb_eval::TraceReader::Open(argv[1], error);
+  if (!reader) {
+    fprintf(stderr, "%s\n", error.GetCString());
+    return 1;
+  }
+
+  for (const auto& schema : reader->schemas()) {
+    printf("tracepoint %u at %s\n", schema.id, schema.location.c_str());
+    for (const auto& expr : schema.expressions) {
+      printf("  %s: %s\n", expr.text.c_str(),
+             lldb_eval::kind_to_string(expr.kind).c_str());
+    }
+  }
+
+  std::vector<lldb_eval::TraceRecord> records = reader->ReadRecords(error);
+  if (error.Fail()) {
+    fprintf(stderr, "%s\n", error.GetCString());
+    return 1;
+  }
+  uint64_t overwritten = reader->num_records() - records.size();
+  if (overwritten > 0) {
+    printf("%" PRIu64 " records were overwritten\n", overwritten);
+  }
+
+  for (const auto& record : records) {
+    const auto* schema = reader->FindSchema(record.tracepoint_id);
+    if (!schema) {
+      fprintf(stderr, "record #%" PRIu64 " of unknown tracepoint %u\n",
+              record.sequence, record.tracepoint_id);
+      return 1;
+    }
+    printf("#%" PRIu64 " thread %" PRIu64 " %s:", record.sequence,
+           record.thread_id, schema->location.c_str());
+    for (size_t i = 0; i < record.values.size(); ++i) {
+      std::string value =
+          record.errors[i]
+              ? "<error>"
+              : lldb_eval::value_to_string(record.values[i],
+                                           schema->expressions[i].kind);
+      printf(" %s=%s", schema->expressions[i].text.c_str(), value.c_str());
+    }
+    printf("\n");
+  }
+
+  return 0;
+}
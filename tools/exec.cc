@@ -16,6 +16,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <system_error>
 
 #include "cpp-linenoise/linenoise.hpp"
 #include "lldb-eval/api.h"
@@ -25,10 +26,17 @@
 #include "lldb/API/SBProcess.h"
 #include "lldb/API/SBTarget.h"
 #include "lldb/API/SBThread.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tools/cpp/runfiles/runfiles.h"
 
 using bazel::tools::cpp::runfiles::Runfiles;
 
+// If set, a Chrome trace of each evaluation is written to this directory.
+std::string time_trace_dir;
+int num_traces = 0;
+
 int64_t timer(std::function<void()> func) {
   auto start = std::chrono::high_resolution_clock::now();
   func();
@@ -49,10 +57,28 @@ void EvalExpr(lldb::SBFrame frame, const std::string& expr) {
   lldb_eval::Options opts;
   opts.allow_side_effects = true;
 
+  if (!time_trace_dir.empty()) {
+    llvm::timeTraceProfilerInitialize(/*TimeTraceGranularity*/ 0, "exec");
+  }
+
   auto elapsed = timer([&]() {
     value = lldb_eval::EvaluateExpression(frame, expr.c_str(), opts, error);
   });
 
+  if (!time_trace_dir.empty()) {
+    std::string path =
+        time_trace_dir + "/expr-" + std::to_string(num_traces++) + ".json";
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path, ec);
+    if (ec) {
+      std::cerr << "Can't write " << path << ": " << ec.message() << std::endl;
+    } else {
+      llvm::timeTraceProfilerWrite(os);
+      std::cerr << "trace = " << path << std::endl;
+    }
+    llvm::timeTraceProfilerCleanup();
+  }
+
   if (error.GetError()) {
     std::cerr << error.GetCString() << std::endl;
   } else {
@@ -123,6 +149,14 @@ int main(int argc, char** argv) {
   std::string break_line = "// BREAK HERE";
   std::string expr;
 
+  // Usage: exec [--time-trace=<dir>] [[<break name>] <expression>]
+  llvm::StringRef flag = argc > 1 ? argv[1] : "";
+  if (flag.consume_front("--time-trace=")) {
+    time_trace_dir = flag.str();
+    --argc;
+    ++argv;
+  }
+
   if (argc == 1) {
     repl_mode = true;
   } else if (argc == 2) {
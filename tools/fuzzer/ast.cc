@@ -28,6 +28,8 @@
 #include <utility>
 #include <variant>
 
+#include "tools/fuzzer/pool_allocator.h"
+
 namespace fuzzer {
 
 struct BinOpInfo {
@@ -154,7 +156,7 @@ bool EnumType::operator!=(const EnumType& rhs) const {
 }
 
 ArrayType::ArrayType(Type type, size_t size)
-    : type_(std::make_shared<Type>(std::move(type))), size_(size) {}
+    : type_(make_pooled<Type>(std::move(type))), size_(size) {}
 const Type& ArrayType::type() const { return *type_; }
 size_t ArrayType::size() const { return size_; }
 std::ostream& operator<<(std::ostream& os, const ArrayType& type) {
@@ -172,7 +174,7 @@ bool ArrayType::operator!=(const ArrayType& rhs) const {
 }
 
 QualifiedType::QualifiedType(Type type, CvQualifiers cv_qualifiers)
-    : type_(std::make_shared<Type>(std::move(type))),
+    : type_(make_pooled<Type>(std::move(type))),
       cv_qualifiers_(cv_qualifiers) {}
 const Type& QualifiedType::type() const { return *type_; }
 CvQualifiers QualifiedType::cv_qualifiers() const { return cv_qualifiers_; }
@@ -205,12 +207,12 @@ std::ostream& operator<<(std::ostream& os, const Type& type) {
 }
 
 BinaryExpr::BinaryExpr(Expr lhs, BinOp op, Expr rhs)
-    : lhs_(std::make_shared<Expr>(std::move(lhs))),
-      rhs_(std::make_shared<Expr>(std::move(rhs))),
+    : lhs_(make_pooled<Expr>(std::move(lhs))),
+      rhs_(make_pooled<Expr>(std::move(rhs))),
       op_(op) {}
 BinaryExpr::BinaryExpr(Expr lhs, BinOp op, Expr rhs, Type expr_type)
-    : lhs_(std::make_shared<Expr>(std::move(lhs))),
-      rhs_(std::make_shared<Expr>(std::move(rhs))),
+    : lhs_(make_pooled<Expr>(std::move(lhs))),
+      rhs_(make_pooled<Expr>(std::move(rhs))),
       op_(op),
       expr_type_(std::make_unique<Type>(std::move(expr_type))) {}
 const Expr& BinaryExpr::lhs() const { return *lhs_; }
@@ -232,7 +234,7 @@ std::ostream& operator<<(std::ostream& os, const VariableExpr& e) {
 }
 
 UnaryExpr::UnaryExpr(UnOp op, Expr expr)
-    : expr_(std::make_shared<Expr>(std::move(expr))), op_(op) {}
+    : expr_(make_pooled<Expr>(std::move(expr))), op_(op) {}
 UnOp UnaryExpr::op() const { return op_; }
 const Expr& UnaryExpr::expr() const { return *expr_; }
 std::ostream& operator<<(std::ostream& os, const UnaryExpr& e) {
@@ -350,14 +352,14 @@ std::ostream& operator<<(std::ostream& os, const DoubleConstant& e) {
 }
 
 ParenthesizedExpr::ParenthesizedExpr(Expr expr)
-    : expr_(std::make_shared<Expr>(std::move(expr))) {}
+    : expr_(make_pooled<Expr>(std::move(expr))) {}
 const Expr& ParenthesizedExpr::expr() const { return *expr_; }
 std::ostream& operator<<(std::ostream& os, const ParenthesizedExpr& e) {
   return os << "(" << e.expr() << ")";
 }
 
 AddressOf::AddressOf(Expr expr)
-    : expr_(std::make_shared<Expr>(std::move(expr))) {}
+    : expr_(make_pooled<Expr>(std::move(expr))) {}
 const Expr& AddressOf::expr() const { return *expr_; }
 std::ostream& operator<<(std::ostream& os, const AddressOf& e) {
   os << "&";
@@ -369,10 +371,10 @@ std::ostream& operator<<(std::ostream& os, const AddressOf& e) {
 }
 
 MemberOf::MemberOf(Expr expr, std::string field)
-    : expr_(std::make_shared<Expr>(std::move(expr))),
+    : expr_(make_pooled<Expr>(std::move(expr))),
       field_(std::move(field)) {}
 MemberOf::MemberOf(Expr expr, std::string field, TaggedType expr_type)
-    : expr_(std::make_shared<Expr>(std::move(expr))),
+    : expr_(make_pooled<Expr>(std::move(expr))),
       field_(std::move(field)),
       expr_type_(std::move(expr_type)) {}
 const Expr& MemberOf::expr() const { return *expr_; }
@@ -382,10 +384,10 @@ std::ostream& operator<<(std::ostream& os, const MemberOf& e) {
 }
 
 MemberOfPtr::MemberOfPtr(Expr expr, std::string field)
-    : expr_(std::make_shared<Expr>(std::move(expr))),
+    : expr_(make_pooled<Expr>(std::move(expr))),
       field_(std::move(field)) {}
 MemberOfPtr::MemberOfPtr(Expr expr, std::string field, TaggedType expr_type)
-    : expr_(std::make_shared<Expr>(std::move(expr))),
+    : expr_(make_pooled<Expr>(std::move(expr))),
       field_(std::move(field)),
       expr_type_(std::move(expr_type)) {}
 const Expr& MemberOfPtr::expr() const { return *expr_; }
@@ -395,8 +397,8 @@ std::ostream& operator<<(std::ostream& os, const MemberOfPtr& e) {
 }
 
 ArrayIndex::ArrayIndex(Expr expr, Expr idx)
-    : expr_(std::make_shared<Expr>(std::move(expr))),
-      idx_(std::make_shared<Expr>(std::move(idx))) {}
+    : expr_(make_pooled<Expr>(std::move(expr))),
+      idx_(make_pooled<Expr>(std::move(idx))) {}
 const Expr& ArrayIndex::expr() const { return *expr_; }
 const Expr& ArrayIndex::idx() const { return *idx_; }
 std::ostream& operator<<(std::ostream& os, const ArrayIndex& e) {
@@ -404,14 +406,14 @@ std::ostream& operator<<(std::ostream& os, const ArrayIndex& e) {
 }
 
 TernaryExpr::TernaryExpr(Expr cond, Expr lhs, Expr rhs)
-    : cond_(std::make_shared<Expr>(std::move(cond))),
-      lhs_(std::make_shared<Expr>(std::move(lhs))),
-      rhs_(std::make_shared<Expr>(std::move(rhs))) {}
+    : cond_(make_pooled<Expr>(std::move(cond))),
+      lhs_(make_pooled<Expr>(std::move(lhs))),
+      rhs_(make_pooled<Expr>(std::move(rhs))) {}
 TernaryExpr::TernaryExpr(Expr cond, Expr lhs, Expr rhs, Type expr_type)
-    : cond_(std::make_shared<Expr>(std::move(cond))),
-      lhs_(std::make_shared<Expr>(std::move(lhs))),
-      rhs_(std::make_shared<Expr>(std::move(rhs))),
-      expr_type_(std::make_shared<Type>(std::move(expr_type))) {}
+    : cond_(make_pooled<Expr>(std::move(cond))),
+      lhs_(make_pooled<Expr>(std::move(lhs))),
+      rhs_(make_pooled<Expr>(std::move(rhs))),
+      expr_type_(make_pooled<Type>(std::move(expr_type))) {}
 const Expr& TernaryExpr::cond() const { return *cond_; }
 const Expr& TernaryExpr::lhs() const { return *lhs_; }
 const Expr& TernaryExpr::rhs() const { return *rhs_; }
@@ -423,7 +425,7 @@ std::ostream& operator<<(std::ostream& os, const TernaryExpr& e) {
 CastExpr::CastExpr(Kind kind, Type type, Expr expr)
     : kind_(kind),
       type_(std::move(type)),
-      expr_(std::make_shared<Expr>(std::move(expr))) {}
+      expr_(make_pooled<Expr>(std::move(expr))) {}
 CastExpr::Kind CastExpr::kind() const { return kind_; }
 const Type& CastExpr::type() const { return type_; }
 const Expr& CastExpr::expr() const { return *expr_; }
@@ -445,7 +447,7 @@ std::ostream& operator<<(std::ostream& os, const CastExpr& e) {
 }
 
 DereferenceExpr::DereferenceExpr(Expr expr)
-    : expr_(std::make_shared<Expr>(std::move(expr))) {}
+    : expr_(make_pooled<Expr>(std::move(expr))) {}
 const Expr& DereferenceExpr::expr() const { return *expr_; }
 std::ostream& operator<<(std::ostream& os, const DereferenceExpr& expr) {
   return os << "*" << expr.expr();
@@ -731,30 +733,6 @@ int cast_kind_precedence(CastExpr::Kind kind) {
 
 }  // namespace fuzzer
 
-static inline size_t hash_combine_impl(size_t acc) { return acc; }
-
-template <typename T, typename... Rest>
-static inline size_t hash_combine_impl(size_t acc, T&& v, Rest&&... rest) {
-  // std::hash has specializations for e.g. `std::string`, but not for `const
-  // std::string&`, so remove any cv-qualified reference from type `T`.
-  using Type = std::remove_cv_t<std::remove_reference_t<T>>;
-  std::hash<Type> hasher;
-  // Disclaimer: Hash combining algorithm is taken from `boost::hash_combine`,
-  // no idea how it fares in practice.
-  acc ^= hasher(std::forward<T>(v)) + 0x9e3779b9u + (acc << 6) + (acc >> 2);
-  return hash_combine_impl(acc, std::forward<Rest>(rest)...);
-}
-
-/*
- * Combines multiple hash values together. This is equivalent to
- * `boost::hash_combine`, albeit with support for perfect forwarding (so that
- * invocation of `hash_combine` can be conveniently a one-liner).
- */
-template <typename... Args>
-static inline size_t hash_combine(Args&&... args) {
-  return hash_combine_impl(0, std::forward<Args>(args)...);
-}
-
 enum class HashingTypeKind {
   PointerType,
   QualifiedType,
@@ -768,6 +746,7 @@ namespace std {
 
 using fuzzer::ArrayType;
 using fuzzer::EnumType;
+using fuzzer::hash_combine;
 using fuzzer::NullptrType;
 using fuzzer::PointerType;
 using fuzzer::QualifiedType;
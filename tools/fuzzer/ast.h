@@ -23,7 +23,9 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <type_traits>
 #include <typeindex>  // forward references `std::hash`
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -643,6 +645,30 @@ class EnumConstant {
   std::string literal_;
 };
 
+inline size_t hash_combine_impl(size_t acc) { return acc; }
+
+template <typename T, typename... Rest>
+inline size_t hash_combine_impl(size_t acc, T&& v, Rest&&... rest) {
+  // std::hash has specializations for e.g. `std::string`, but not for `const
+  // std::string&`, so remove any cv-qualified reference from type `T`.
+  using Type = std::remove_cv_t<std::remove_reference_t<T>>;
+  std::hash<Type> hasher;
+  // Disclaimer: Hash combining algorithm is taken from `boost::hash_combine`,
+  // no idea how it fares in practice.
+  acc ^= hasher(std::forward<T>(v)) + 0x9e3779b9u + (acc << 6) + (acc >> 2);
+  return hash_combine_impl(acc, std::forward<Rest>(rest)...);
+}
+
+/*
+ * Combines multiple hash values together. This is equivalent to
+ * `boost::hash_combine`, albeit with support for perfect forwarding (so that
+ * invocation of `hash_combine` can be conveniently a one-liner).
+ */
+template <typename... Args>
+inline size_t hash_combine(Args&&... args) {
+  return hash_combine_impl(0, std::forward<Args>(args)...);
+}
+
 }  // namespace fuzzer
 
 // Forward declarations of hash specializations
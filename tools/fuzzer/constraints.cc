@@ -17,6 +17,7 @@
 #include <variant>
 
 #include "tools/fuzzer/ast.h"
+#include "tools/fuzzer/pool_allocator.h"
 
 namespace fuzzer {
 
@@ -53,7 +54,7 @@ TypeConstraints::TypeConstraints(const Type& type, bool allow_arrays_if_ptr) {
     }
 
     ptr_types_ =
-        std::make_shared<TypeConstraints>(inner, /*allow_arrays_if_ptr*/ false);
+        make_pooled<TypeConstraints>(inner, /*allow_arrays_if_ptr*/ false);
 
     if (allow_arrays_if_ptr) {
       array_types_ = ptr_types_;
@@ -65,7 +66,7 @@ TypeConstraints::TypeConstraints(const Type& type, bool allow_arrays_if_ptr) {
   if (array_type != nullptr) {
     const auto& inner = array_type->type();
     array_types_ =
-        std::make_shared<TypeConstraints>(inner, /*allow_arrays_if_ptr*/ false);
+        make_pooled<TypeConstraints>(inner, /*allow_arrays_if_ptr*/ false);
     array_size_ = array_type->size();
     return;
   }
@@ -93,7 +94,7 @@ TypeConstraints TypeConstraints::make_pointer_constraints() const {
   TypeConstraints retval;
 
   if (satisfiable()) {
-    auto specific_types = std::make_shared<TypeConstraints>(*this);
+    auto specific_types = make_pooled<TypeConstraints>(*this);
     retval.ptr_types_ = specific_types;
     retval.array_types_ = specific_types;
   }
@@ -344,4 +345,87 @@ bool TypeConstraints::allows_type(const Type& type) const {
   return false;
 }
 
+static const TypeConstraints& specific_value(
+    const std::shared_ptr<TypeConstraints>& constraints) {
+  return *constraints;
+}
+
+template <typename T>
+static const T& specific_value(const T& value) {
+  return value;
+}
+
+// Compares `NoType`/`AnyType`/specific type(s) variants. Specific types are
+// compared by value.
+template <typename T>
+static bool variants_equal(const std::variant<NoType, AnyType, T>& lhs,
+                           const std::variant<NoType, AnyType, T>& rhs) {
+  if (lhs.index() != rhs.index()) {
+    return false;
+  }
+  const auto* lhs_specific = std::get_if<T>(&lhs);
+  const auto* rhs_specific = std::get_if<T>(&rhs);
+  if (lhs_specific == nullptr) {
+    return true;
+  }
+  return specific_value(*lhs_specific) == specific_value(*rhs_specific);
+}
+
+template <typename T>
+static size_t variant_hash(const std::variant<NoType, AnyType, T>& variant) {
+  const auto* specific = std::get_if<T>(&variant);
+  if (specific == nullptr) {
+    return variant.index();
+  }
+  return hash_combine(variant.index(), specific_value(*specific));
+}
+
+bool TypeConstraints::operator==(const TypeConstraints& rhs) const {
+  return scalar_types_ == rhs.scalar_types_ &&
+         variants_equal(unscoped_enum_types_, rhs.unscoped_enum_types_) &&
+         variants_equal(scoped_enum_types_, rhs.scoped_enum_types_) &&
+         variants_equal(tagged_types_, rhs.tagged_types_) &&
+         variants_equal(ptr_types_, rhs.ptr_types_) &&
+         variants_equal(array_types_, rhs.array_types_) &&
+         allows_void_pointer_ == rhs.allows_void_pointer_ &&
+         allows_nullptr_ == rhs.allows_nullptr_ &&
+         array_size_ == rhs.array_size_ &&
+         allows_literal_zero_ == rhs.allows_literal_zero_;
+}
+
 }  // namespace fuzzer
+
+namespace std {
+
+using fuzzer::ExprConstraints;
+using fuzzer::hash_combine;
+using fuzzer::MemoryConstraints;
+using fuzzer::TypeConstraints;
+
+size_t hash<TypeConstraints>::operator()(
+    const TypeConstraints& constraints) const {
+  return hash_combine(
+      constraints.scalar_types_,
+      fuzzer::variant_hash(constraints.unscoped_enum_types_),
+      fuzzer::variant_hash(constraints.scoped_enum_types_),
+      fuzzer::variant_hash(constraints.tagged_types_),
+      fuzzer::variant_hash(constraints.ptr_types_),
+      fuzzer::variant_hash(constraints.array_types_),
+      constraints.allows_void_pointer_, constraints.allows_nullptr_,
+      constraints.array_size_, constraints.allows_literal_zero_);
+}
+
+size_t hash<MemoryConstraints>::operator()(
+    const MemoryConstraints& constraints) const {
+  return hash_combine(constraints.must_be_valid(),
+                      constraints.required_freedom_index());
+}
+
+size_t hash<ExprConstraints>::operator()(
+    const ExprConstraints& constraints) const {
+  return hash_combine(constraints.type_constraints(),
+                      constraints.memory_constraints(),
+                      constraints.must_be_lvalue());
+}
+
+}  // namespace std
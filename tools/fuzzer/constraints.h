@@ -246,7 +246,14 @@ class TypeConstraints {
   // What kind of types do these constraints allow a pointer to?
   TypeConstraints allowed_to_point_to() const;
 
+  // Two constraints are equal if they allow the same set of types. Pointer and
+  // array element constraints are compared by value.
+  bool operator==(const TypeConstraints& rhs) const;
+  bool operator!=(const TypeConstraints& rhs) const { return !(*this == rhs); }
+
  private:
+  friend struct std::hash<TypeConstraints>;
+
   ScalarMask scalar_types_;
   std::variant<NoType, AnyType, EnumType> unscoped_enum_types_;
   std::variant<NoType, AnyType, EnumType> scoped_enum_types_;
@@ -319,6 +326,14 @@ class MemoryConstraints {
                                 : MemoryConstraints(freedom);
   }
 
+  bool operator==(const MemoryConstraints& rhs) const {
+    return must_be_valid_ == rhs.must_be_valid_ &&
+           required_freedom_index_ == rhs.required_freedom_index_;
+  }
+  bool operator!=(const MemoryConstraints& rhs) const {
+    return !(*this == rhs);
+  }
+
  private:
   bool must_be_valid_ = false;
   int required_freedom_index_ = 0;
@@ -356,6 +371,13 @@ class ExprConstraints {
     return memory_constraints_;
   }
 
+  bool operator==(const ExprConstraints& rhs) const {
+    return must_be_lvalue_ == rhs.must_be_lvalue_ &&
+           memory_constraints_ == rhs.memory_constraints_ &&
+           type_constraints_ == rhs.type_constraints_;
+  }
+  bool operator!=(const ExprConstraints& rhs) const { return !(*this == rhs); }
+
  private:
   TypeConstraints type_constraints_;
   MemoryConstraints memory_constraints_;
@@ -379,4 +401,24 @@ inline constexpr ScalarMask FLOAT_TYPES = {
 
 }  // namespace fuzzer
 
+// Hashes of constraints, so that they can be used as keys of memo tables.
+namespace std {
+
+template <>
+struct hash<fuzzer::TypeConstraints> {
+  size_t operator()(const fuzzer::TypeConstraints& constraints) const;
+};
+
+template <>
+struct hash<fuzzer::MemoryConstraints> {
+  size_t operator()(const fuzzer::MemoryConstraints& constraints) const;
+};
+
+template <>
+struct hash<fuzzer::ExprConstraints> {
+  size_t operator()(const fuzzer::ExprConstraints& constraints) const;
+};
+
+}  // namespace std
+
 #endif  // INCLUDE_CONSTRAINTS_H
@@ -262,12 +262,35 @@ TEST(Constraints, Unsatisfiability) {
   EXPECT_THAT(default_specific_types.satisfiable(), IsFalse());
 }
 
-namespace fuzzer {
-bool operator==(const MemoryConstraints& lhs, const MemoryConstraints& rhs) {
-  return lhs.must_be_valid() == rhs.must_be_valid() &&
-         lhs.required_freedom_index() == rhs.required_freedom_index();
+TEST(Constraints, Equality) {
+  Type int_ptr = PointerType(QualifiedType(ScalarType::SignedInt));
+  Type char_ptr = PointerType(QualifiedType(ScalarType::Char));
+
+  // Pointee constraints are compared by value.
+  TypeConstraints int_ptr1(int_ptr);
+  TypeConstraints int_ptr2(int_ptr);
+  TypeConstraints char_ptr1(char_ptr);
+
+  EXPECT_EQ(int_ptr1, int_ptr2);
+  EXPECT_EQ(std::hash<TypeConstraints>{}(int_ptr1),
+            std::hash<TypeConstraints>{}(int_ptr2));
+  EXPECT_NE(int_ptr1, char_ptr1);
+  EXPECT_EQ(TypeConstraints::all_in_bool_ctx(),
+            TypeConstraints::all_in_bool_ctx());
+  EXPECT_NE(TypeConstraints::all_in_bool_ctx(),
+            TypeConstraints::all_in_pointer_ctx());
+  EXPECT_NE(TypeConstraints(TaggedType("A")), TypeConstraints(TaggedType("B")));
+
+  ExprConstraints rvalue(int_ptr1);
+  ExprConstraints lvalue(int_ptr2, MemoryConstraints(), ExprCategory::Lvalue);
+  ExprConstraints valid(int_ptr2, MemoryConstraints(true, 1));
+
+  EXPECT_EQ(rvalue, ExprConstraints(int_ptr2));
+  EXPECT_EQ(std::hash<ExprConstraints>{}(rvalue),
+            std::hash<ExprConstraints>{}(ExprConstraints(int_ptr2)));
+  EXPECT_NE(rvalue, lvalue);
+  EXPECT_NE(rvalue, valid);
 }
-}  // namespace fuzzer
 
 TEST(Constraints, MemoryConstraints) {
   MemoryConstraints default_ctor;
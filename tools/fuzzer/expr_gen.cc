@@ -20,6 +20,7 @@
 #include <array>
 #include <cassert>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <random>
 #include <type_traits>
@@ -31,6 +32,8 @@
 #include "tools/fuzzer/ast.h"
 #include "tools/fuzzer/constraints.h"
 #include "tools/fuzzer/enum_bitset.h"
+#include "tools/fuzzer/pool_allocator.h"
+#include "tools/fuzzer/symbol_index.h"
 #include "tools/fuzzer/symbol_table.h"
 
 namespace fuzzer {
@@ -134,6 +137,17 @@ static std::optional<Expr> gen_from_options(
   return {};
 }
 
+ExprGenerator::ExprGenerator(std::unique_ptr<GeneratorRng> rng, GenConfig cfg,
+                             SymbolTable symtab)
+    : ExprGenerator(std::move(rng), std::move(cfg),
+                    std::make_shared<SymbolIndex>(std::move(symtab))) {}
+
+ExprGenerator::ExprGenerator(std::unique_ptr<GeneratorRng> rng, GenConfig cfg,
+                             std::shared_ptr<SymbolIndex> index)
+    : rng_(std::move(rng)), cfg_(std::move(cfg)), index_(std::move(index)) {
+  rng_->set_rng_callback([this](uint8_t byte) { on_consume_byte(byte); });
+}
+
 std::optional<Expr> ExprGenerator::gen_boolean_constant_impl(
     const ExprConstraints& constraints) {
   const auto& type_constraints = constraints.type_constraints();
@@ -206,13 +220,7 @@ std::optional<Expr> ExprGenerator::gen_enum_constant_impl(
     return {};
   }
 
-  std::vector<std::reference_wrapper<const EnumConstant>> enums;
-  for (const auto& [k, v] : symtab_.enums()) {
-    if (constraints.type_constraints().allows_type(k)) {
-      enums.insert(enums.end(), v.begin(), v.end());
-    }
-  }
-
+  const auto& enums = index_->enum_literals(constraints.type_constraints());
   if (enums.empty()) {
     return {};
   }
@@ -222,29 +230,7 @@ std::optional<Expr> ExprGenerator::gen_enum_constant_impl(
 
 std::optional<Expr> ExprGenerator::gen_variable_expr_impl(
     const ExprConstraints& constraints) {
-  const auto& type_constraints = constraints.type_constraints();
-  const auto& memory_constraints = constraints.memory_constraints();
-
-  std::vector<std::reference_wrapper<const VariableExpr>> vars;
-  for (const auto& [k, v] : symtab_.vars()) {
-    // Skip long double variables if long double isn't enabled.
-    if (!cfg_.long_double_enabled && k == Type(ScalarType::LongDouble)) {
-      continue;
-    }
-
-    if (type_constraints.allows_type(k)) {
-      for (const auto& var : v) {
-        if (var.expr.name() == "this" && constraints.must_be_lvalue()) {
-          // "this" is an rvalue.
-          continue;
-        }
-        if (var.freedom_index >= memory_constraints.required_freedom_index()) {
-          vars.emplace_back(var.expr);
-        }
-      }
-    }
-  }
-
+  const auto& vars = index_->vars(constraints, cfg_.long_double_enabled);
   if (vars.empty()) {
     return {};
   }
@@ -709,12 +695,7 @@ std::optional<Expr> ExprGenerator::gen_member_of_expr_impl(
     return {};
   }
 
-  std::vector<std::reference_wrapper<const Field>> fields;
-  for (const auto& [k, v] : symtab_.fields_by_type()) {
-    if (type_constraints.allows_type(k)) {
-      fields.insert(fields.end(), v.begin(), v.end());
-    }
-  }
+  const auto& fields = index_->fields(type_constraints);
 
   if (fields.empty()) {
     return {};
@@ -748,13 +729,7 @@ std::optional<Expr> ExprGenerator::gen_member_of_ptr_expr_impl(
     return {};
   }
 
-  std::vector<std::reference_wrapper<const Field>> fields;
-
-  for (const auto& [k, v] : symtab_.fields_by_type()) {
-    if (type_constraints.allows_type(k)) {
-      fields.insert(fields.end(), v.begin(), v.end());
-    }
-  }
+  const auto& fields = index_->fields(type_constraints);
 
   if (fields.empty()) {
     return {};
@@ -906,12 +881,7 @@ std::optional<Expr> ExprGenerator::gen_function_call_expr_impl(
 
   const auto& type_constraints = constraints.type_constraints();
 
-  std::vector<std::reference_wrapper<const Function>> functions;
-  for (const auto& [k, v] : symtab_.functions()) {
-    if (type_constraints.allows_type(k)) {
-      functions.insert(functions.end(), v.begin(), v.end());
-    }
-  }
+  const auto& functions = index_->functions(type_constraints);
 
   if (functions.empty()) {
     return {};
@@ -927,7 +897,7 @@ std::optional<Expr> ExprGenerator::gen_function_call_expr_impl(
     if (!maybe_expr.has_value()) {
       return {};
     }
-    args.emplace_back(std::make_shared<Expr>(std::move(maybe_expr.value())));
+    args.emplace_back(make_pooled<Expr>(std::move(maybe_expr.value())));
   }
 
   return FunctionCallExpr(function.name(), std::move(args));
@@ -990,7 +960,11 @@ std::optional<Expr> ExprGenerator::gen_with_weights_impl(
   Weights new_weights = weights;
   new_weights.increment_depth();
 
-  ExprKindMask mask = cfg_.expr_kind_mask;
+  // Kinds that can't satisfy the constraints for lack of symbols are never
+  // picked.
+  ExprKindMask mask =
+      cfg_.expr_kind_mask &
+      index_->viable_expr_kinds(constraints, cfg_.long_double_enabled);
   if (new_weights.depth() == cfg_.max_depth) {
     mask &= LEAF_EXPR_KINDS;
   }
@@ -1093,14 +1067,41 @@ std::optional<Expr> ExprGenerator::gen_with_weights_impl(
                           stack_.top()->children_);
 }
 
-std::optional<Expr> ExprGenerator::gen_expr(const GenerateExprFn& callback,
-                                            std::string name) {
-  auto node = std::make_shared<GenNode>(std::move(name), callback);
+// Generation node of a method, storing the callback (and thus the arguments)
+// needed to re-evaluate it.
+template <typename Fn>
+class GenNodeWithCallback : public GenNode {
+ public:
+  GenNodeWithCallback(std::string_view name, Fn callback)
+      : GenNode(name), callback_(std::move(callback)) {}
+
+ protected:
+  std::optional<Expr> generate(ExprGenerator* gen) const override {
+    return callback_(gen);
+  }
+
+  std::shared_ptr<GenNode> clone() const override {
+    return make_pooled<GenNodeWithCallback<Fn>>(name(), callback_);
+  }
+
+ private:
+  Fn callback_;
+};
+
+template <typename Fn>
+std::optional<Expr> ExprGenerator::gen_expr(Fn callback,
+                                            std::string_view name) {
+  return gen_from_node(
+      make_pooled<GenNodeWithCallback<Fn>>(name, std::move(callback)));
+}
+
+std::optional<Expr> ExprGenerator::gen_from_node(
+    std::shared_ptr<GenNode> node) {
   if (!stack_.empty()) {
     stack_.top()->children_.emplace_back(node);
   }
   stack_.push(node);
-  auto maybe_expr = callback(this);
+  auto maybe_expr = node->generate(this);
   node->valid_ = maybe_expr.has_value();
   stack_.pop();
   node_ = std::move(node);
@@ -1118,7 +1119,7 @@ void ExprGenerator::on_consume_byte(uint8_t byte) {
     auto callback = [weights, constraints](ExprGenerator* gen) {    \
       return gen->method##_impl(weights, constraints);              \
     };                                                              \
-    return gen_expr(callback, __FUNCTION__);                        \
+    return gen_expr(std::move(callback), __FUNCTION__);             \
   }
 
 #define DEFINE_GEN_METHOD_CONSTRAINTS(method)           \
@@ -1127,7 +1128,7 @@ void ExprGenerator::on_consume_byte(uint8_t byte) {
     auto callback = [constraints](ExprGenerator* gen) { \
       return gen->method##_impl(constraints);           \
     };                                                  \
-    return gen_expr(callback, __FUNCTION__);            \
+    return gen_expr(std::move(callback), __FUNCTION__); \
   }
 
 DEFINE_GEN_METHOD_CONSTRAINTS(gen_boolean_constant)
@@ -1290,23 +1291,14 @@ std::optional<Type> ExprGenerator::gen_tagged_type(
     return {};
   }
 
-  std::vector<std::reference_wrapper<const TaggedType>> tagged_types;
-
   const auto& allowed_types = constraints.allowed_tagged_types();
 
   const auto* tagged_type = std::get_if<TaggedType>(&allowed_types);
   if (tagged_type != nullptr) {
-    tagged_types.push_back(*tagged_type);
-  }
-
-  if (std::holds_alternative<AnyType>(allowed_types)) {
-    tagged_types.reserve(symtab_.tagged_types().size());
-    for (const auto& tagged_type : symtab_.tagged_types()) {
-      tagged_types.emplace_back(tagged_type);
-    }
+    return rng_->pick_tagged_type({*tagged_type});
   }
 
-  return rng_->pick_tagged_type(tagged_types);
+  return rng_->pick_tagged_type(index_->tagged_types());
 }
 
 std::optional<Type> ExprGenerator::gen_scalar_type(
@@ -1326,13 +1318,7 @@ std::optional<Type> ExprGenerator::gen_scalar_type(
 
 std::optional<Type> ExprGenerator::gen_enum_type(
     const TypeConstraints& constraints) {
-  std::vector<std::reference_wrapper<const EnumType>> enum_types;
-  for (const auto& [enum_type, _] : symtab_.enums()) {
-    if (constraints.allows_type(enum_type)) {
-      enum_types.emplace_back(enum_type);
-    }
-  }
-
+  const auto& enum_types = index_->enum_types(constraints);
   if (enum_types.empty()) {
     return {};
   }
@@ -1345,13 +1331,7 @@ std::optional<Type> ExprGenerator::gen_array_type(
   // Instead of constructing a random array type, we rely on set of
   // array types from symbol table. This will increase chances to match
   // variables of array types.
-  std::vector<std::reference_wrapper<const ArrayType>> array_types;
-  for (const auto& type : symtab_.array_types()) {
-    if (constraints.allows_type(type)) {
-      array_types.emplace_back(type);
-    }
-  }
-
+  const auto& array_types = index_->array_types(constraints);
   if (array_types.empty()) {
     return {};
   }
@@ -1391,16 +1371,17 @@ bool ExprGenerator::mutate_gen_node(std::shared_ptr<GenNode>& node) {
     return false;
   }
 
-  auto maybe_expr = gen_expr(node->callback_, node->name());
+  // Re-evaluate a childless copy of the method, which doesn't refer to the
+  // original node and thus to the old subtree.
+  auto maybe_expr = gen_from_node(node->clone());
   if (!maybe_expr.has_value()) {
     return false;
   }
 
-  // The mutated node is stored in `node_`.
-  auto mutated_node = node_;
-  assert(mutated_node->is_valid() && "The mutated node should be valid!");
-
-  node->children_ = std::move(mutated_node->children_);
+  // The copy is stored in `node_`. Its children replace the old subtree, which
+  // is released. The original node stays in the tree.
+  assert(node_->is_valid() && "The mutated node should be valid!");
+  node->children_ = std::move(node_->children_);
   return true;
 }
 
@@ -23,6 +23,7 @@
 #include <optional>
 #include <random>
 #include <stack>
+#include <string_view>
 #include <unordered_map>
 
 #include "tools/fuzzer/ast.h"
@@ -292,13 +293,17 @@ class DefaultGeneratorRng : public GeneratorRng {
   LibfuzzerWriter writer_;
 };
 
+class SymbolIndex;
+
 class ExprGenerator {
  public:
   ExprGenerator(std::unique_ptr<GeneratorRng> rng, GenConfig cfg,
-                SymbolTable symtab)
-      : rng_(std::move(rng)), cfg_(std::move(cfg)), symtab_(std::move(symtab)) {
-    rng_->set_rng_callback([this](uint8_t byte) { on_consume_byte(byte); });
-  }
+                SymbolTable symtab);
+
+  // Uses a symbol index shared with other generators, so that symbol lookups
+  // memoized by one generator are reused by others.
+  ExprGenerator(std::unique_ptr<GeneratorRng> rng, GenConfig cfg,
+                std::shared_ptr<SymbolIndex> index);
 
   // Copying and moving isn't possible right now.
   // TODO: Implement copy/move constructors/assignments if needed.
@@ -390,9 +395,14 @@ class ExprGenerator {
                                             const ExprConstraints& constraints);
 
   // Generates an expression using the `callback` method and constructs a
-  // generation node on top of the `stack_`.
-  std::optional<Expr> gen_expr(const GenerateExprFn& callback,
-                               std::string name);
+  // generation node on top of the `stack_`. The callback is stored in the
+  // node for re-evaluating the method.
+  template <typename Fn>
+  std::optional<Expr> gen_expr(Fn callback, std::string_view name);
+
+  // Generates an expression by evaluating the method of the childless `node`,
+  // which is added on top of the `stack_` and stored in `node_`.
+  std::optional<Expr> gen_from_node(std::shared_ptr<GenNode> node);
 
   std::optional<Type> gen_type(const Weights& weights,
                                const TypeConstraints& constraints,
@@ -415,7 +425,7 @@ class ExprGenerator {
  private:
   std::unique_ptr<GeneratorRng> rng_;
   GenConfig cfg_;
-  SymbolTable symtab_;
+  std::shared_ptr<SymbolIndex> index_;
 
   std::stack<std::shared_ptr<GenNode>> stack_;
   std::shared_ptr<GenNode> node_;
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Throughput benchmark on a corpus of expressions generated by the fuzzer.
+// Every expression of the corpus is evaluated by both lldb-eval and LLDB, the
+// latency distribution (p50/p90/p99/max) and the throughput are reported per
+// expression kind. The corpus is fully determined by the seed, the number of
+// expressions and the maximum depth, so the results are reproducible.
+//
+// With --regression_corpus the benchmark also replays every expression saved
+// by the performance fuzzer (see lldb_eval_perf_libfuzzer_test.cc) as a
+// separate benchmark.
+//
+// Usage:
+//   fuzzer_benchmark [--seed <rng_seed>] [--num_exprs <n>] [--max_depth <d>]
+//                    [--regression_corpus <dir>] [<benchmark flags>]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lldb-eval/api.h"
+#include "lldb-eval/runner.h"
+#include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBExpressionOptions.h"
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBProcess.h"
+#include "lldb/API/SBThread.h"
+#include "lldb/API/SBValue.h"
+#include "tools/cpp/runfiles/runfiles.h"
+#include "tools/fuzzer/ast.h"
+#include "tools/fuzzer/expr_gen.h"
+#include "tools/fuzzer/symbol_table.h"
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+static constexpr char SOURCE_PATH_KEY[] = "lldb_eval/testdata/fuzzer_binary.cc";
+static constexpr char BINARY_PATH_KEY[] = "lldb_eval/testdata/fuzzer_binary";
+
+// Give up if the generator fails to produce enough valid expressions of some
+// kind after this many attempts per expression.
+static constexpr int MAX_ATTEMPTS_PER_EXPR = 50;
+
+enum class CorpusKind {
+  All,
+  MemberAccess,
+  ArrayIndex,
+  Cast,
+  PointerArithmetic,
+  Ternary,
+  Arithmetic,
+  Other,
+};
+static constexpr size_t NUM_CORPUS_KINDS = (size_t)CorpusKind::Other + 1;
+
+static const char* corpus_kind_name(CorpusKind kind) {
+  switch (kind) {
+    case CorpusKind::All:
+      return "all";
+    case CorpusKind::MemberAccess:
+      return "member_access";
+    case CorpusKind::ArrayIndex:
+      return "array_index";
+    case CorpusKind::Cast:
+      return "cast";
+    case CorpusKind::PointerArithmetic:
+      return "pointer_arithmetic";
+    case CorpusKind::Ternary:
+      return "ternary";
+    case CorpusKind::Arithmetic:
+      return "arithmetic";
+    case CorpusKind::Other:
+      return "other";
+  }
+  return "unknown";
+}
+
+// Classifies the expression by its outermost operation. `result` is the value
+// of the expression, used to tell pointer arithmetic from other arithmetic.
+static CorpusKind classify_expr(const fuzzer::Expr& expr,
+                                lldb::SBValue result) {
+  const fuzzer::Expr* root = &expr;
+  while (const auto* parens = std::get_if<fuzzer::ParenthesizedExpr>(root)) {
+    root = &parens->expr();
+  }
+
+  if (std::holds_alternative<fuzzer::MemberOf>(*root) ||
+      std::holds_alternative<fuzzer::MemberOfPtr>(*root)) {
+    return CorpusKind::MemberAccess;
+  }
+  if (std::holds_alternative<fuzzer::ArrayIndex>(*root)) {
+    return CorpusKind::ArrayIndex;
+  }
+  if (std::holds_alternative<fuzzer::CastExpr>(*root)) {
+    return CorpusKind::Cast;
+  }
+  if (std::holds_alternative<fuzzer::TernaryExpr>(*root)) {
+    return CorpusKind::Ternary;
+  }
+  if (const auto* binary = std::get_if<fuzzer::BinaryExpr>(root)) {
+    bool is_additive = binary->op() == fuzzer::BinOp::Plus ||
+                       binary->op() == fuzzer::BinOp::Minus;
+    if (is_additive && result.GetType().IsPointerType()) {
+      return CorpusKind::PointerArithmetic;
+    }
+    return CorpusKind::Arithmetic;
+  }
+  if (std::holds_alternative<fuzzer::UnaryExpr>(*root)) {
+    return CorpusKind::Arithmetic;
+  }
+  return CorpusKind::Other;
+}
+
+lldb::SBValue evaluate_expression_lldb(lldb::SBFrame frame,
+                                       const std::string& expr) {
+  // Disable auto fix-its in LLDB evaluations.
+  lldb::SBExpressionOptions options;
+  options.SetAutoApplyFixIts(false);
+  return frame.EvaluateExpression(expr.c_str(), options);
+}
+
+lldb::SBValue evaluate_expression_lldb_eval(lldb::SBFrame frame,
+                                            const std::string& expr,
+                                            lldb::SBError& error) {
+  return lldb_eval::EvaluateExpression(frame, expr.c_str(), error);
+}
+
+using Corpus = std::array<std::vector<std::string>, NUM_CORPUS_KINDS>;
+
+// Generates up to `num_exprs` expressions of each kind. Only the expressions
+// successfully evaluated by both lldb-eval and LLDB end up in the corpus.
+Corpus gen_corpus(lldb::SBFrame frame, unsigned seed, int num_exprs,
+                  int max_depth) {
+  auto rng = std::make_unique<fuzzer::DefaultGeneratorRng>(seed);
+  auto cfg = fuzzer::GenConfig();
+  cfg.max_depth = max_depth;
+  // Same as the fuzzer: disable shifts, they often lead to undefined behaviour.
+  cfg.bin_op_mask[fuzzer::BinOp::Shl] = false;
+  cfg.bin_op_mask[fuzzer::BinOp::Shr] = false;
+
+  auto symtab = fuzzer::SymbolTable::create_from_frame(
+      frame, /*ignore_qualified_types*/ !cfg.cv_qualifiers_enabled);
+  symtab.add_function(fuzzer::ScalarType::UnsignedInt, "__log2",
+                      {fuzzer::ScalarType::UnsignedInt});
+
+  fuzzer::ExprGenerator gen(std::move(rng), std::move(cfg), std::move(symtab));
+
+  Corpus corpus;
+  for (int i = 0; i < num_exprs * MAX_ATTEMPTS_PER_EXPR; i++) {
+    auto maybe_gen_expr = gen.generate();
+    if (!maybe_gen_expr.has_value()) {
+      continue;
+    }
+    const auto& gen_expr = maybe_gen_expr.value();
+
+    std::ostringstream os;
+    os << gen_expr;
+    std::string expr = os.str();
+
+    lldb::SBError error;
+    lldb::SBValue value = evaluate_expression_lldb_eval(frame, expr, error);
+    if (error.Fail() ||
+        evaluate_expression_lldb(frame, expr).GetError().Fail()) {
+      continue;
+    }
+
+    auto& all = corpus[(size_t)CorpusKind::All];
+    auto& exprs = corpus[(size_t)classify_expr(gen_expr, value)];
+    if ((int)exprs.size() < num_exprs) {
+      exprs.push_back(expr);
+      if ((int)all.size() < num_exprs) {
+        all.push_back(expr);
+      }
+    }
+
+    bool is_complete = std::all_of(
+        corpus.begin(), corpus.end(),
+        [num_exprs](const auto& v) { return (int)v.size() >= num_exprs; });
+    if (is_complete) {
+      break;
+    }
+  }
+  return corpus;
+}
+
+// Evaluates the expressions of the corpus one by one in a loop and reports the
+// latency percentiles (in microseconds) and the throughput.
+template <typename EvaluateFn>
+void run_corpus(benchmark::State& state, const std::vector<std::string>& exprs,
+                EvaluateFn evaluate) {
+  std::vector<double> latencies;
+  size_t next = 0;
+
+  for (auto _ : state) {
+    const std::string& expr = exprs[next];
+    next = (next + 1) % exprs.size();
+
+    auto start = std::chrono::steady_clock::now();
+    benchmark::DoNotOptimize(evaluate(expr));
+    auto end = std::chrono::steady_clock::now();
+
+    latencies.push_back(
+        std::chrono::duration<double, std::micro>(end - start).count());
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (latencies.empty()) {
+    return;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+  };
+  state.counters["p50_us"] = percentile(0.5);
+  state.counters["p90_us"] = percentile(0.9);
+  state.counters["p99_us"] = percentile(0.99);
+  state.counters["max_us"] = latencies.back();
+  state.counters["corpus_size"] = static_cast<double>(exprs.size());
+}
+
+void register_benchmarks(lldb::SBFrame frame, const Corpus& corpus) {
+  for (size_t i = 0; i < NUM_CORPUS_KINDS; i++) {
+    const auto& exprs = corpus[i];
+    const char* kind = corpus_kind_name((CorpusKind)i);
+    if (exprs.empty()) {
+      fprintf(stderr, "Warning: No expressions of kind `%s` generated\n",
+              kind);
+      continue;
+    }
+
+    std::string lldb_eval_name = std::string("lldb_eval/") + kind;
+    benchmark::RegisterBenchmark(
+        lldb_eval_name.c_str(), [frame, &exprs](benchmark::State& state) {
+          run_corpus(state, exprs, [&frame](const std::string& expr) {
+            lldb::SBError error;
+            return evaluate_expression_lldb_eval(frame, expr, error);
+          });
+        });
+
+    std::string lldb_name = std::string("lldb/") + kind;
+    benchmark::RegisterBenchmark(
+        lldb_name.c_str(), [frame, &exprs](benchmark::State& state) {
+          run_corpus(state, exprs, [&frame](const std::string& expr) {
+            return evaluate_expression_lldb(frame, expr);
+          });
+        });
+  }
+}
+
+// Registers a benchmark for every expression in the regression corpus. Each
+// file of the corpus contains a single expression.
+void register_regression_benchmarks(lldb::SBFrame frame,
+                                    const std::string& corpus_dir,
+                                    std::vector<std::string>& exprs) {
+  std::vector<std::filesystem::path> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(corpus_dir)) {
+    if (entry.is_regular_file()) {
+      paths.push_back(entry.path());
+    }
+  }
+  // Keep the order stable between the runs.
+  std::sort(paths.begin(), paths.end());
+
+  exprs.reserve(paths.size());
+  for (const auto& path : paths) {
+    std::ifstream file(path);
+    std::string expr;
+    if (!std::getline(file, expr) || expr.empty()) {
+      continue;
+    }
+    exprs.push_back(expr);
+    const std::string& stored_expr = exprs.back();
+
+    std::string name = "lldb_eval/regression/" + path.stem().string();
+    benchmark::RegisterBenchmark(
+        name.c_str(), [frame, &stored_expr](benchmark::State& state) {
+          for (auto _ : state) {
+            lldb::SBError error;
+            benchmark::DoNotOptimize(
+                evaluate_expression_lldb_eval(frame, stored_expr, error));
+          }
+          state.SetLabel(stored_expr);
+        });
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string err;
+  std::unique_ptr<Runfiles> runfiles(Runfiles::Create(argv[0], &err));
+  if (runfiles == nullptr) {
+    fprintf(stderr, "Could not launch the benchmark: %s\n", err.c_str());
+    return 1;
+  }
+
+  unsigned seed = 0;
+  int num_exprs = 100;
+  int max_depth = 4;
+  std::string regression_corpus;
+
+  // Consume the own flags, pass the rest to Google Benchmark.
+  std::vector<char*> benchmark_argv = {argv[0]};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seed") == 0 && i < argc - 1) {
+      seed = std::stoul(argv[++i]);
+    } else if (strcmp(argv[i], "--num_exprs") == 0 && i < argc - 1) {
+      num_exprs = std::stoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max_depth") == 0 && i < argc - 1) {
+      max_depth = std::stoi(argv[++i]);
+    } else if (strcmp(argv[i], "--regression_corpus") == 0 && i < argc - 1) {
+      regression_corpus = argv[++i];
+    } else {
+      benchmark_argv.push_back(argv[i]);
+    }
+  }
+  int benchmark_argc = static_cast<int>(benchmark_argv.size());
+
+  lldb_eval::SetupLLDBServerEnv(*runfiles);
+
+  auto source_path = runfiles->Rlocation(SOURCE_PATH_KEY);
+  auto binary_path = runfiles->Rlocation(BINARY_PATH_KEY);
+
+  lldb::SBDebugger::Initialize();
+  {
+    auto debugger = lldb::SBDebugger::Create();
+    auto proc = lldb_eval::LaunchTestProgram(debugger, source_path, binary_path,
+                                             "// BREAK HERE");
+    auto frame = proc.GetSelectedThread().GetSelectedFrame();
+
+    printf("==== Seed: %u, expressions per kind: %d, max depth: %d ====\n",
+           seed, num_exprs, max_depth);
+    Corpus corpus = gen_corpus(frame, seed, num_exprs, max_depth);
+    register_benchmarks(frame, corpus);
+
+    // Must outlive the benchmarks, which refer to the expressions.
+    std::vector<std::string> regression_exprs;
+    if (!regression_corpus.empty()) {
+      register_regression_benchmarks(frame, regression_corpus,
+                                     regression_exprs);
+    }
+
+    benchmark::Initialize(&benchmark_argc, benchmark_argv.data());
+    if (benchmark::ReportUnrecognizedArguments(benchmark_argc,
+                                               benchmark_argv.data())) {
+      proc.Destroy();
+      lldb::SBDebugger::Terminate();
+      return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+
+    proc.Destroy();
+  }
+  lldb::SBDebugger::Terminate();
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks of the expression generator alone, without LLDB. The symbol table
+// is synthetic and its size is given by the benchmark argument. The reported
+// `items_per_second` is the number of generated (or mutated) expressions per
+// second.
+
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "tools/fuzzer/ast.h"
+#include "tools/fuzzer/expr_gen.h"
+#include "tools/fuzzer/fixed_rng.h"
+#include "tools/fuzzer/gen_node.h"
+#include "tools/fuzzer/libfuzzer_utils.h"
+#include "tools/fuzzer/symbol_index.h"
+#include "tools/fuzzer/symbol_table.h"
+
+namespace {
+
+using namespace fuzzer;
+
+// Same as in libfuzzer_common.cc.
+constexpr int MAX_DEPTH = 12;
+
+// Creates a symbol table resembling the fuzzer binary, with `num_groups`
+// copies of each kind of symbol.
+SymbolTable create_symtab(int num_groups) {
+  SymbolTable symtab;
+  for (int i = 0; i < num_groups; i++) {
+    std::string suffix = "_" + std::to_string(i);
+
+    Type int_type = ScalarType::SignedInt;
+    Type int_ptr_type = PointerType(QualifiedType(int_type));
+    TaggedType struct_type("Struct" + suffix);
+    Type struct_ptr_type = PointerType(QualifiedType(struct_type));
+    EnumType enum_type("Enum" + suffix, /*scoped*/ i % 2 == 0);
+
+    symtab.add_var(int_type, VariableExpr("int" + suffix));
+    symtab.add_var(ScalarType::Double, VariableExpr("double" + suffix));
+    symtab.add_var(ScalarType::UnsignedChar, VariableExpr("uchar" + suffix));
+    symtab.add_var(int_ptr_type, VariableExpr("int_ptr" + suffix), 1);
+    symtab.add_var(struct_type, VariableExpr("struct" + suffix));
+    symtab.add_var(struct_ptr_type, VariableExpr("struct_ptr" + suffix), 1);
+    symtab.add_var(ArrayType(int_type, 4), VariableExpr("array" + suffix));
+    symtab.add_var(enum_type, VariableExpr("enum" + suffix));
+
+    symtab.add_field(struct_type, "int_field", int_type, false);
+    symtab.add_field(struct_type, "ptr_field", int_ptr_type, false);
+    symtab.add_field(struct_type, "ref_field", int_type, true);
+
+    symtab.add_enum_literal(enum_type, "kFirst");
+    symtab.add_enum_literal(enum_type, "kSecond");
+  }
+  symtab.add_function(ScalarType::UnsignedInt, "__log2",
+                      {ScalarType::UnsignedInt});
+  return symtab;
+}
+
+GenConfig create_config() {
+  GenConfig cfg;
+  cfg.max_depth = MAX_DEPTH;
+  return cfg;
+}
+
+class GenNodePicker : public GenTreeVisitor {
+ public:
+  void visit_node(std::shared_ptr<GenNode> node) override {
+    if (node->is_valid()) {
+      options_.emplace_back(node);
+    }
+  }
+
+  std::shared_ptr<GenNode> pick(std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> distr(0, options_.size() - 1);
+    return options_[distr(rng)];
+  }
+
+ private:
+  std::vector<std::shared_ptr<GenNode>> options_;
+};
+
+class GenNodeWriter : public GenTreeVisitor {
+ public:
+  void visit_byte(uint8_t byte) override { bytes_.push_back(byte); }
+
+  std::vector<uint8_t>& bytes() { return bytes_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+};
+
+void BM_Generate(benchmark::State& state) {
+  SymbolTable symtab = create_symtab(state.range(0));
+  ExprGenerator gen(std::make_unique<DefaultGeneratorRng>(1337),
+                    create_config(), symtab);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(gen.generate());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Generate)->ArgName("groups")->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+// Same steps as `LibfuzzerState::custom_mutate` followed by
+// `LibfuzzerState::input_to_expr`: mutate a random node of the generation
+// tree, serialize the tree and regenerate the expression from the bytes.
+void BM_Mutate(benchmark::State& state) {
+  auto index = std::make_shared<SymbolIndex>(create_symtab(state.range(0)));
+  GenConfig cfg = create_config();
+  ExprGenerator random_generator(std::make_unique<DefaultGeneratorRng>(1337),
+                                 cfg, index);
+
+  std::optional<Expr> maybe_expr;
+  do {
+    maybe_expr = random_generator.generate();
+  } while (!maybe_expr.has_value());
+  std::shared_ptr<GenNode> root = random_generator.node();
+
+  std::mt19937 rng(12345);
+  for (auto _ : state) {
+    GenNodePicker picker;
+    walk_gen_tree(root, &picker);
+    auto node = picker.pick(rng);
+    random_generator.mutate_gen_node(node);
+
+    GenNodeWriter writer;
+    walk_gen_tree(root, &writer);
+    auto& bytes = writer.bytes();
+    ExprGenerator fixed_generator(
+        std::make_unique<FixedGeneratorRng>(bytes.data(), bytes.size()), cfg,
+        index);
+    benchmark::DoNotOptimize(fixed_generator.generate());
+
+    // Continue with the regenerated tree, as libFuzzer does.
+    root = fixed_generator.node();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Mutate)->ArgName("groups")->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+}  // namespace
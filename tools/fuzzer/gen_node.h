@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <optional>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -31,20 +32,24 @@ class GenNode;
 class ExprGenerator;
 
 using GenNodeOrByte = std::variant<std::shared_ptr<GenNode>, uint8_t>;
-using GenerateExprFn = std::function<std::optional<Expr>(ExprGenerator*)>;
 
 // A node that represents one expression generation method of `ExprGenerator`
 // class (e.g. `gen_integer_constant`, `gen_binary_expr`, `gen_with_weights`,
 // etc.) with context necessary to re-evaluate the method. A tree formed of
 // these nodes represents a call hierarchy starting from the root method.
+//
+// The context (i.e. the arguments of the method) is stored by the subclass
+// created in `ExprGenerator::gen_expr`, so that a node, its context and its
+// reference count live in a single pooled allocation (see pool_allocator.h).
 class GenNode {
  public:
-  GenNode(std::string name, GenerateExprFn callback)
-      : name_(std::move(name)), callback_(std::move(callback)) {}
+  // `name` must refer to a string with static storage duration.
+  explicit GenNode(std::string_view name) : name_(name) {}
+  virtual ~GenNode() = default;
 
-  // Name of the method (e.g. "fuzzer::ExprGenerator::gen_binary_expr").
-  // Useful for testing and debugging.
-  const std::string& name() const { return name_; }
+  // Name of the method (e.g. "gen_binary_expr"). Useful for testing and
+  // debugging.
+  std::string_view name() const { return name_; }
 
   // List of children. A child is either another method generation node or a
   // byte representing a part of serialized format.
@@ -53,11 +58,18 @@ class GenNode {
   // Does the method result with a valid expression or a `std::nullopt`?
   bool is_valid() const { return valid_; }
 
+ protected:
+  // Re-evaluates the method with the stored context.
+  virtual std::optional<Expr> generate(ExprGenerator* gen) const = 0;
+
+  // Creates a node of the same method with the same context, but without
+  // children.
+  virtual std::shared_ptr<GenNode> clone() const = 0;
+
  private:
   friend class ExprGenerator;
 
-  std::string name_;
-  GenerateExprFn callback_;  // Callback for re-evaluating the method.
+  std::string_view name_;
   bool valid_ = false;
   std::vector<GenNodeOrByte> children_;
 };
@@ -1,12 +1,19 @@
 #include "tools/fuzzer/libfuzzer_common.h"
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <utility>
 
+#include "lldb-eval/api.h"
 #include "lldb-eval/runner.h"
 #include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBError.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBProcess.h"
 #include "lldb/API/SBTarget.h"
@@ -16,14 +23,33 @@
 #include "tools/fuzzer/expr_gen.h"
 #include "tools/fuzzer/fixed_rng.h"
 #include "tools/fuzzer/gen_node.h"
+#include "tools/fuzzer/symbol_index.h"
 #include "tools/fuzzer/symbol_table.h"
 
+#ifndef _WIN32
+// Provided by the sanitizer runtimes (see <sanitizer/allocator_interface.h>).
+// Declared weak, so that the fuzzer can be built without a sanitizer too.
+extern "C" __attribute__((weak)) int __sanitizer_install_malloc_and_free_hooks(
+    void (*malloc_hook)(const volatile void*, size_t),
+    void (*free_hook)(const volatile void*));
+#endif
+
 namespace fuzzer {
 
 using bazel::tools::cpp::runfiles::Runfiles;
 
 namespace {
 
+std::atomic<uint64_t> g_num_allocations{0};
+
+#ifndef _WIN32
+void count_malloc(const volatile void*, size_t) {
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ignore_free(const volatile void*) {}
+#endif
+
 class GenNodePicker : public GenTreeVisitor {
  public:
   void visit_node(std::shared_ptr<GenNode> node) {
@@ -52,12 +78,12 @@ class GenNodeWriter : public GenTreeVisitor {
   ByteWriter& writer_;
 };
 
-ExprGenerator create_generator(SymbolTable symtab,
+ExprGenerator create_generator(std::shared_ptr<SymbolIndex> symbol_index,
                                std::unique_ptr<GeneratorRng> rng) {
   auto cfg = GenConfig();
   cfg.max_depth = 12;
 
-  return ExprGenerator(std::move(rng), cfg, symtab);
+  return ExprGenerator(std::move(rng), cfg, std::move(symbol_index));
 }
 
 template <class Rng>
@@ -73,9 +99,44 @@ void write_node(std::shared_ptr<GenNode> root, ByteWriter& writer) {
   walk_gen_tree(root, &node_writer);
 }
 
+// Returns the value of the last `<flag><value>` argument, e.g. of
+// `--symtab_cache=<dir>` for the `flag` "--symtab_cache=".
+std::string flag_value(int argc, char** argv, const char* flag) {
+  std::string value;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], flag, strlen(flag)) == 0) {
+      value = argv[i] + strlen(flag);
+    }
+  }
+  return value;
+}
+
 }  // namespace
 
-int LibfuzzerState::init(int* /*argc*/, char*** argv) {
+std::string EvalBudget::check(const EvalCost& cost) const {
+  std::ostringstream os;
+  if (time_us > 0 && cost.time_us > time_us) {
+    os << "time: " << cost.time_us << "us > " << time_us << "us; ";
+  }
+  if (sb_api_calls > 0 && cost.sb_api_calls > sb_api_calls) {
+    os << "SB API calls: " << cost.sb_api_calls << " > " << sb_api_calls
+       << "; ";
+  }
+  if (memory_reads > 0 && cost.memory_reads > memory_reads) {
+    os << "memory reads: " << cost.memory_reads << " > " << memory_reads
+       << "; ";
+  }
+  if (allocations > 0 && cost.allocations > allocations) {
+    os << "allocations: " << cost.allocations << " > " << allocations << "; ";
+  }
+  return os.str();
+}
+
+int LibfuzzerState::init(int* argc, char*** argv, bool perf_mode) {
+  std::string symtab_cache = flag_value(*argc, *argv, "--symtab_cache=");
+  std::string reference_cache =
+      flag_value(*argc, *argv, "--reference_cache=");
+
   std::string err;
   std::unique_ptr<Runfiles> runfiles(Runfiles::Create((*argv)[0], &err));
   if (runfiles == nullptr) {
@@ -89,20 +150,51 @@ int LibfuzzerState::init(int* /*argc*/, char*** argv) {
   auto binary_path = runfiles->Rlocation("lldb_eval/testdata/fuzzer_binary");
   auto source_path = runfiles->Rlocation("lldb_eval/testdata/fuzzer_binary.cc");
 
-  debugger_ = lldb::SBDebugger::Create(false);
+  perf_mode_ = perf_mode;
+  if (perf_mode_) {
+    debugger_ = lldb::SBDebugger::Create(false, log_callback, this);
+  } else {
+    debugger_ = lldb::SBDebugger::Create(false);
+  }
 
   lldb::SBProcess process = lldb_eval::LaunchTestProgram(
       debugger_, source_path, binary_path, "// BREAK HERE");
 
+  if (perf_mode_) {
+    // Every memory read should reach the debuggee to be counted.
+    debugger_.HandleCommand(
+        "settings set target.process.disable-memory-cache true");
+
+    // Enable logging after the launch, there's no point in counting the
+    // packets sent while launching the process.
+    const char* api_categories[] = {"api", nullptr};
+    const char* packets_categories[] = {"packets", nullptr};
+    debugger_.EnableLog("lldb", api_categories);
+    debugger_.EnableLog("gdb-remote", packets_categories);
+
+#ifndef _WIN32
+    if (__sanitizer_install_malloc_and_free_hooks) {
+      __sanitizer_install_malloc_and_free_hooks(count_malloc, ignore_free);
+    }
+#endif
+  }
+
   target_ = process.GetTarget();
   frame_ = process.GetSelectedThread().GetSelectedFrame();
 
-  symtab_ = fuzzer::SymbolTable::create_from_frame(
-      frame_, /*ignore_qualified_types*/ true);
+  auto symtab = symtab_cache.empty()
+                    ? fuzzer::SymbolTable::create_from_frame(
+                          frame_, /*ignore_qualified_types*/ true)
+                    : fuzzer::SymbolTable::create_from_frame_cached(
+                          frame_, symtab_cache,
+                          /*ignore_qualified_types*/ true);
 
   // Add lldb-eval functions.
-  symtab_.add_function(ScalarType::UnsignedInt, "__log2",
-                       {ScalarType::UnsignedInt});
+  symtab.add_function(ScalarType::UnsignedInt, "__log2",
+                      {ScalarType::UnsignedInt});
+
+  symbol_index_ = std::make_shared<SymbolIndex>(std::move(symtab));
+  reference_cache_ = std::make_unique<ReferenceCache>(frame_, reference_cache);
 
   return 0;
 }
@@ -110,7 +202,7 @@ int LibfuzzerState::init(int* /*argc*/, char*** argv) {
 size_t LibfuzzerState::custom_mutate(uint8_t* data, size_t size,
                                      size_t max_size, unsigned int seed) {
   auto fixed_rng = std::make_unique<FixedGeneratorRng>(data, size);
-  auto fixed_generator = create_generator(symtab_, std::move(fixed_rng));
+  auto fixed_generator = create_generator(symbol_index_, std::move(fixed_rng));
 
   auto maybe_expr = fixed_generator.generate();
   assert(maybe_expr.has_value() && "Expression could not be generated!");
@@ -119,8 +211,8 @@ size_t LibfuzzerState::custom_mutate(uint8_t* data, size_t size,
   auto root = fixed_generator.node();
   auto mutable_node = pick_random_node(root, rng);
 
-  auto random_generator =
-      create_generator(symtab_, std::make_unique<DefaultGeneratorRng>(rng()));
+  auto random_generator = create_generator(
+      symbol_index_, std::make_unique<DefaultGeneratorRng>(rng()));
   if (!random_generator.mutate_gen_node(mutable_node)) {
     return size;
   }
@@ -139,7 +231,7 @@ size_t LibfuzzerState::custom_mutate(uint8_t* data, size_t size,
 
 std::string LibfuzzerState::input_to_expr(const uint8_t* data, size_t size) {
   auto rng = std::make_unique<FixedGeneratorRng>(data, size);
-  auto generator = create_generator(symtab_, std::move(rng));
+  auto generator = create_generator(symbol_index_, std::move(rng));
   auto maybe_expr = generator.generate();
 
   assert(maybe_expr.has_value() && "Expression could not be generated!");
@@ -149,4 +241,46 @@ std::string LibfuzzerState::input_to_expr(const uint8_t* data, size_t size) {
   return os.str();
 }
 
+EvalCost LibfuzzerState::evaluate_with_cost(const std::string& expr,
+                                            lldb::SBError& error) {
+  uint64_t sb_api_calls = sb_api_calls_.load(std::memory_order_relaxed);
+  uint64_t memory_reads = memory_reads_.load(std::memory_order_relaxed);
+  uint64_t allocations = g_num_allocations.load(std::memory_order_relaxed);
+  auto start = std::chrono::steady_clock::now();
+
+  lldb_eval::EvaluateExpression(frame_, expr.c_str(), error);
+
+  auto end = std::chrono::steady_clock::now();
+
+  EvalCost cost;
+  cost.time_us = std::chrono::duration<double, std::micro>(end - start).count();
+  cost.sb_api_calls =
+      sb_api_calls_.load(std::memory_order_relaxed) - sb_api_calls;
+  cost.memory_reads =
+      memory_reads_.load(std::memory_order_relaxed) - memory_reads;
+  cost.allocations =
+      g_num_allocations.load(std::memory_order_relaxed) - allocations;
+  return cost;
+}
+
+void LibfuzzerState::log_callback(const char* message, void* baton) {
+  auto* state = static_cast<LibfuzzerState*>(baton);
+
+  // Packets sent to the lldb-server look like "send packet: $m<addr>,<size>"
+  // (or "$x" for the binary version of the memory read).
+  const char* packet = strstr(message, "send packet: $");
+  if (packet != nullptr) {
+    char command = packet[strlen("send packet: $")];
+    if (command == 'm' || command == 'x') {
+      state->memory_reads_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  // Every SB API call is logged with the pretty name of the method.
+  if (strstr(message, "lldb::SB") != nullptr) {
+    state->sb_api_calls_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
 }  // namespace fuzzer
@@ -1,23 +1,57 @@
 #ifndef INCLUDE_LIBFUZZER_COMMON_H
 #define INCLUDE_LIBFUZZER_COMMON_H
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 
 #include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBError.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBTarget.h"
-#include "tools/fuzzer/symbol_table.h"
+#include "tools/fuzzer/reference_cache.h"
+#include "tools/fuzzer/symbol_index.h"
 
 namespace fuzzer {
 
+// Resources used by a single evaluation, measured in the performance mode.
+struct EvalCost {
+  double time_us = 0;
+  uint64_t sb_api_calls = 0;
+  // Memory reads that reached the debuggee (the LLDB memory cache is disabled
+  // in the performance mode).
+  uint64_t memory_reads = 0;
+  // Only counted when built with a sanitizer, otherwise always zero.
+  uint64_t allocations = 0;
+};
+
+// Limits for a single evaluation, zero means no limit.
+struct EvalBudget {
+  double time_us = 0;
+  uint64_t sb_api_calls = 0;
+  uint64_t memory_reads = 0;
+  uint64_t allocations = 0;
+
+  // Returns a human readable description of the exceeded limits, or an empty
+  // string if `cost` fits into the budget.
+  std::string check(const EvalCost& cost) const;
+};
+
 class LibfuzzerState {
  public:
   LibfuzzerState() = default;
   ~LibfuzzerState() {}
 
-  int init(int* argc, char*** argv);
+  // Launches the fuzzer binary. In the performance mode LLDB logs SB API calls
+  // and gdb-remote packets, which are counted by `evaluate_with_cost`. This
+  // slows down all evaluations, including the measured ones.
+  // If `--symtab_cache=<dir>` is passed (after the libFuzzer flags), the
+  // symbol table is loaded from a snapshot in `<dir>` instead of being
+  // collected from the stopped binary. If `--reference_cache=<dir>` is
+  // passed, the results of `evaluate_lldb` are persisted in `<dir>`.
+  int init(int* argc, char*** argv, bool perf_mode = false);
 
   size_t custom_mutate(uint8_t* data, size_t size, size_t max_size,
                        unsigned int seed);
@@ -28,11 +62,29 @@ class LibfuzzerState {
 
   lldb::SBTarget& target() { return target_; }
 
+  // Evaluates `expr` with LLDB. The results are cached, see `ReferenceCache`.
+  const ReferenceResult& evaluate_lldb(const std::string& expr) {
+    return reference_cache_->evaluate(expr);
+  }
+
+  // Evaluates `expr` with lldb-eval and measures the cost of the evaluation.
+  // The counters are only available in the performance mode.
+  EvalCost evaluate_with_cost(const std::string& expr, lldb::SBError& error);
+
  private:
+  static void log_callback(const char* message, void* baton);
+
+  bool perf_mode_ = false;
+  std::atomic<uint64_t> sb_api_calls_{0};
+  std::atomic<uint64_t> memory_reads_{0};
+
   lldb::SBDebugger debugger_;
   lldb::SBFrame frame_;
   lldb::SBTarget target_;
-  SymbolTable symtab_;
+  // Shared by the generators created for each input, so that the symbol
+  // lookups are memoized across inputs.
+  std::shared_ptr<SymbolIndex> symbol_index_;
+  std::unique_ptr<ReferenceCache> reference_cache_;
 };
 
 }  // namespace fuzzer
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Performance fuzzing mode: looks for pathologically slow expressions instead
+// of crashes. Every evaluation is measured, the inputs exceeding the budgets
+// are reported and saved to the regression corpus, which can be replayed by
+// `fuzzer_benchmark --regression_corpus <dir>`.
+//
+// The budgets are passed after the libFuzzer flags (libFuzzer ignores the flags
+// starting with "--"):
+//   --time_budget_us=<n>, --sb_api_calls_budget=<n>,
+//   --memory_reads_budget=<n>, --allocations_budget=<n>,
+//   --regression_corpus=<dir>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+#include "lldb/API/SBError.h"
+#include "tools/fuzzer/libfuzzer_common.h"
+
+// Global variables that are initialized in `LLVMFuzzerInitialize`.
+static fuzzer::LibfuzzerState g_state;
+static fuzzer::EvalBudget g_budget;
+static std::string g_regression_corpus;
+
+static const char* kLoggingPrefix = "[lldb-eval-perf-fuzzer] ";
+
+// Saves the expression to the regression corpus. The file name is derived
+// from the expression, so the same expression is saved only once.
+static void save_to_regression_corpus(const std::string& expr) {
+  if (g_regression_corpus.empty()) {
+    return;
+  }
+  std::filesystem::create_directories(g_regression_corpus);
+
+  char name[32];
+  snprintf(name, sizeof(name), "%016zx.expr", std::hash<std::string>{}(expr));
+  auto path = std::filesystem::path(g_regression_corpus) / name;
+
+  FILE* file = fopen(path.string().c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "%sCould not write %s\n", kLoggingPrefix,
+            path.string().c_str());
+    return;
+  }
+  fprintf(file, "%s\n", expr.c_str());
+  fclose(file);
+}
+
+static bool parse_flag(const char* arg, const char* name, std::string& value) {
+  size_t name_len = strlen(name);
+  if (strncmp(arg, name, name_len) != 0 || arg[name_len] != '=') {
+    return false;
+  }
+  value = arg + name_len + 1;
+  return true;
+}
+
+static void parse_budget_flags(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_flag(argv[i], "--time_budget_us", value)) {
+      g_budget.time_us = std::stod(value);
+    } else if (parse_flag(argv[i], "--sb_api_calls_budget", value)) {
+      g_budget.sb_api_calls = std::stoull(value);
+    } else if (parse_flag(argv[i], "--memory_reads_budget", value)) {
+      g_budget.memory_reads = std::stoull(value);
+    } else if (parse_flag(argv[i], "--allocations_budget", value)) {
+      g_budget.allocations = std::stoull(value);
+    } else if (parse_flag(argv[i], "--regression_corpus", value)) {
+      g_regression_corpus = value;
+    }
+  }
+}
+
+extern "C" size_t LLVMFuzzerCustomMutator(uint8_t* data, size_t size,
+                                          size_t max_size, unsigned int seed) {
+  return g_state.custom_mutate(data, size, max_size, seed);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  std::string expr = g_state.input_to_expr(data, size);
+  lldb::SBError error;
+  fuzzer::EvalCost cost = g_state.evaluate_with_cost(expr, error);
+
+  std::string exceeded = g_budget.check(cost);
+  if (exceeded.empty()) {
+    return 0;
+  }
+
+  fprintf(stderr,
+          "%sexpr: %s\n"
+          "%s over budget: %s\n"
+          "%s cost: %.1fus, %" PRIu64 " SB API calls, %" PRIu64
+          " memory reads, %" PRIu64 " allocations\n",
+          kLoggingPrefix, expr.c_str(), kLoggingPrefix, exceeded.c_str(),
+          kLoggingPrefix, cost.time_us, cost.sb_api_calls, cost.memory_reads,
+          cost.allocations);
+  save_to_regression_corpus(expr);
+
+  return 0;
+}
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+  parse_budget_flags(*argc, *argv);
+  return g_state.init(argc, argv, /*perf_mode*/ true);
+}
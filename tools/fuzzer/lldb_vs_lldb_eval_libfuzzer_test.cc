@@ -25,12 +25,11 @@
 #include "lldb-eval/context.h"
 #include "lldb-eval/eval.h"
 #include "lldb-eval/parser.h"
-#include "lldb/API/SBError.h"
-#include "lldb/API/SBExpressionOptions.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBType.h"
 #include "lldb/API/SBValue.h"
 #include "tools/fuzzer/libfuzzer_common.h"
+#include "tools/fuzzer/reference_cache.h"
 
 static fuzzer::LibfuzzerState g_state;
 
@@ -55,16 +54,13 @@ const char* maybe_null(const char* str) {
   return str == nullptr ? "null" : str;
 }
 
-bool compare_types(lldb::SBType lhs, lldb::SBType rhs) {
-  const std::string lhs_str = maybe_null(lhs.GetName());
-  const std::string rhs_str = maybe_null(rhs.GetName());
-
-  if ((lhs_str == "std::nullptr_t" && rhs_str == "nullptr_t") ||
-      (lhs_str == "nullptr_t" && rhs_str == "std::nullptr_t")) {
+bool compare_types(const std::string& lhs, const std::string& rhs) {
+  if ((lhs == "std::nullptr_t" && rhs == "nullptr_t") ||
+      (lhs == "nullptr_t" && rhs == "std::nullptr_t")) {
     return true;
   }
 
-  return lhs_str == rhs_str;
+  return lhs == rhs;
 }
 
 void log(const char* format, ...) {
@@ -89,10 +85,10 @@ void log_lldb_eval_error(const std::string& expr, lldb_eval::Error error) {
   log_separator();
 }
 
-void log_lldb_error(const std::string& expr, lldb::SBError error) {
+void log_lldb_error(const std::string& expr, const std::string& error) {
   log_expr(expr);
   log(" cause: lldb error");
-  log(" error: %s", error.GetCString());
+  log(" error: %s", error.c_str());
   log_separator();
 }
 
@@ -155,7 +151,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
     abort();
   }
 
-  lldb_eval::Interpreter eval(g_state.target(), sm);
+  lldb_eval::Interpreter eval(g_state.target(), sm->GetSourceText());
   lldb::SBValue lldb_eval_value = eval.Eval(tree.get(), err).inner_value();
   if (err) {
     log_lldb_eval_error(expr, err);
@@ -168,26 +164,22 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   report_undefined_behaviour(ub_status);
 
   // LLDB evaluation.
-  lldb::SBExpressionOptions opts;
-  opts.SetAutoApplyFixIts(false);
-  lldb::SBValue lldb_value =
-      g_state.frame().EvaluateExpression(expr.c_str(), opts);
-  if (lldb_value.GetError().Fail()) {
+  const fuzzer::ReferenceResult& lldb_result = g_state.evaluate_lldb(expr);
+  if (lldb_result.error.has_value()) {
     // Some errors are caused by undefined behaviour (e.g. division by zero).
     // Consider only errors that were caused if UB wasn't detected.
     if (ub_status != lldb_eval::UbStatus::kOk) {
       return 0;
     }
-    log_lldb_error(expr, lldb_value.GetError());
+    log_lldb_error(expr, *lldb_result.error);
     abort();
   }
 
   // Check type mismatch.
-  lldb::SBType lldb_type = lldb_value.GetType();
-  lldb::SBType lldb_eval_type = lldb_eval_value.GetType();
+  std::string lldb_type = lldb_result.type_name.value_or("null");
+  std::string lldb_eval_type = maybe_null(lldb_eval_value.GetType().GetName());
   if (!compare_types(lldb_type, lldb_eval_type)) {
-    log_type_mismatch(expr, maybe_null(lldb_type.GetName()),
-                      maybe_null(lldb_eval_type.GetName()));
+    log_type_mismatch(expr, lldb_type.c_str(), lldb_eval_type.c_str());
     abort();
   }
 
@@ -196,7 +188,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  std::string lldb_value_str = maybe_null(lldb_value.GetValue());
+  std::string lldb_value_str = lldb_result.value.value_or("null");
   std::string lldb_eval_value_str = maybe_null(lldb_eval_value.GetValue());
 
   if (lldb_eval_value_str != lldb_value_str) {
@@ -39,6 +39,7 @@
 #include "tools/cpp/runfiles/runfiles.h"
 #include "tools/fuzzer/ast.h"
 #include "tools/fuzzer/expr_gen.h"
+#include "tools/fuzzer/reference_cache.h"
 #include "tools/fuzzer/symbol_table.h"
 
 using bazel::tools::cpp::runfiles::Runfiles;
@@ -51,28 +52,22 @@ enum Verbosity {
   ShowEverything,
 };
 
-// Compares LLDB types ignoring type qualifiers (const, volatile).
-bool compare_types(lldb::SBType lhs, lldb::SBType rhs) {
-  if (!lhs.IsValid() || !rhs.IsValid()) {
-    return false;
-  }
-
-  lhs = lhs.GetCanonicalType().GetUnqualifiedType();
-  rhs = rhs.GetCanonicalType().GetUnqualifiedType();
-
-  return strcmp(lhs.GetName(), rhs.GetName()) == 0;
-}
-
 using EvaluationContext = std::variant<lldb::SBFrame, lldb::SBValue>;
 
-lldb::SBValue evaluate_expression_lldb(EvaluationContext eval_ctx,
-                                       const std::string& expr) {
+fuzzer::ReferenceResult evaluate_expression_lldb(
+    EvaluationContext eval_ctx, const std::string& expr,
+    fuzzer::ReferenceCache* reference_cache) {
+  if (reference_cache != nullptr &&
+      std::holds_alternative<lldb::SBFrame>(eval_ctx)) {
+    return reference_cache->evaluate(expr);
+  }
+
   // Disable auto fix-its in LLDB evaluations.
   lldb::SBExpressionOptions options;
   options.SetAutoApplyFixIts(false);
-  return std::visit(
+  return fuzzer::ReferenceResult::from_value(std::visit(
       [&](auto&& ctx) { return ctx.EvaluateExpression(expr.c_str(), options); },
-      eval_ctx);
+      eval_ctx));
 }
 
 lldb::SBValue evaluate_expression_lldb_eval(EvaluationContext eval_ctx,
@@ -85,32 +80,36 @@ lldb::SBValue evaluate_expression_lldb_eval(EvaluationContext eval_ctx,
       eval_ctx);
 }
 
+// LLDB evaluations go through the `reference_cache`, unless it's null.
 void eval_and_print_expr(EvaluationContext eval_ctx, const std::string& expr,
-                         Verbosity verbosity) {
-  auto lldb_value = evaluate_expression_lldb(eval_ctx, expr);
-  auto lldb_err = lldb_value.GetError();
+                         Verbosity verbosity,
+                         fuzzer::ReferenceCache* reference_cache = nullptr) {
+  auto lldb_result = evaluate_expression_lldb(eval_ctx, expr, reference_cache);
+  const auto& lldb_value = lldb_result.value;
 
   lldb::SBError lldb_eval_err;
   auto lldb_eval_value =
       evaluate_expression_lldb_eval(eval_ctx, expr, lldb_eval_err);
 
   bool value_mismatch;
-  if (lldb_value.GetValue() != nullptr &&
-      lldb_eval_value.GetValue() != nullptr) {
-    value_mismatch =
-        strcmp(lldb_value.GetValue(), lldb_eval_value.GetValue()) != 0;
+  if (lldb_value.has_value() && lldb_eval_value.GetValue() != nullptr) {
+    value_mismatch = *lldb_value != lldb_eval_value.GetValue();
   } else {
-    // Pointer comparison: Mismatch if one value is null and the other is not
-    value_mismatch = lldb_value.GetValue() != lldb_eval_value.GetValue();
+    // Mismatch if one value is null and the other is not
+    value_mismatch =
+        lldb_value.has_value() != (lldb_eval_value.GetValue() != nullptr);
   }
 
   // Since we don't care about type qualifiers, ignore them when comparing
   // types. Otherwise there will be many noise caused by type mismatch, e.g.
   // `int` vs `const int`.
-  bool type_mismatch =
-      !compare_types(lldb_value.GetType(), lldb_eval_value.GetType());
-  bool has_error =
-      lldb_err.GetCString() != nullptr || lldb_eval_err.GetCString() != nullptr;
+  auto lldb_eval_type =
+      fuzzer::canonical_type_name(lldb_eval_value.GetType());
+  bool type_mismatch = !lldb_result.canonical_type_name.has_value() ||
+                       !lldb_eval_type.has_value() ||
+                       *lldb_result.canonical_type_name != *lldb_eval_type;
+  bool has_error = lldb_result.error.has_value() ||
+                   lldb_eval_err.GetCString() != nullptr;
 
   bool must_print = value_mismatch || type_mismatch || has_error ||
                     verbosity == Verbosity::ShowEverything;
@@ -120,8 +119,8 @@ void eval_and_print_expr(EvaluationContext eval_ctx, const std::string& expr,
   printf("expr : `%s`\n", expr.c_str());
 
   if (value_mismatch) {
-    if (lldb_value.GetValue() != nullptr) {
-      printf("lldb value     : `%s`\n", lldb_value.GetValue());
+    if (lldb_value.has_value()) {
+      printf("lldb value     : `%s`\n", lldb_value->c_str());
     } else {
       printf("lldb value     : No value returned\n");
     }
@@ -131,12 +130,13 @@ void eval_and_print_expr(EvaluationContext eval_ctx, const std::string& expr,
       printf("lldb-eval value: No value returned\n");
     }
   } else if (verbosity == Verbosity::ShowEverything) {
-    printf("value: `%s`\n", lldb_value.GetValue());
+    printf("value: `%s`\n", lldb_value.value_or("(null)").c_str());
   }
 
+  const auto& lldb_type = lldb_result.type_name;
   if (type_mismatch) {
-    if (lldb_value.GetTypeName() != nullptr) {
-      printf("lldb type     : `%s`\n", lldb_value.GetTypeName());
+    if (lldb_type.has_value()) {
+      printf("lldb type     : `%s`\n", lldb_type->c_str());
     } else {
       printf("lldb type     : No type name\n");
     }
@@ -146,13 +146,13 @@ void eval_and_print_expr(EvaluationContext eval_ctx, const std::string& expr,
       printf("lldb-eval type: No type name\n");
     }
   } else if (verbosity == Verbosity::ShowEverything) {
-    printf("type: `%s`\n", lldb_value.GetTypeName());
+    printf("type: `%s`\n", lldb_type.value_or("(null)").c_str());
   }
 
   if (has_error) {
     printf("== Reported errors ==\n");
-    if (lldb_err.GetCString() != nullptr) {
-      printf("lldb     : %s\n", lldb_err.GetCString());
+    if (lldb_result.error.has_value()) {
+      printf("lldb     : %s\n", lldb_result.error->c_str());
     } else {
       printf("lldb     : No error reported\n");
     }
@@ -182,11 +182,15 @@ void run_repl(EvaluationContext eval_ctx) {
 }
 
 fuzzer::SymbolTable gen_symtab(EvaluationContext& eval_ctx,
-                               bool ignore_qualified_types) {
+                               bool ignore_qualified_types,
+                               const std::string& symtab_cache) {
   fuzzer::SymbolTable symtab;
 
   auto* frame = std::get_if<lldb::SBFrame>(&eval_ctx);
-  if (frame) {
+  if (frame && !symtab_cache.empty()) {
+    symtab = fuzzer::SymbolTable::create_from_frame_cached(
+        *frame, symtab_cache, ignore_qualified_types);
+  } else if (frame) {
     symtab =
         fuzzer::SymbolTable::create_from_frame(*frame, ignore_qualified_types);
   }
@@ -204,7 +208,9 @@ fuzzer::SymbolTable gen_symtab(EvaluationContext& eval_ctx,
   return symtab;
 }
 
-void run_fuzzer(EvaluationContext& eval_ctx, const unsigned* seed_ptr) {
+void run_fuzzer(EvaluationContext& eval_ctx, const unsigned* seed_ptr,
+                const std::string& symtab_cache,
+                const std::string& reference_cache_dir) {
   std::random_device rd;
   unsigned seed = seed_ptr ? *seed_ptr : rd();
   printf("==== Seed for this run is: %u ====\n", seed);
@@ -219,7 +225,8 @@ void run_fuzzer(EvaluationContext& eval_ctx, const unsigned* seed_ptr) {
 
   // Symbol table
   fuzzer::SymbolTable symtab = gen_symtab(
-      eval_ctx, /*ignore_qualified_types*/ !cfg.cv_qualifiers_enabled);
+      eval_ctx, /*ignore_qualified_types*/ !cfg.cv_qualifiers_enabled,
+      symtab_cache);
 
   fuzzer::ExprGenerator gen(std::move(rng), std::move(cfg), std::move(symtab));
   std::vector<std::string> exprs;
@@ -239,8 +246,23 @@ void run_fuzzer(EvaluationContext& eval_ctx, const unsigned* seed_ptr) {
     exprs.emplace_back(std::move(str));
   }
 
+  // LLDB results are only cached in the frame context, the stop location
+  // doesn't identify the value of the value context.
+  std::unique_ptr<fuzzer::ReferenceCache> reference_cache;
+  auto* frame = std::get_if<lldb::SBFrame>(&eval_ctx);
+  if (frame && !reference_cache_dir.empty()) {
+    reference_cache =
+        std::make_unique<fuzzer::ReferenceCache>(*frame, reference_cache_dir);
+  }
+
   for (const auto& e : exprs) {
-    eval_and_print_expr(eval_ctx, e, Verbosity::ShowMismatchesOrErrors);
+    eval_and_print_expr(eval_ctx, e, Verbosity::ShowMismatchesOrErrors,
+                        reference_cache.get());
+  }
+
+  if (reference_cache) {
+    printf("==== LLDB results: %zu cached, %zu evaluated ====\n",
+           reference_cache->hits(), reference_cache->misses());
   }
 }
 
@@ -256,6 +278,8 @@ int main(int argc, char** argv) {
   bool custom_seed = false;
   bool print_help = false;
   std::string value_expr;
+  std::string symtab_cache;
+  std::string reference_cache;
 
   unsigned seed = 0;
   for (int i = 1; i < argc; i++) {
@@ -276,12 +300,25 @@ int main(int argc, char** argv) {
       i++;
       value_expr = argv[i];
     }
+    if (strcmp(argv[i], "--symtab_cache") == 0 && i < argc - 1) {
+      i++;
+      symtab_cache = argv[i];
+    }
+    if (strcmp(argv[i], "--reference_cache") == 0 && i < argc - 1) {
+      i++;
+      reference_cache = argv[i];
+    }
   }
   if (print_help) {
-    printf("Usage: %s [--repl] [--help] [--seed <rng_seed>]\n", argv[0]);
+    printf(
+        "Usage: %s [--repl] [--help] [--seed <rng_seed>] "
+        "[--symtab_cache <dir>] [--reference_cache <dir>]\n",
+        argv[0]);
     printf("--help: Print this message\n");
     printf("--repl: REPL mode, evaluate expressions on lldb and lldb-eval\n");
     printf("--seed <rng_seed>: Specify the RNG seed to use\n");
+    printf("--symtab_cache <dir>: Cache snapshots of symbol tables in <dir>\n");
+    printf("--reference_cache <dir>: Cache LLDB results in <dir>\n");
 
     return 0;
   }
@@ -329,7 +366,7 @@ int main(int argc, char** argv) {
       run_repl(eval_ctx);
     } else {
       const unsigned* seed_ptr = custom_seed ? &seed : nullptr;
-      run_fuzzer(eval_ctx, seed_ptr);
+      run_fuzzer(eval_ctx, seed_ptr, symtab_cache, reference_cache);
     }
 
     proc.Destroy();
@@ -156,8 +156,20 @@ TEST(MutateTest, MutateMultipleTimes) {
     std::shared_ptr<GenNode> to_be_mutated = pick_random_node(root, rng);
     ASSERT_NE(to_be_mutated, nullptr);
 
-    // Re-evaluate the node.
-    random_generator.mutate_gen_node(to_be_mutated);
+    // Track the children nodes being replaced.
+    std::vector<std::weak_ptr<GenNode>> old_children;
+    for (const auto& child : to_be_mutated->children()) {
+      if (std::holds_alternative<std::shared_ptr<GenNode>>(child)) {
+        old_children.emplace_back(std::get<std::shared_ptr<GenNode>>(child));
+      }
+    }
+
+    // Re-evaluate the node. The old subtree should be released.
+    if (random_generator.mutate_gen_node(to_be_mutated)) {
+      for (const auto& old_child : old_children) {
+        ASSERT_TRUE(old_child.expired());
+      }
+    }
 
     // Construct expression generator over the fixed byte sequence.
     std::vector<uint8_t> bytes = make_rng_sequence(root);
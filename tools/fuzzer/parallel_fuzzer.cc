@@ -0,0 +1,677 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Parallel version of the fuzzer (see main.cc). The driver forks K worker
+// processes, each with its own debugger and inferior. Generator seeds are
+// sharded across the workers: seed `first_seed + i` is handled by the worker
+// `i % K`, so the set of generated expressions doesn't depend on K.
+//
+// Workers stream mismatches and UB statistics back to the driver over pipes.
+// The driver deduplicates the mismatches by the hash of the normalized
+// expression (whitespace removed, numeric literals replaced by `0`) and prints
+// each unique mismatch once, followed by the aggregated statistics.
+//
+// Usage:
+//   parallel_fuzzer [--workers <k>] [--seed <first_seed>] [--num_seeds <n>]
+//                   [--num_exprs <per_seed>] [--max_depth <d>]
+
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "lldb-eval/context.h"
+#include "lldb-eval/eval.h"
+#include "lldb-eval/parser.h"
+#include "lldb-eval/parser_context.h"
+#include "lldb-eval/runner.h"
+#include "lldb/API/SBDebugger.h"
+#include "lldb/API/SBExpressionOptions.h"
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBProcess.h"
+#include "lldb/API/SBThread.h"
+#include "lldb/API/SBType.h"
+#include "lldb/API/SBValue.h"
+#include "tools/cpp/runfiles/runfiles.h"
+#include "tools/fuzzer/ast.h"
+#include "tools/fuzzer/expr_gen.h"
+#include "tools/fuzzer/symbol_table.h"
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+static constexpr char SOURCE_PATH_KEY[] = "lldb_eval/testdata/fuzzer_binary.cc";
+static constexpr char BINARY_PATH_KEY[] = "lldb_eval/testdata/fuzzer_binary";
+
+// Outcome of a single expression evaluated by both lldb-eval and LLDB.
+enum class Outcome : uint8_t {
+  Ok = 0,
+  LldbEvalError,
+  LldbError,
+  TypeMismatch,
+  ValueMismatch,
+};
+static constexpr size_t NUM_OUTCOMES = (size_t)Outcome::ValueMismatch + 1;
+
+static const char* outcome_name(Outcome outcome) {
+  switch (outcome) {
+    case Outcome::Ok:
+      return "ok";
+    case Outcome::LldbEvalError:
+      return "lldb-eval error";
+    case Outcome::LldbError:
+      return "lldb error";
+    case Outcome::TypeMismatch:
+      return "type mismatch";
+    case Outcome::ValueMismatch:
+      return "value mismatch";
+  }
+  return "unknown";
+}
+
+static constexpr size_t NUM_UB_STATUSES =
+    (size_t)lldb_eval::UbStatus::kInvalidPtrDiff + 1;
+
+static const char* ub_status_name(size_t status) {
+  static const char* names[NUM_UB_STATUSES] = {
+      "kOk",          "kDivisionByZero",    "kDivisionByMinusOne",
+      "kInvalidCast", "kInvalidShift",      "kNullptrArithmetic",
+      "kInvalidPtrDiff",
+  };
+  return status < NUM_UB_STATUSES ? names[status] : "unknown";
+}
+
+// Statistics collected by a worker, sent to the driver when it's done.
+struct WorkerStats {
+  uint64_t num_exprs = 0;
+  uint64_t num_not_generated = 0;
+  std::array<uint64_t, NUM_OUTCOMES> outcomes = {};
+  std::array<uint64_t, NUM_UB_STATUSES> ub_statuses = {};
+
+  void merge(const WorkerStats& other) {
+    num_exprs += other.num_exprs;
+    num_not_generated += other.num_not_generated;
+    for (size_t i = 0; i < NUM_OUTCOMES; i++) {
+      outcomes[i] += other.outcomes[i];
+    }
+    for (size_t i = 0; i < NUM_UB_STATUSES; i++) {
+      ub_statuses[i] += other.ub_statuses[i];
+    }
+  }
+};
+
+// A mismatch or an error found by a worker.
+struct Finding {
+  Outcome outcome = Outcome::Ok;
+  uint64_t expr_hash = 0;
+  std::string expr;
+  std::string lldb;
+  std::string lldb_eval;
+};
+
+// Wire format. Every record is prefixed by its size (uint32_t, not including
+// the size itself) and kind (uint8_t). Integers are in the native byte order,
+// since the driver and the workers always run on the same machine. Strings are
+// prefixed by their size (uint32_t).
+//
+//   Finding: outcome (uint8_t), expr_hash (uint64_t), expr, lldb, lldb_eval
+//   Stats:   num_exprs, num_not_generated, outcomes[], ub_statuses[] (uint64_t)
+enum class RecordKind : uint8_t {
+  Finding = 1,
+  Stats,
+};
+
+class RecordWriter {
+ public:
+  explicit RecordWriter(RecordKind kind) { write_u8((uint8_t)kind); }
+
+  void write_u8(uint8_t value) { buffer_.push_back(value); }
+  void write_u32(uint32_t value) { write_bytes(&value, sizeof(value)); }
+  void write_u64(uint64_t value) { write_bytes(&value, sizeof(value)); }
+  void write_string(const std::string& str) {
+    write_u32(static_cast<uint32_t>(str.size()));
+    write_bytes(str.data(), str.size());
+  }
+
+  // Writes the record to `fd`. Returns false if the pipe is broken.
+  bool flush(int fd) {
+    uint32_t size = static_cast<uint32_t>(buffer_.size());
+    return write_all(fd, &size, sizeof(size)) &&
+           write_all(fd, buffer_.data(), buffer_.size());
+  }
+
+ private:
+  void write_bytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+  }
+
+  static bool write_all(int fd, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+      ssize_t written = write(fd, bytes, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      bytes += written;
+      size -= written;
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> buffer_;
+};
+
+class RecordReader {
+ public:
+  RecordReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  uint8_t read_u8() { return read<uint8_t>(); }
+  uint32_t read_u32() { return read<uint32_t>(); }
+  uint64_t read_u64() { return read<uint64_t>(); }
+  std::string read_string() {
+    uint32_t size = read_u32();
+    size_t offset = advance(size);
+    if (!ok_) {
+      return {};
+    }
+    return std::string(reinterpret_cast<const char*>(data_ + offset), size);
+  }
+
+  // False if any read went past the end of the record.
+  bool ok() const { return ok_; }
+
+ private:
+  template <typename T>
+  T read() {
+    T value = 0;
+    size_t offset = advance(sizeof(T));
+    if (ok_) {
+      memcpy(&value, data_ + offset, sizeof(T));
+    }
+    return value;
+  }
+
+  size_t advance(size_t size) {
+    if (!ok_ || size > size_ - offset_) {
+      ok_ = false;
+      return 0;
+    }
+    size_t offset = offset_;
+    offset_ += size;
+    return offset;
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_ = 0;
+  bool ok_ = true;
+};
+
+// Removes whitespace and replaces numeric literals (including their suffixes)
+// by `0`, so that e.g. `a + 1u` and `a+42u` are reported only once.
+std::string normalize_expr(const std::string& expr) {
+  std::string result;
+  result.reserve(expr.size());
+  for (size_t i = 0; i < expr.size(); i++) {
+    char c = expr[i];
+    if (isspace(c)) {
+      continue;
+    }
+    bool in_identifier =
+        !result.empty() && (isalnum(result.back()) || result.back() == '_');
+    if (isdigit(c) && !in_identifier) {
+      // Skip the rest of the literal, e.g. `0x1fULL` or `1.5e+3f`.
+      while (i + 1 < expr.size() &&
+             (isalnum(expr[i + 1]) || expr[i + 1] == '.' ||
+              ((expr[i + 1] == '+' || expr[i + 1] == '-') &&
+               (expr[i] == 'e' || expr[i] == 'E')))) {
+        i++;
+      }
+      // Mark the literal, so that the next character isn't treated as a part
+      // of an identifier.
+      result += "0 ";
+      continue;
+    }
+    result += c;
+  }
+  return result;
+}
+
+// 64-bit FNV-1a, stable across the processes.
+uint64_t hash_string(const std::string& str) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Compares LLDB types ignoring type qualifiers (const, volatile).
+bool compare_types(lldb::SBType lhs, lldb::SBType rhs) {
+  if (!lhs.IsValid() || !rhs.IsValid()) {
+    return false;
+  }
+
+  lhs = lhs.GetCanonicalType().GetUnqualifiedType();
+  rhs = rhs.GetCanonicalType().GetUnqualifiedType();
+
+  return strcmp(lhs.GetName(), rhs.GetName()) == 0;
+}
+
+const char* maybe_null(const char* str) {
+  return str == nullptr ? "null" : str;
+}
+
+struct WorkerConfig {
+  std::string source_path;
+  std::string binary_path;
+  int worker_index = 0;
+  int num_workers = 1;
+  unsigned first_seed = 0;
+  int num_seeds = 1;
+  int num_exprs = 0;
+  int max_depth = 0;
+};
+
+class Worker {
+ public:
+  Worker(const WorkerConfig& config, int fd) : config_(config), fd_(fd) {}
+
+  int run() {
+    lldb::SBDebugger::Initialize();
+    {
+      auto debugger = lldb::SBDebugger::Create(false);
+      auto proc = lldb_eval::LaunchTestProgram(
+          debugger, config_.source_path, config_.binary_path, "// BREAK HERE");
+      frame_ = proc.GetSelectedThread().GetSelectedFrame();
+
+      for (int i = config_.worker_index; i < config_.num_seeds;
+           i += config_.num_workers) {
+        run_seed(config_.first_seed + i);
+      }
+
+      RecordWriter record(RecordKind::Stats);
+      record.write_u64(stats_.num_exprs);
+      record.write_u64(stats_.num_not_generated);
+      for (uint64_t count : stats_.outcomes) {
+        record.write_u64(count);
+      }
+      for (uint64_t count : stats_.ub_statuses) {
+        record.write_u64(count);
+      }
+      record.flush(fd_);
+
+      proc.Destroy();
+    }
+    lldb::SBDebugger::Terminate();
+    return 0;
+  }
+
+ private:
+  void run_seed(unsigned seed) {
+    auto rng = std::make_unique<fuzzer::DefaultGeneratorRng>(seed);
+    auto cfg = fuzzer::GenConfig();
+    cfg.num_exprs_to_generate = config_.num_exprs;
+    cfg.max_depth = config_.max_depth;
+    // Same as the fuzzer: disable shifts.
+    cfg.bin_op_mask[fuzzer::BinOp::Shl] = false;
+    cfg.bin_op_mask[fuzzer::BinOp::Shr] = false;
+
+    auto symtab = fuzzer::SymbolTable::create_from_frame(
+        frame_, /*ignore_qualified_types*/ !cfg.cv_qualifiers_enabled);
+    symtab.add_function(fuzzer::ScalarType::UnsignedInt, "__log2",
+                        {fuzzer::ScalarType::UnsignedInt});
+
+    fuzzer::ExprGenerator gen(std::move(rng), cfg, std::move(symtab));
+    for (int i = 0; i < cfg.num_exprs_to_generate; i++) {
+      auto maybe_gen_expr = gen.generate();
+      if (!maybe_gen_expr.has_value()) {
+        stats_.num_not_generated++;
+        continue;
+      }
+      std::ostringstream os;
+      os << maybe_gen_expr.value();
+      evaluate(os.str());
+    }
+  }
+
+  void evaluate(const std::string& expr) {
+    stats_.num_exprs++;
+
+    Finding finding;
+    finding.expr = expr;
+
+    // lldb-eval evaluation, the same way as in the libFuzzer target, to get
+    // the UB status.
+    auto sm = lldb_eval::SourceManager::Create(expr);
+    auto ctx = lldb_eval::Context::Create(sm, frame_);
+    lldb_eval::Error err;
+    lldb_eval::Parser parser(ctx);
+    lldb_eval::ExprResult tree = parser.Run(err);
+    lldb::SBValue lldb_eval_value;
+    if (!err) {
+      lldb_eval::Interpreter eval(frame_.GetThread().GetProcess().GetTarget(),
+                                  sm->GetSourceText());
+      lldb_eval_value = eval.Eval(tree.get(), err).inner_value();
+    }
+    lldb_eval::UbStatus ub_status = err.ub_status();
+    stats_.ub_statuses[(size_t)ub_status]++;
+
+    // LLDB evaluation.
+    lldb::SBExpressionOptions options;
+    options.SetAutoApplyFixIts(false);
+    lldb::SBValue lldb_value = frame_.EvaluateExpression(expr.c_str(), options);
+    lldb::SBError lldb_err = lldb_value.GetError();
+
+    if (err && lldb_err.Fail()) {
+      // Both failed, nothing to compare.
+      finding.outcome = Outcome::Ok;
+    } else if (err) {
+      finding.outcome = Outcome::LldbEvalError;
+      finding.lldb = maybe_null(lldb_value.GetValue());
+      finding.lldb_eval = err.message();
+    } else if (lldb_err.Fail()) {
+      // Some errors are caused by undefined behaviour (e.g. division by zero).
+      finding.outcome = ub_status == lldb_eval::UbStatus::kOk
+                            ? Outcome::LldbError
+                            : Outcome::Ok;
+      finding.lldb = maybe_null(lldb_err.GetCString());
+      finding.lldb_eval = maybe_null(lldb_eval_value.GetValue());
+    } else if (!compare_types(lldb_value.GetType(),
+                              lldb_eval_value.GetType())) {
+      finding.outcome = Outcome::TypeMismatch;
+      finding.lldb = maybe_null(lldb_value.GetTypeName());
+      finding.lldb_eval = maybe_null(lldb_eval_value.GetTypeName());
+    } else if (ub_status == lldb_eval::UbStatus::kOk &&
+               strcmp(maybe_null(lldb_value.GetValue()),
+                      maybe_null(lldb_eval_value.GetValue())) != 0) {
+      // Don't compare values if undefined behaviour was detected.
+      finding.outcome = Outcome::ValueMismatch;
+      finding.lldb = maybe_null(lldb_value.GetValue());
+      finding.lldb_eval = maybe_null(lldb_eval_value.GetValue());
+    }
+    stats_.outcomes[(size_t)finding.outcome]++;
+
+    if (finding.outcome == Outcome::Ok) {
+      return;
+    }
+    // Mismatches of different kinds are reported separately.
+    finding.expr_hash =
+        hash_string(normalize_expr(expr)) ^ (uint64_t)finding.outcome;
+
+    RecordWriter record(RecordKind::Finding);
+    record.write_u8((uint8_t)finding.outcome);
+    record.write_u64(finding.expr_hash);
+    record.write_string(finding.expr);
+    record.write_string(finding.lldb);
+    record.write_string(finding.lldb_eval);
+    record.flush(fd_);
+  }
+
+  WorkerConfig config_;
+  int fd_;
+  lldb::SBFrame frame_;
+  WorkerStats stats_;
+};
+
+class Driver {
+ public:
+  // Handles the data received from a worker. Returns false if the data is
+  // malformed.
+  bool receive(std::vector<uint8_t>& buffer) {
+    size_t offset = 0;
+    while (buffer.size() - offset >= sizeof(uint32_t)) {
+      uint32_t size;
+      memcpy(&size, buffer.data() + offset, sizeof(size));
+      if (buffer.size() - offset - sizeof(size) < size) {
+        break;
+      }
+      offset += sizeof(size);
+      if (!handle_record(RecordReader(buffer.data() + offset, size))) {
+        return false;
+      }
+      offset += size;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+    return true;
+  }
+
+  void print_summary(double elapsed_sec) const {
+    printf("==== Summary ====\n");
+    printf("expressions      : %" PRIu64 " (%.1f/s)\n", stats_.num_exprs,
+           stats_.num_exprs / elapsed_sec);
+    printf("not generated    : %" PRIu64 "\n", stats_.num_not_generated);
+    for (size_t i = 0; i < NUM_OUTCOMES; i++) {
+      printf("%-17s: %" PRIu64 "\n", outcome_name((Outcome)i),
+             stats_.outcomes[i]);
+    }
+    printf("unique findings  : %zu (%" PRIu64 " duplicates)\n",
+           seen_hashes_.size(), num_duplicates_);
+    printf("UB stats: (");
+    for (size_t i = 0; i < NUM_UB_STATUSES; i++) {
+      printf("%s%s: %" PRIu64, i > 0 ? ", " : "", ub_status_name(i),
+             stats_.ub_statuses[i]);
+    }
+    printf(")\n");
+  }
+
+ private:
+  bool handle_record(RecordReader reader) {
+    auto kind = (RecordKind)reader.read_u8();
+    if (kind == RecordKind::Finding) {
+      Finding finding;
+      finding.outcome = (Outcome)reader.read_u8();
+      finding.expr_hash = reader.read_u64();
+      finding.expr = reader.read_string();
+      finding.lldb = reader.read_string();
+      finding.lldb_eval = reader.read_string();
+      if (!reader.ok()) {
+        return false;
+      }
+      if (!seen_hashes_.insert(finding.expr_hash).second) {
+        num_duplicates_++;
+        return true;
+      }
+      print_finding(finding);
+      return true;
+    }
+    if (kind == RecordKind::Stats) {
+      WorkerStats stats;
+      stats.num_exprs = reader.read_u64();
+      stats.num_not_generated = reader.read_u64();
+      for (auto& count : stats.outcomes) {
+        count = reader.read_u64();
+      }
+      for (auto& count : stats.ub_statuses) {
+        count = reader.read_u64();
+      }
+      if (!reader.ok()) {
+        return false;
+      }
+      stats_.merge(stats);
+      return true;
+    }
+    return false;
+  }
+
+  static void print_finding(const Finding& finding) {
+    printf("expr : `%s`\n", finding.expr.c_str());
+    printf("cause: %s\n", outcome_name(finding.outcome));
+    printf("lldb     : %s\n", finding.lldb.c_str());
+    printf("lldb-eval: %s\n", finding.lldb_eval.c_str());
+    printf("============================================================\n");
+  }
+
+  WorkerStats stats_;
+  std::unordered_set<uint64_t> seen_hashes_;
+  uint64_t num_duplicates_ = 0;
+};
+
+int main(int argc, char** argv) {
+  std::string err;
+  std::unique_ptr<Runfiles> runfiles(Runfiles::Create(argv[0], &err));
+  if (runfiles == nullptr) {
+    fprintf(stderr, "Could not launch the fuzzer: %s\n", err.c_str());
+    return 1;
+  }
+
+  WorkerConfig config;
+  config.num_workers = std::max(1u, std::thread::hardware_concurrency());
+  config.num_seeds = -1;
+  config.num_exprs = fuzzer::GenConfig().num_exprs_to_generate;
+  config.max_depth = fuzzer::GenConfig().max_depth;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--workers") == 0 && i < argc - 1) {
+      config.num_workers = std::max(1, std::stoi(argv[++i]));
+    } else if (strcmp(argv[i], "--seed") == 0 && i < argc - 1) {
+      config.first_seed = std::stoul(argv[++i]);
+    } else if (strcmp(argv[i], "--num_seeds") == 0 && i < argc - 1) {
+      config.num_seeds = std::stoi(argv[++i]);
+    } else if (strcmp(argv[i], "--num_exprs") == 0 && i < argc - 1) {
+      config.num_exprs = std::stoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max_depth") == 0 && i < argc - 1) {
+      config.max_depth = std::stoi(argv[++i]);
+    }
+  }
+  if (config.num_seeds < 0) {
+    // One seed per worker by default.
+    config.num_seeds = config.num_workers;
+  }
+
+  printf("==== Workers: %d, seeds: %u..%u, expressions per seed: %d ====\n",
+         config.num_workers, config.first_seed,
+         config.first_seed + config.num_seeds - 1, config.num_exprs);
+  fflush(stdout);
+
+  // The workers only inherit the environment, LLDB is initialized after fork.
+  lldb_eval::SetupLLDBServerEnv(*runfiles);
+  config.source_path = runfiles->Rlocation(SOURCE_PATH_KEY);
+  config.binary_path = runfiles->Rlocation(BINARY_PATH_KEY);
+
+  auto start = std::chrono::steady_clock::now();
+
+  struct WorkerProcess {
+    pid_t pid;
+    int fd;
+    std::vector<uint8_t> buffer;
+  };
+  std::vector<WorkerProcess> workers;
+  for (int i = 0; i < config.num_workers; i++) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("pipe");
+      return 1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      close(fds[0]);
+      // Don't hold the read ends of the other workers' pipes.
+      for (const auto& worker : workers) {
+        close(worker.fd);
+      }
+      config.worker_index = i;
+      _exit(Worker(config, fds[1]).run());
+    }
+    close(fds[1]);
+    workers.push_back({pid, fds[0], {}});
+  }
+
+  Driver driver;
+  bool protocol_error = false;
+  size_t num_open = workers.size();
+  while (num_open > 0) {
+    std::vector<pollfd> pollfds;
+    for (const auto& worker : workers) {
+      pollfds.push_back({worker.fd, POLLIN, 0});
+    }
+    if (poll(pollfds.data(), pollfds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll");
+      return 1;
+    }
+
+    for (size_t i = 0; i < workers.size(); i++) {
+      auto& worker = workers[i];
+      if (worker.fd < 0 || pollfds[i].revents == 0) {
+        continue;
+      }
+      uint8_t chunk[4096];
+      ssize_t size = read(worker.fd, chunk, sizeof(chunk));
+      if (size < 0 && errno == EINTR) {
+        continue;
+      }
+      if (size <= 0) {
+        close(worker.fd);
+        worker.fd = -1;
+        num_open--;
+        continue;
+      }
+      worker.buffer.insert(worker.buffer.end(), chunk, chunk + size);
+      if (!driver.receive(worker.buffer)) {
+        protocol_error = true;
+      }
+    }
+  }
+
+  int num_failed_workers = 0;
+  for (const auto& worker : workers) {
+    int status = 0;
+    waitpid(worker.pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        !worker.buffer.empty()) {
+      num_failed_workers++;
+    }
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  driver.print_summary(std::chrono::duration<double>(end - start).count());
+
+  if (protocol_error) {
+    fprintf(stderr, "Error: Malformed data received from a worker\n");
+    return 1;
+  }
+  if (num_failed_workers > 0) {
+    fprintf(stderr, "Error: %d worker(s) crashed\n", num_failed_workers);
+    return 1;
+  }
+  return 0;
+}
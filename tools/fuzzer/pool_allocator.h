@@ -0,0 +1,136 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POOL_ALLOCATOR_H
+#define INCLUDE_POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace fuzzer {
+
+// Pool of fixed-size memory blocks. Memory is carved out of large chunks and
+// freed blocks are kept in a free list for reuse, so allocating a block is
+// a couple of pointer operations. Chunks are never returned to the system.
+template <size_t Size, size_t Align>
+class FixedSizePool {
+ public:
+  // Returns the pool of the current thread. The pool is intentionally leaked,
+  // so that blocks can outlive the thread (and static destructors) safely.
+  static FixedSizePool& instance() {
+    thread_local FixedSizePool* pool = new FixedSizePool();
+    return *pool;
+  }
+
+  void* allocate() {
+    if (free_list_ == nullptr) {
+      grow();
+    }
+    FreeBlock* block = free_list_;
+    free_list_ = block->next;
+    return block;
+  }
+
+  void deallocate(void* ptr) {
+    auto* block = static_cast<FreeBlock*>(ptr);
+    block->next = free_list_;
+    free_list_ = block;
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  static constexpr size_t kAlign =
+      Align > alignof(FreeBlock) ? Align : alignof(FreeBlock);
+  static constexpr size_t kBlockSize =
+      ((Size > sizeof(FreeBlock) ? Size : sizeof(FreeBlock)) + kAlign - 1) /
+      kAlign * kAlign;
+  static constexpr size_t kBlocksPerChunk = 256;
+
+  struct alignas(kAlign) Chunk {
+    std::byte data[kBlockSize * kBlocksPerChunk];
+  };
+
+  FixedSizePool() = default;
+
+  void grow() {
+    chunks_.push_back(std::make_unique<Chunk>());
+    std::byte* data = chunks_.back()->data;
+    // Link the blocks in the address order, so that consecutive allocations
+    // are adjacent in memory.
+    for (size_t i = kBlocksPerChunk; i > 0; i--) {
+      deallocate(data + (i - 1) * kBlockSize);
+    }
+  }
+
+  FreeBlock* free_list_ = nullptr;
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+};
+
+// Allocator for `std::allocate_shared`, backed by a `FixedSizePool`. Only
+// single-object allocations go through the pool.
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    if (n != 1) {
+      return std::allocator<T>().allocate(n);
+    }
+    return static_cast<T*>(Pool::instance().allocate());
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    if (n != 1) {
+      std::allocator<T>().deallocate(ptr, n);
+      return;
+    }
+    Pool::instance().deallocate(ptr);
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>&) const {
+    return false;
+  }
+
+ private:
+  using Pool = FixedSizePool<sizeof(T), alignof(T)>;
+};
+
+// Same as `std::make_shared`, but the object and its control block are
+// allocated from a pool.
+template <typename T, typename... Args>
+std::shared_ptr<T> make_pooled(Args&&... args) {
+  return std::allocate_shared<T>(PoolAllocator<T>(),
+                                 std::forward<Args>(args)...);
+}
+
+}  // namespace fuzzer
+
+#endif  // INCLUDE_POOL_ALLOCATOR_H
@@ -0,0 +1,374 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/fuzzer/reference_cache.h"
+
+#ifndef _WIN32
+#include <sys/file.h>
+#endif
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "lldb/API/SBError.h"
+#include "lldb/API/SBExpressionOptions.h"
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBType.h"
+#include "lldb/API/SBValue.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tools/fuzzer/symbol_table.h"
+
+namespace fuzzer {
+namespace {
+
+// Results of each stop location are stored in their own file. The file is
+// a sequence of records, appended as new expressions are evaluated:
+//   u32     size of the rest of the record
+//   string  normalized expression
+//   u8      bit mask of the result fields present
+//   string  each present field, in the order of declaration
+// Strings are a u32 size followed by the bytes. Integers are little-endian.
+// Each record is written with a single write to a file opened for appending,
+// so that multiple fuzzer processes can share the file. Appends hold a shared
+// lock on the file, so that it can't be truncated in the middle of a write.
+constexpr char RESULTS_FILE_SUFFIX[] = ".lldb_results";
+
+// The in-memory cache stops growing at this size, further results are still
+// evaluated but not cached.
+constexpr size_t MAX_CACHED_RESULTS = 1 << 20;
+
+constexpr size_t NUM_RESULT_FIELDS = 4;
+
+using ResultField = std::optional<std::string> ReferenceResult::*;
+
+constexpr ResultField RESULT_FIELDS[NUM_RESULT_FIELDS] = {
+    &ReferenceResult::value,
+    &ReferenceResult::type_name,
+    &ReferenceResult::canonical_type_name,
+    &ReferenceResult::error,
+};
+
+std::optional<std::string> maybe_null(const char* str) {
+  if (str == nullptr) {
+    return {};
+  }
+  return str;
+}
+
+void write_u32(std::string& data, uint32_t value) {
+  for (size_t i = 0; i < sizeof(value); i++) {
+    data.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void write_string(std::string& data, std::string_view str) {
+  write_u32(data, str.size());
+  data.append(str);
+}
+
+// Locks the results file, see above. Returns false if it can't be locked.
+bool lock_file(int fd, bool exclusive) {
+#ifndef _WIN32
+  return flock(fd, exclusive ? LOCK_EX : LOCK_SH) == 0;
+#else
+  (void)fd;
+  (void)exclusive;
+  return false;
+#endif
+}
+
+void unlock_file(int fd) {
+#ifndef _WIN32
+  flock(fd, LOCK_UN);
+#else
+  (void)fd;
+#endif
+}
+
+// Reads the data of a record. All reads fail once the data is exhausted.
+class RecordReader {
+ public:
+  explicit RecordReader(std::string_view data) : data_(data) {}
+
+  bool ok() const { return ok_; }
+
+  std::optional<uint32_t> read_u32() {
+    std::string_view bytes = read_bytes(sizeof(uint32_t));
+    if (!ok_) {
+      return {};
+    }
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes.size(); i++) {
+      value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+  }
+
+  std::string_view read_string() {
+    auto size = read_u32();
+    return size.has_value() ? read_bytes(*size) : std::string_view();
+  }
+
+  std::string_view read_bytes(size_t size) {
+    if (!ok_ || data_.size() < size) {
+      ok_ = false;
+      return {};
+    }
+    std::string_view bytes = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return bytes;
+  }
+
+ private:
+  std::string_view data_;
+  bool ok_ = true;
+};
+
+// Returns the size of the complete records of a results file.
+size_t complete_records_size(std::string_view data) {
+  RecordReader reader(data);
+  size_t valid_size = 0;
+  while (valid_size < data.size()) {
+    auto size = reader.read_u32();
+    reader.read_bytes(size.value_or(0));
+    if (!reader.ok()) {
+      break;
+    }
+    valid_size += sizeof(uint32_t) + *size;
+  }
+  return valid_size;
+}
+
+// Truncates the results file after its last complete record. Other processes
+// may be appending to the file, so it's truncated only under the exclusive
+// lock and after its records are checked again. Files that can't be locked
+// are left alone.
+void drop_incomplete_record(int fd, const std::string& path) {
+  if (!lock_file(fd, /*exclusive*/ true)) {
+    return;
+  }
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (buffer) {
+    size_t valid_size = complete_records_size((*buffer)->getBuffer());
+    if (valid_size < (*buffer)->getBufferSize()) {
+      llvm::sys::fs::resize_file(fd, valid_size);
+    }
+  }
+  unlock_file(fd);
+}
+
+}  // namespace
+
+ReferenceResult ReferenceResult::from_value(lldb::SBValue value) {
+  ReferenceResult result;
+  result.value = maybe_null(value.GetValue());
+  result.type_name = maybe_null(value.GetType().GetName());
+  result.canonical_type_name = fuzzer::canonical_type_name(value.GetType());
+
+  lldb::SBError error = value.GetError();
+  if (error.Fail()) {
+    result.error = error.GetCString() != nullptr ? error.GetCString() : "";
+  }
+  return result;
+}
+
+std::optional<std::string> canonical_type_name(lldb::SBType type) {
+  if (!type.IsValid()) {
+    return {};
+  }
+  return maybe_null(type.GetCanonicalType().GetUnqualifiedType().GetName());
+}
+
+std::string normalize_expr(std::string_view expr) {
+  std::string normalized;
+  normalized.reserve(expr.size());
+
+  char quote = '\0';
+  bool pending_space = false;
+  for (size_t i = 0; i < expr.size(); i++) {
+    char c = expr[i];
+    if (quote != '\0') {
+      normalized.push_back(c);
+      if (c == '\\' && i + 1 < expr.size()) {
+        normalized.push_back(expr[++i]);
+      } else if (c == quote) {
+        quote = '\0';
+      }
+      continue;
+    }
+
+    if (isspace(static_cast<unsigned char>(c))) {
+      pending_space = !normalized.empty();
+      continue;
+    }
+    if (pending_space) {
+      normalized.push_back(' ');
+      pending_space = false;
+    }
+    if (c == '\'' || c == '"') {
+      quote = c;
+    }
+    normalized.push_back(c);
+  }
+  return normalized;
+}
+
+ReferenceCache::ReferenceCache(lldb::SBFrame frame,
+                               const std::string& cache_dir)
+    : frame_(frame) {
+  std::string key = stop_location_key(frame_);
+  if (cache_dir.empty() || key.empty()) {
+    return;
+  }
+
+  if (llvm::sys::fs::create_directories(cache_dir)) {
+    fprintf(stderr, "Warning: Could not create the cache directory %s\n",
+            cache_dir.c_str());
+    return;
+  }
+
+  llvm::SmallString<256> path(cache_dir);
+  llvm::sys::path::append(path, key + RESULTS_FILE_SUFFIX);
+
+  size_t file_size = 0;
+  size_t valid_size = 0;
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (buffer) {
+    file_size = (*buffer)->getBufferSize();
+    valid_size = load((*buffer)->getBuffer());
+  }
+
+  int fd;
+  if (llvm::sys::fs::openFileForWrite(path, fd, llvm::sys::fs::CD_OpenAlways,
+                                      llvm::sys::fs::OF_Append)) {
+    fprintf(stderr, "Warning: Could not open %s for writing\n", path.c_str());
+    return;
+  }
+  // Drop a record cut short (e.g. by a crash in the middle of a write), so
+  // that the new records can be read back.
+  if (valid_size < file_size) {
+    drop_incomplete_record(fd, path.str().str());
+  }
+  fd_ = fd;
+  file_ = std::make_unique<llvm::raw_fd_ostream>(fd, /*shouldClose*/ true,
+                                                 /*unbuffered*/ true);
+}
+
+ReferenceCache::~ReferenceCache() = default;
+
+const ReferenceResult& ReferenceCache::evaluate(const std::string& expr) {
+  std::string normalized = normalize_expr(expr);
+  auto it = results_.find(normalized);
+  if (it != results_.end()) {
+    hits_++;
+    return it->second;
+  }
+  misses_++;
+
+  // Disable auto fix-its in LLDB evaluations.
+  lldb::SBExpressionOptions options;
+  options.SetAutoApplyFixIts(false);
+  ReferenceResult result = ReferenceResult::from_value(
+      frame_.EvaluateExpression(expr.c_str(), options));
+
+  append(normalized, result);
+  if (results_.size() >= MAX_CACHED_RESULTS) {
+    uncached_result_ = std::move(result);
+    return uncached_result_;
+  }
+  return results_.emplace(std::move(normalized), std::move(result))
+      .first->second;
+}
+
+size_t ReferenceCache::load(std::string_view data) {
+  RecordReader reader(data);
+  size_t valid_size = 0;
+  while (valid_size < data.size()) {
+    auto size = reader.read_u32();
+    RecordReader record(reader.read_bytes(size.value_or(0)));
+    if (!reader.ok()) {
+      break;
+    }
+    valid_size += sizeof(uint32_t) + *size;
+    if (results_.size() >= MAX_CACHED_RESULTS) {
+      continue;
+    }
+
+    std::string_view expr = record.read_string();
+    auto mask = record.read_bytes(1);
+    ReferenceResult result;
+    for (size_t i = 0; i < NUM_RESULT_FIELDS && record.ok(); i++) {
+      if (mask[0] & (1 << i)) {
+        result.*RESULT_FIELDS[i] = std::string(record.read_string());
+      }
+    }
+    if (record.ok()) {
+      results_.emplace(expr, std::move(result));
+    }
+  }
+  return valid_size;
+}
+
+void ReferenceCache::append(const std::string& expr,
+                            const ReferenceResult& result) {
+  if (file_ == nullptr) {
+    return;
+  }
+
+  std::string fields;
+  write_string(fields, expr);
+  uint8_t mask = 0;
+  for (size_t i = 0; i < NUM_RESULT_FIELDS; i++) {
+    if ((result.*RESULT_FIELDS[i]).has_value()) {
+      mask |= 1 << i;
+    }
+  }
+  fields.push_back(static_cast<char>(mask));
+  for (size_t i = 0; i < NUM_RESULT_FIELDS; i++) {
+    if ((result.*RESULT_FIELDS[i]).has_value()) {
+      write_string(fields, *(result.*RESULT_FIELDS[i]));
+    }
+  }
+
+  std::string record;
+  write_u32(record, fields.size());
+  record.append(fields);
+  bool locked = lock_file(fd_, /*exclusive*/ false);
+  *file_ << record;
+  if (locked) {
+    unlock_file(fd_);
+  }
+
+  if (file_->has_error()) {
+    // Keep the results in memory only, `raw_fd_ostream` aborts if destroyed
+    // with an unhandled error.
+    fprintf(stderr, "Warning: Could not write to the reference cache: %s\n",
+            file_->error().message().c_str());
+    file_->clear_error();
+    file_.reset();
+  }
+}
+
+}  // namespace fuzzer
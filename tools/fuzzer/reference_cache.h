@@ -0,0 +1,104 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_REFERENCE_CACHE_H
+#define INCLUDE_REFERENCE_CACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "lldb/API/SBFrame.h"
+#include "lldb/API/SBType.h"
+#include "lldb/API/SBValue.h"
+
+namespace llvm {
+class raw_fd_ostream;
+}  // namespace llvm
+
+namespace fuzzer {
+
+// Result of an LLDB evaluation, i.e. what the differential fuzzers compare the
+// results of lldb-eval against. Missing fields are null in LLDB.
+struct ReferenceResult {
+  std::optional<std::string> value;
+  std::optional<std::string> type_name;
+  // Canonical type name without cv-qualifiers.
+  std::optional<std::string> canonical_type_name;
+  // Only set if the evaluation failed.
+  std::optional<std::string> error;
+
+  static ReferenceResult from_value(lldb::SBValue value);
+};
+
+// Canonical name of the `type` without cv-qualifiers, or nullopt if the type
+// isn't valid.
+std::optional<std::string> canonical_type_name(lldb::SBType type);
+
+// Collapses whitespace outside of character and string literals, so that
+// differently formatted expressions share cache entries.
+std::string normalize_expr(std::string_view expr);
+
+// Cache of LLDB evaluations in the given frame. LLDB compiles each expression
+// with Clang, which makes it orders of magnitude slower than lldb-eval and the
+// bottleneck of differential fuzzing. The same expressions are evaluated over
+// and over though, by libFuzzer's mutations and across fuzzing runs.
+//
+// Results are keyed by the build-ID of the binary, the stop location (see
+// `stop_location_key`) and the normalized expression. If `cache_dir` isn't
+// empty, the results are appended to a file in it and loaded by later runs.
+// Results are only kept in memory if the binary doesn't have a build-ID.
+//
+// Expressions must not have side effects, as they aren't re-evaluated on cache
+// hits.
+class ReferenceCache {
+ public:
+  ReferenceCache(lldb::SBFrame frame, const std::string& cache_dir);
+  ~ReferenceCache();
+
+  ReferenceCache(const ReferenceCache&) = delete;
+  ReferenceCache& operator=(const ReferenceCache&) = delete;
+
+  // Evaluates `expr` with LLDB (without fix-its), or returns the cached
+  // result. The reference is valid until the next call.
+  const ReferenceResult& evaluate(const std::string& expr);
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+ private:
+  // Loads the records of a results file, returns the size of the complete
+  // records.
+  size_t load(std::string_view data);
+  void append(const std::string& expr, const ReferenceResult& result);
+
+  lldb::SBFrame frame_;
+  std::unordered_map<std::string, ReferenceResult> results_;
+  // Holds the result once the cache is full.
+  ReferenceResult uncached_result_;
+  std::unique_ptr<llvm::raw_fd_ostream> file_;
+  // Descriptor of `file_`, for locking.
+  int fd_ = -1;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+}  // namespace fuzzer
+
+#endif  // INCLUDE_REFERENCE_CACHE_H
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/fuzzer/symbol_index.h"
+
+#include <utility>
+
+namespace fuzzer {
+
+// Returns the memoized value for `key`, computing it with `compute()` on the
+// first query.
+template <typename Map, typename ComputeFn>
+static const typename Map::mapped_type& memoize(
+    Map& memo, const typename Map::key_type& key, ComputeFn compute) {
+  auto it = memo.find(key);
+  if (it == memo.end()) {
+    it = memo.emplace(key, compute()).first;
+  }
+  return it->second;
+}
+
+// Collects the symbols of all types allowed by the `constraints`.
+template <typename T, typename Map>
+static SymbolRefs<T> collect_by_type(const Map& symbols_by_type,
+                                     const TypeConstraints& constraints) {
+  SymbolRefs<T> symbols;
+  for (const auto& [k, v] : symbols_by_type) {
+    if (constraints.allows_type(k)) {
+      symbols.insert(symbols.end(), v.begin(), v.end());
+    }
+  }
+  return symbols;
+}
+
+SymbolIndex::SymbolIndex(SymbolTable symtab) : symtab_(std::move(symtab)) {
+  tagged_types_.reserve(symtab_.tagged_types().size());
+  for (const auto& tagged_type : symtab_.tagged_types()) {
+    tagged_types_.emplace_back(tagged_type);
+  }
+}
+
+const SymbolRefs<VariableExpr>& SymbolIndex::vars(
+    const ExprConstraints& constraints, bool long_double_enabled) {
+  return memoize(vars_[long_double_enabled], constraints, [&] {
+    const auto& type_constraints = constraints.type_constraints();
+    const auto& memory_constraints = constraints.memory_constraints();
+
+    SymbolRefs<VariableExpr> vars;
+    for (const auto& [k, v] : symtab_.vars()) {
+      // Skip long double variables if long double isn't enabled.
+      if (!long_double_enabled && k == Type(ScalarType::LongDouble)) {
+        continue;
+      }
+
+      if (type_constraints.allows_type(k)) {
+        for (const auto& var : v) {
+          if (var.expr.name() == "this" && constraints.must_be_lvalue()) {
+            // "this" is an rvalue.
+            continue;
+          }
+          if (var.freedom_index >=
+              memory_constraints.required_freedom_index()) {
+            vars.emplace_back(var.expr);
+          }
+        }
+      }
+    }
+    return vars;
+  });
+}
+
+const SymbolRefs<Field>& SymbolIndex::fields(
+    const TypeConstraints& constraints) {
+  return memoize(fields_, constraints, [&] {
+    return collect_by_type<Field>(symtab_.fields_by_type(), constraints);
+  });
+}
+
+const SymbolRefs<Function>& SymbolIndex::functions(
+    const TypeConstraints& constraints) {
+  return memoize(functions_, constraints, [&] {
+    return collect_by_type<Function>(symtab_.functions(), constraints);
+  });
+}
+
+const SymbolRefs<EnumConstant>& SymbolIndex::enum_literals(
+    const TypeConstraints& constraints) {
+  return memoize(enum_literals_, constraints, [&] {
+    return collect_by_type<EnumConstant>(symtab_.enums(), constraints);
+  });
+}
+
+const SymbolRefs<EnumType>& SymbolIndex::enum_types(
+    const TypeConstraints& constraints) {
+  return memoize(enum_types_, constraints, [&] {
+    SymbolRefs<EnumType> enum_types;
+    for (const auto& [enum_type, _] : symtab_.enums()) {
+      if (constraints.allows_type(enum_type)) {
+        enum_types.emplace_back(enum_type);
+      }
+    }
+    return enum_types;
+  });
+}
+
+const SymbolRefs<ArrayType>& SymbolIndex::array_types(
+    const TypeConstraints& constraints) {
+  return memoize(array_types_, constraints, [&] {
+    SymbolRefs<ArrayType> array_types;
+    for (const auto& type : symtab_.array_types()) {
+      if (constraints.allows_type(type)) {
+        array_types.emplace_back(type);
+      }
+    }
+    return array_types;
+  });
+}
+
+ExprKindMask SymbolIndex::viable_expr_kinds(const ExprConstraints& constraints,
+                                            bool long_double_enabled) {
+  return memoize(viable_expr_kinds_[long_double_enabled], constraints, [&] {
+    const auto& type_constraints = constraints.type_constraints();
+
+    ExprKindMask mask = ExprKindMask::all_set();
+    if (vars(constraints, long_double_enabled).empty()) {
+      mask[ExprKind::VariableExpr] = false;
+    }
+    if (enum_literals(type_constraints).empty()) {
+      mask[ExprKind::EnumConstant] = false;
+    }
+    if (fields(type_constraints).empty()) {
+      mask[ExprKind::MemberOf] = false;
+      mask[ExprKind::MemberOfPtr] = false;
+    }
+    if (functions(type_constraints).empty()) {
+      mask[ExprKind::FunctionCallExpr] = false;
+    }
+    return mask;
+  });
+}
+
+}  // namespace fuzzer
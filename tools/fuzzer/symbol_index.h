@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_SYMBOL_INDEX_H
+#define INCLUDE_SYMBOL_INDEX_H
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "tools/fuzzer/ast.h"
+#include "tools/fuzzer/constraints.h"
+#include "tools/fuzzer/expr_gen.h"
+#include "tools/fuzzer/symbol_table.h"
+
+namespace fuzzer {
+
+template <typename T>
+using SymbolRefs = std::vector<std::reference_wrapper<const T>>;
+
+// Answers "which symbols satisfy these constraints?" queries for a symbol
+// table. The answers are memoized by constraints: only the first query with
+// given constraints scans the symbol table, later ones are a hash lookup, no
+// matter how large the symbol table is. The symbols are listed in the symbol
+// table iteration order, i.e. in the order the generator used to collect
+// them in.
+//
+// The index isn't thread-safe. It's meant to be shared by the generators using
+// the same symbol table, e.g. by the generators created for each input of
+// libFuzzer.
+class SymbolIndex {
+ public:
+  explicit SymbolIndex(SymbolTable symtab);
+
+  // The symbol lists refer to the symbol table.
+  SymbolIndex(const SymbolIndex&) = delete;
+  SymbolIndex& operator=(const SymbolIndex&) = delete;
+
+  const SymbolTable& symtab() const { return symtab_; }
+
+  // Variables of allowed types with a sufficient freedom index. `this` isn't
+  // included if an lvalue is required.
+  const SymbolRefs<VariableExpr>& vars(const ExprConstraints& constraints,
+                                       bool long_double_enabled);
+  const SymbolRefs<Field>& fields(const TypeConstraints& constraints);
+  const SymbolRefs<Function>& functions(const TypeConstraints& constraints);
+  const SymbolRefs<EnumConstant>& enum_literals(
+      const TypeConstraints& constraints);
+  const SymbolRefs<EnumType>& enum_types(const TypeConstraints& constraints);
+  const SymbolRefs<ArrayType>& array_types(const TypeConstraints& constraints);
+  const SymbolRefs<TaggedType>& tagged_types() const { return tagged_types_; }
+
+  // Expression kinds which could satisfy the constraints as far as the symbol
+  // table is concerned, i.e. kinds that would use a symbol (e.g. a variable or
+  // a field) are excluded if there is no matching symbol. This doesn't depend
+  // on the generation depth, the generator applies the depth limits on top.
+  ExprKindMask viable_expr_kinds(const ExprConstraints& constraints,
+                                 bool long_double_enabled);
+
+ private:
+  template <typename T>
+  using Memo = std::unordered_map<TypeConstraints, SymbolRefs<T>>;
+
+  SymbolTable symtab_;
+  SymbolRefs<TaggedType> tagged_types_;
+
+  // Memo tables of variables and viable expression kinds are indexed by
+  // `long_double_enabled`, as long double variables can be disabled.
+  std::unordered_map<ExprConstraints, SymbolRefs<VariableExpr>> vars_[2];
+  std::unordered_map<ExprConstraints, ExprKindMask> viable_expr_kinds_[2];
+  Memo<Field> fields_;
+  Memo<Function> functions_;
+  Memo<EnumConstant> enum_literals_;
+  Memo<EnumType> enum_types_;
+  Memo<ArrayType> array_types_;
+};
+
+}  // namespace fuzzer
+
+#endif  // INCLUDE_SYMBOL_INDEX_H
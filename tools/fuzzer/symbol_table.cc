@@ -16,11 +16,18 @@
 
 #include "tools/fuzzer/symbol_table.h"
 
+#include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
 
 #include "lldb-eval/traits.h"
+#include "lldb/API/SBAddress.h"
 #include "lldb/API/SBError.h"
 #include "lldb/API/SBFrame.h"
 #include "lldb/API/SBMemoryRegionInfo.h"
@@ -32,6 +39,12 @@
 #include "lldb/API/SBTypeEnumMember.h"
 #include "lldb/API/SBValue.h"
 #include "lldb/API/SBVariablesOptions.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tools/fuzzer/ast.h"
 
 namespace fuzzer {
@@ -489,4 +502,428 @@ SymbolTable SymbolTable::create_from_value(lldb::SBValue& value,
   return symtab;
 }
 
+namespace {
+
+// Snapshots start with the magic bytes, the last one being the format version.
+// Integers are stored in little-endian byte order, strings and lists are
+// prefixed with their size.
+constexpr std::string_view SNAPSHOT_MAGIC("LESYMTB\x01", 8);
+
+enum class SnapshotTypeKind : uint8_t {
+  ScalarType,
+  TaggedType,
+  PointerType,
+  NullptrType,
+  EnumType,
+  ArrayType,
+};
+
+class SnapshotWriter {
+ public:
+  void write_bytes(std::string_view bytes) { data_.append(bytes); }
+
+  template <typename T>
+  void write_int(T value) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    for (size_t i = 0; i < sizeof(T); i++) {
+      data_.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+  }
+
+  void write_string(const std::string& str) {
+    write_int<uint32_t>(str.size());
+    data_.append(str);
+  }
+
+  void write_enum_type(const EnumType& type) {
+    write_string(type.name());
+    write_int<uint8_t>(type.is_scoped());
+  }
+
+  void write_type(const Type& type) {
+    const auto* scalar_type = std::get_if<ScalarType>(&type);
+    if (scalar_type != nullptr) {
+      write_kind(SnapshotTypeKind::ScalarType);
+      write_int<uint8_t>(static_cast<uint8_t>(*scalar_type));
+      return;
+    }
+
+    const auto* tagged_type = std::get_if<TaggedType>(&type);
+    if (tagged_type != nullptr) {
+      write_kind(SnapshotTypeKind::TaggedType);
+      write_string(tagged_type->name());
+      return;
+    }
+
+    const auto* pointer_type = std::get_if<PointerType>(&type);
+    if (pointer_type != nullptr) {
+      const auto& inner = pointer_type->type();
+      write_kind(SnapshotTypeKind::PointerType);
+      write_int<uint8_t>(inner.cv_qualifiers()[CvQualifier::Const]);
+      write_int<uint8_t>(inner.cv_qualifiers()[CvQualifier::Volatile]);
+      write_type(inner.type());
+      return;
+    }
+
+    if (std::holds_alternative<NullptrType>(type)) {
+      write_kind(SnapshotTypeKind::NullptrType);
+      return;
+    }
+
+    const auto* enum_type = std::get_if<EnumType>(&type);
+    if (enum_type != nullptr) {
+      write_kind(SnapshotTypeKind::EnumType);
+      write_enum_type(*enum_type);
+      return;
+    }
+
+    const auto* array_type = std::get_if<ArrayType>(&type);
+    if (array_type != nullptr) {
+      write_kind(SnapshotTypeKind::ArrayType);
+      write_int<uint64_t>(array_type->size());
+      write_type(array_type->type());
+      return;
+    }
+
+    assert(false && "Did you introduce a new type?");
+  }
+
+  const std::string& data() const { return data_; }
+
+ private:
+  void write_kind(SnapshotTypeKind kind) {
+    write_int<uint8_t>(static_cast<uint8_t>(kind));
+  }
+
+  std::string data_;
+};
+
+// Reads a snapshot. Reading past the end or reading invalid values makes the
+// reader fail, after which all reads return default values.
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(std::string_view data) : data_(data) {}
+
+  bool ok() const { return ok_; }
+  bool at_end() const { return pos_ == data_.size(); }
+
+  std::string_view read_bytes(size_t size) {
+    if (!ok_ || data_.size() - pos_ < size) {
+      ok_ = false;
+      return {};
+    }
+    std::string_view bytes = data_.substr(pos_, size);
+    pos_ += size;
+    return bytes;
+  }
+
+  template <typename T>
+  T read_int() {
+    std::string_view bytes = read_bytes(sizeof(T));
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes.size(); i++) {
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return static_cast<T>(value);
+  }
+
+  std::string read_string() {
+    uint32_t size = read_int<uint32_t>();
+    return std::string(read_bytes(size));
+  }
+
+  EnumType read_enum_type() {
+    std::string name = read_string();
+    bool scoped = read_int<uint8_t>();
+    return EnumType(std::move(name), scoped);
+  }
+
+  Type read_type() {
+    switch (static_cast<SnapshotTypeKind>(read_int<uint8_t>())) {
+      case SnapshotTypeKind::ScalarType: {
+        uint8_t scalar_type = read_int<uint8_t>();
+        if (scalar_type > static_cast<uint8_t>(ScalarType::EnumLast)) {
+          ok_ = false;
+        }
+        return static_cast<ScalarType>(scalar_type);
+      }
+
+      case SnapshotTypeKind::TaggedType:
+        return TaggedType(read_string());
+
+      case SnapshotTypeKind::PointerType: {
+        CvQualifiers cv_qualifiers;
+        cv_qualifiers[CvQualifier::Const] = read_int<uint8_t>();
+        cv_qualifiers[CvQualifier::Volatile] = read_int<uint8_t>();
+        Type inner = read_type();
+        return PointerType(QualifiedType(std::move(inner), cv_qualifiers));
+      }
+
+      case SnapshotTypeKind::NullptrType:
+        return NullptrType();
+
+      case SnapshotTypeKind::EnumType:
+        return read_enum_type();
+
+      case SnapshotTypeKind::ArrayType: {
+        uint64_t size = read_int<uint64_t>();
+        Type element_type = read_type();
+        return ArrayType(std::move(element_type), size);
+      }
+    }
+
+    ok_ = false;
+    return ScalarType::Void;
+  }
+
+ private:
+  std::string_view data_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+// Returns the file name of the snapshot for the `frame`, or an empty string if
+// the snapshot can't be keyed.
+std::string snapshot_file_name(lldb::SBFrame& frame,
+                               bool ignore_qualified_types) {
+  std::string key = stop_location_key(frame);
+  if (key.empty()) {
+    return "";
+  }
+  return key + (ignore_qualified_types ? "-unqualified" : "") + ".symtab";
+}
+
+std::optional<SymbolTable> load_snapshot(const llvm::Twine& path) {
+  llvm::Expected<llvm::sys::fs::file_t> file =
+      llvm::sys::fs::openNativeFileForRead(path);
+  if (!file) {
+    llvm::consumeError(file.takeError());
+    return {};
+  }
+
+  std::optional<SymbolTable> symtab;
+  llvm::sys::fs::file_status status;
+  std::error_code ec = llvm::sys::fs::status(*file, status);
+  if (!ec && status.getSize() > 0) {
+    llvm::sys::fs::mapped_file_region region(
+        *file, llvm::sys::fs::mapped_file_region::readonly, status.getSize(),
+        0, ec);
+    if (!ec) {
+      symtab = SymbolTable::deserialize(
+          std::string_view(region.const_data(), region.size()));
+    }
+  }
+  llvm::sys::fs::closeFile(*file);
+
+  return symtab;
+}
+
+void save_snapshot(const std::string& cache_dir, const llvm::Twine& path,
+                   const std::string& data) {
+  if (llvm::sys::fs::create_directories(cache_dir)) {
+    return;
+  }
+
+  // Write to a temporary file which is then renamed, so that processes
+  // started concurrently never see a partially written snapshot.
+  int fd;
+  llvm::SmallString<128> tmp_path;
+  if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, tmp_path)) {
+    return;
+  }
+
+  bool failed;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose*/ true);
+    os << data;
+    os.close();
+    failed = os.has_error();
+    os.clear_error();
+  }
+
+  if (failed || llvm::sys::fs::rename(tmp_path, path)) {
+    llvm::sys::fs::remove(tmp_path);
+  }
+}
+
+}  // namespace
+
+std::string stop_location_key(lldb::SBFrame& frame) {
+  const char* build_id = frame.GetModule().GetUUIDString();
+  if (build_id == nullptr || build_id[0] == '\0') {
+    return "";
+  }
+
+  std::ostringstream os;
+  os << build_id << "-" << std::hex << frame.GetPCAddress().GetFileAddress();
+  return os.str();
+}
+
+SymbolTable SymbolTable::create_from_frame_cached(lldb::SBFrame& frame,
+                                                  const std::string& cache_dir,
+                                                  bool ignore_qualified_types) {
+  std::string file_name = snapshot_file_name(frame, ignore_qualified_types);
+  if (file_name.empty()) {
+    return create_from_frame(frame, ignore_qualified_types);
+  }
+
+  llvm::SmallString<128> path(cache_dir);
+  llvm::sys::path::append(path, file_name);
+
+  auto snapshot = load_snapshot(path);
+  if (snapshot.has_value()) {
+    return std::move(snapshot.value());
+  }
+
+  std::string data =
+      create_from_frame(frame, ignore_qualified_types).serialize();
+  save_snapshot(cache_dir, path, data);
+
+  // Return the symbol table as it's loaded from the snapshot. The iteration
+  // order of symbols depends on the insertion order, and it should be the same
+  // on all runs (e.g. the corpus of libFuzzer depends on it).
+  snapshot = deserialize(data);
+  assert(snapshot.has_value() && "Snapshot couldn't be deserialized!");
+  return std::move(snapshot.value());
+}
+
+std::string SymbolTable::serialize() const {
+  SnapshotWriter writer;
+  writer.write_bytes(SNAPSHOT_MAGIC);
+
+  writer.write_int<uint32_t>(var_map_.size());
+  for (const auto& [type, vars] : var_map_) {
+    writer.write_type(type);
+    writer.write_int<uint32_t>(vars.size());
+    for (const auto& var : vars) {
+      writer.write_string(var.expr.name());
+      writer.write_int<int32_t>(var.freedom_index);
+    }
+  }
+
+  writer.write_int<uint32_t>(function_map_.size());
+  for (const auto& [type, functions] : function_map_) {
+    writer.write_type(type);
+    writer.write_int<uint32_t>(functions.size());
+    for (const auto& function : functions) {
+      writer.write_string(function.name());
+      writer.write_int<uint32_t>(function.argument_types().size());
+      for (const auto& argument_type : function.argument_types()) {
+        writer.write_type(argument_type);
+      }
+    }
+  }
+
+  writer.write_int<uint32_t>(fields_by_type_.size());
+  for (const auto& [type, fields] : fields_by_type_) {
+    writer.write_type(type);
+    writer.write_int<uint32_t>(fields.size());
+    for (const auto& field : fields) {
+      writer.write_string(field.containing_type().name());
+      writer.write_string(field.name());
+      writer.write_int<uint8_t>(field.is_reference_or_virtual());
+    }
+  }
+
+  writer.write_int<uint32_t>(enum_map_.size());
+  for (const auto& [type, literals] : enum_map_) {
+    writer.write_enum_type(type);
+    writer.write_int<uint32_t>(literals.size());
+    for (const auto& literal : literals) {
+      writer.write_string(literal.literal());
+    }
+  }
+
+  writer.write_int<uint32_t>(tagged_types_.size());
+  for (const auto& type : tagged_types_) {
+    writer.write_string(type.name());
+  }
+
+  writer.write_int<uint32_t>(array_types_.size());
+  for (const auto& type : array_types_) {
+    writer.write_type(type);
+  }
+
+  return writer.data();
+}
+
+std::optional<SymbolTable> SymbolTable::deserialize(std::string_view data) {
+  SnapshotReader reader(data);
+  if (reader.read_bytes(SNAPSHOT_MAGIC.size()) != SNAPSHOT_MAGIC) {
+    return {};
+  }
+
+  SymbolTable symtab;
+
+  uint32_t num_var_types = reader.read_int<uint32_t>();
+  for (uint32_t i = 0; i < num_var_types && reader.ok(); i++) {
+    auto& vars = symtab.var_map_[reader.read_type()];
+    uint32_t num_vars = reader.read_int<uint32_t>();
+    for (uint32_t j = 0; j < num_vars && reader.ok(); j++) {
+      std::string name = reader.read_string();
+      int freedom_index = reader.read_int<int32_t>();
+      vars.emplace_back(VariableExpr(std::move(name)), freedom_index);
+    }
+  }
+
+  uint32_t num_function_types = reader.read_int<uint32_t>();
+  for (uint32_t i = 0; i < num_function_types && reader.ok(); i++) {
+    auto& functions = symtab.function_map_[reader.read_type()];
+    uint32_t num_functions = reader.read_int<uint32_t>();
+    for (uint32_t j = 0; j < num_functions && reader.ok(); j++) {
+      std::string name = reader.read_string();
+      std::vector<Type> argument_types;
+      uint32_t num_arguments = reader.read_int<uint32_t>();
+      for (uint32_t k = 0; k < num_arguments && reader.ok(); k++) {
+        argument_types.emplace_back(reader.read_type());
+      }
+      functions.emplace_back(std::move(name), std::move(argument_types));
+    }
+  }
+
+  uint32_t num_field_types = reader.read_int<uint32_t>();
+  for (uint32_t i = 0; i < num_field_types && reader.ok(); i++) {
+    auto& fields = symtab.fields_by_type_[reader.read_type()];
+    uint32_t num_fields = reader.read_int<uint32_t>();
+    for (uint32_t j = 0; j < num_fields && reader.ok(); j++) {
+      TaggedType containing_type(reader.read_string());
+      std::string name = reader.read_string();
+      bool is_reference_or_virtual = reader.read_int<uint8_t>();
+      fields.emplace_back(std::move(containing_type), std::move(name),
+                          is_reference_or_virtual);
+    }
+  }
+
+  uint32_t num_enum_types = reader.read_int<uint32_t>();
+  for (uint32_t i = 0; i < num_enum_types && reader.ok(); i++) {
+    EnumType type = reader.read_enum_type();
+    auto& literals = symtab.enum_map_[type];
+    uint32_t num_literals = reader.read_int<uint32_t>();
+    for (uint32_t j = 0; j < num_literals && reader.ok(); j++) {
+      literals.emplace_back(type, reader.read_string());
+    }
+  }
+
+  uint32_t num_tagged_types = reader.read_int<uint32_t>();
+  for (uint32_t i = 0; i < num_tagged_types && reader.ok(); i++) {
+    symtab.tagged_types_.emplace(reader.read_string());
+  }
+
+  uint32_t num_array_types = reader.read_int<uint32_t>();
+  for (uint32_t i = 0; i < num_array_types && reader.ok(); i++) {
+    Type type = reader.read_type();
+    const auto* array_type = std::get_if<ArrayType>(&type);
+    if (array_type == nullptr) {
+      return {};
+    }
+    symtab.array_types_.insert(*array_type);
+  }
+
+  if (!reader.ok() || !reader.at_end()) {
+    return {};
+  }
+
+  return symtab;
+}
+
 }  // namespace fuzzer
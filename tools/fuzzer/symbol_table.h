@@ -18,6 +18,9 @@
 #define INCLUDE_SYMBOL_TABLE_H_
 
 #include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -81,6 +84,20 @@ class SymbolTable {
   static SymbolTable create_from_value(lldb::SBValue& value,
                                        bool ignore_qualified_types = false);
 
+  // Same as `create_from_frame`, but the symbol table is saved as a snapshot
+  // to `cache_dir` and memory-mapped from there on later runs. Snapshots are
+  // keyed by the build-ID of the frame's module and the stop location, which
+  // assumes that the inferior is in the same state whenever it stops there
+  // (freedom indices depend on the values of pointers). If the module doesn't
+  // have a build-ID, no snapshot is used.
+  static SymbolTable create_from_frame_cached(
+      lldb::SBFrame& frame, const std::string& cache_dir,
+      bool ignore_qualified_types = false);
+
+  // Compact binary representation of the symbol table, used by snapshots.
+  std::string serialize() const;
+  static std::optional<SymbolTable> deserialize(std::string_view data);
+
   void add_var(Type type, VariableExpr var, int freedom_index = 0) {
     var_map_[type].emplace_back(std::move(var), freedom_index);
 
@@ -151,6 +168,11 @@ class SymbolTable {
   std::unordered_set<ArrayType> array_types_;
 };
 
+// Returns a key identifying the binary and the location the `frame` is
+// stopped at, i.e. the build-ID of the frame's module and the file address of
+// the PC. Returns an empty string if the module doesn't have a build-ID.
+std::string stop_location_key(lldb::SBFrame& frame);
+
 }  // namespace fuzzer
 
 #endif  // INCLUDE_SYMBOL_TABLE_H_
@@ -400,3 +400,44 @@ TEST_F(PopulateSymbolTableTest, Enums) {
                               EnumConstant(type, "ns::EnumClass::THREE")));
   }
 }
+
+TEST_F(PopulateSymbolTableTest, Serialization) {
+  std::string data = symtab_.serialize();
+  auto loaded = SymbolTable::deserialize(data);
+  ASSERT_TRUE(loaded.has_value());
+
+  ASSERT_EQ(loaded->vars().size(), symtab_.vars().size());
+  for (const auto& [type, vars] : symtab_.vars()) {
+    const auto it = loaded->vars().find(type);
+    ASSERT_NE(it, loaded->vars().end());
+    ASSERT_EQ(it->second.size(), vars.size());
+    for (size_t i = 0; i < vars.size(); i++) {
+      EXPECT_EQ(it->second[i].expr.name(), vars[i].expr.name());
+      EXPECT_EQ(it->second[i].freedom_index, vars[i].freedom_index);
+    }
+  }
+
+  ASSERT_EQ(loaded->fields_by_type().size(), symtab_.fields_by_type().size());
+  for (const auto& [type, fields] : symtab_.fields_by_type()) {
+    const auto it = loaded->fields_by_type().find(type);
+    ASSERT_NE(it, loaded->fields_by_type().end());
+    EXPECT_THAT(it->second, ElementsAreArray(fields));
+  }
+
+  ASSERT_EQ(loaded->enums().size(), symtab_.enums().size());
+  for (const auto& [type, literals] : symtab_.enums()) {
+    const auto it = loaded->enums().find(type);
+    ASSERT_NE(it, loaded->enums().end());
+    EXPECT_THAT(it->second, ElementsAreArray(literals));
+  }
+
+  EXPECT_EQ(loaded->tagged_types(), symtab_.tagged_types());
+  EXPECT_EQ(loaded->array_types(), symtab_.array_types());
+
+  // Loading a snapshot is deterministic, including the order of symbols.
+  EXPECT_EQ(loaded->serialize(), SymbolTable::deserialize(data)->serialize());
+
+  // Truncated or corrupted snapshots are rejected.
+  EXPECT_FALSE(SymbolTable::deserialize(data.substr(0, data.size() - 1)));
+  EXPECT_FALSE(SymbolTable::deserialize("not a symbol table"));
+}